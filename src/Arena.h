@@ -0,0 +1,75 @@
+#ifndef LALG_ARENA_H
+#define LALG_ARENA_H
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/**
+ A bump allocator for float buffers, used by lalg.scope().
+
+ Memory is handed out from large blocks by moving a pointer along, nothing
+ is freed until the whole arena is destroyed. Every buffer starts on a 64
+ byte boundary, the same as the BufferPool.
+
+ An arena belongs to one scope on the main thread, it is not thread safe.
+*/
+class Arena
+{
+  public:
+    static const size_t Alignment = 64 ;		/**< byte alignment of every buffer */
+    static const size_t BlockBytes = 4*1024*1024 ;	/**< the normal size of a block, bigger requests get their own block */
+
+    Arena() : used_(0), left_(0), next_(NULL), bytes_(0) {}
+
+    ~Arena() {
+      for( size_t i=0 ; i<blocks_.size() ; i++ ) {
+        ::free( blocks_[i] ) ;
+      }
+    }
+
+    /**
+	Allocate a buffer big enough for count floats. The actual number
+	of floats available is returned in capacity - it's always >= count.
+	A zero count returns NULL.
+    */
+    float *Alloc( size_t count, size_t &capacity ) {
+      capacity = 0 ;
+      if( count == 0 ) return NULL ;
+
+      size_t bytes = ( count * sizeof(float) + Alignment - 1 ) & ~( Alignment - 1 ) ;
+      if( bytes > left_ ) {
+        size_t blockBytes = bytes > BlockBytes ? bytes : BlockBytes ;
+        void *p = NULL ;
+        if( posix_memalign( &p, Alignment, blockBytes ) != 0 ) {
+          throw std::bad_alloc() ;
+        }
+        blocks_.push_back( p ) ;
+        bytes_ += blockBytes ;
+        next_ = (char*)p ;
+        left_ = blockBytes ;
+      }
+      float *rc = (float*)next_ ;
+      next_ += bytes ;
+      left_ -= bytes ;
+      used_ += bytes ;
+      capacity = bytes / sizeof(float) ;
+      return rc ;
+    }
+
+    size_t Used() const { return used_ ; }	/**< bytes handed out */
+    size_t Bytes() const { return bytes_ ; }	/**< bytes held in blocks */
+
+  private:
+    Arena( const Arena & ) ;
+    Arena &operator=( const Arena & ) ;
+
+    std::vector<void*> blocks_ ;
+    size_t used_ ;
+    size_t left_ ;
+    char *next_ ;
+    size_t bytes_ ;
+} ;
+
+#endif
@@ -5,9 +5,31 @@
 #include <cmath>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <climits>
 #include <lapacke.h>
 #include <cblas.h>
 #include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <map>
+
+#include "BufferPool.h"
+#include "Arena.h"
+#include "Blas.h"
+#include "Quantize.h"
+#include "Sparse.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "Fusion.h"
+#include "Transpose.h"
 
 #include "cppoptlib/meta.h"
 #include "cppoptlib/problem.h"
@@ -23,6 +45,277 @@ using namespace v8;
 
 // forward reference only
 void CreateObject(const FunctionCallbackInfo<Value>& info) ;
+class WrappedArray ;
+template<class T> class TypedMatrix ;
+class QuantizedMatrix ;
+class SparseMatrix ;
+class LazyMatrix ;
+class TransposedMatrix ;
+class Factorization ;
+
+/**
+ A lalg.scope() in progress. Matrices created in a scope get their data
+ from the scope's arena, and the scope keeps a list of them. When the scope
+ ends the returned matrices are moved out of the arena, the others are
+ emptied, and the arena goes. Only matrices made in the scope use the arena,
+ a matrix from outside that needs new memory in the scope ( e.g. reshape ) 
+ gets it from the pool.
+
+ Something may still need the arena after the scope ends ( e.g. a matrix
+ being worked on in the background by mulp ), so the scope is counted -
+ one for being open and one for each storage in the arena.
+
+ Scopes are only used on the main thread.
+*/
+struct Scope {
+  Arena arena ;				/**< where the data comes from */
+  std::vector<WrappedArray*> matrices ;	/**< the matrices using the arena */
+  Scope *outer ;			/**< the enclosing scope, if any */
+  unsigned long id ;			/**< unique - matrices remember the id of the scope they were made in */
+  int refs ;
+
+  Scope( Scope *enclosing ) : outer(enclosing), refs(1) {
+    static unsigned long ids = 0 ;
+    id = ++ids ;
+  }
+
+  /* the id of the innermost open scope, 0 when not in a scope */
+  static unsigned long CurrentId() {
+    return Current() == NULL ? 0 : Current()->id ;
+  }
+
+  /* the innermost open scope, NULL when not in a scope */
+  static Scope *&Current() {
+    static Scope *current = NULL ;
+    return current ;
+  }
+
+  void Track( WrappedArray *m ) { matrices.push_back( m ) ; }
+
+  void Forget( WrappedArray *m ) {
+    for( size_t i=0 ; i<matrices.size() ; i++ ) {
+      if( matrices[i] == m ) {
+        matrices[i] = matrices.back() ;
+        matrices.pop_back() ;
+        return ;
+      }
+    }
+  }
+
+  void Release() {
+    if( --refs == 0 ) delete this ;
+  }
+} ;
+
+/**
+ The memory holding the data of one or more matrices.
+
+ Usually a matrix has its own storage, a buffer from the pool. A view 
+ (@see WrappedArray::View) shares the storage of the matrix it was made
+ from, so the storage is reference counted, the last matrix to let go of
+ it frees it. Storage adopted from a javascript buffer holds a handle
+ on the buffer instead of freeing the memory.
+
+ Storage may also be a memory mapped file (@see WrappedArray::MMap), which
+ is unmapped when released. A read only mapping must never be written, a
+ matrix about to write to one takes a copy of its data first.
+
+ Inside a lalg.scope() new storage comes from the scope's arena instead
+ of the pool. Its memory goes back when the arena does.
+
+ dup() shares storage too, copy on write. Matrices that are not views
+ sharing storage are copies, the first one to write takes its own copy.
+ Storage with views, or visible to javascript, is never shared that way.
+*/
+struct Storage {
+  float *data ;			/**< the start of the memory */
+  int capacity ;		/**< the number of floats available */
+  std::atomic<int> refs ;	/**< the number of matrices using this storage */
+  std::atomic<int> views ;	/**< how many of those matrices are views */
+  bool exported ;		/**< has data been handed to javascript as a Float32Array */
+  bool readOnly ;		/**< data is mapped read only - writing would crash */
+  void *mapBase ;		/**< the start of the mapped file, NULL if not mapped */
+  size_t mapBytes ;		/**< the length of the mapping */
+  Scope *scope ;		/**< the scope whose arena holds data, NULL if not from an arena */
+  size_t external ;		/**< the bytes reported to V8 as external memory */
+  size_t unreported ;		/**< bytes allocated off the main thread, reported when the work completes */
+  unsigned long version ;	/**< changed every time the data is written, shared by every matrix on this storage */
+  Persistent<Object> backing ;	/**< the javascript buffer that owns data, empty if data is from the pool */
+
+  Storage() : data(NULL), capacity(0), refs(1), views(0), exported(false), readOnly(false), 
+		mapBase(NULL), mapBytes(0), scope(NULL), external(0), unreported(0), version(NextVersion()) {}
+
+  /* versions are unique across all storage, so a new copy never matches an old version */
+  static unsigned long NextVersion() {
+    static std::atomic<unsigned long> counter( 0 ) ;
+    return ++counter ;
+  }
+
+  /* 
+	A new storage with room for at least count floats, from the pool or from
+	the current scope's arena if scopeId is the current scope.
+  */
+  static Storage *New( int count, unsigned long scopeId=0 ) {
+    Storage *s = new Storage() ;
+    size_t sz ;
+    Scope *scope = Scope::Current() ;
+    if( scope != NULL && scopeId == scope->id && count > 0 ) {
+      s->data = scope->arena.Alloc( count, sz ) ;
+      s->scope = scope ;
+      scope->refs++ ;
+    } else {
+      s->data = BufferPool::Instance().Alloc( count, sz ) ;
+    }
+    s->capacity = (int)sz ;
+    s->Report( sz * sizeof(float) ) ;
+    return s ;
+  }
+
+  /*
+	Tell V8 about memory we allocate - otherwise a huge matrix looks like
+	a tiny object and the GC is in no hurry to collect it. Only memory that
+	belongs to us (pool & arena buffers) counts, javascript buffers are
+	already known to V8 and mapped files aren't on the heap. There's no
+	isolate in a uv worker thread, so memory allocated there is kept for
+	ReportPending() in the completion callback.
+  */
+  void Report( size_t bytes ) {
+    Isolate *isolate = Isolate::GetCurrent() ;
+    if( bytes == 0 ) return ;
+    if( isolate == NULL ) {
+      unreported += bytes ;
+      return ;
+    }
+    external += bytes ;
+    isolate->AdjustAmountOfExternalAllocatedMemory( (int64_t)bytes ) ;
+  }
+
+  /* report what was allocated in a worker thread - call from the main thread */
+  void ReportPending() {
+    size_t bytes = unreported ;
+    unreported = 0 ;
+    Report( bytes ) ;
+  }
+
+  /* 
+	Map a file of raw floats, starting offset bytes into the file. The whole of
+	the rest of the file is mapped. Private mappings are copy on write - changes
+	are never written back to the file.
+	@return the new storage or NULL ( errno is set ) if the file can't be mapped
+  */
+  static Storage *Map( const char *path, size_t offset, bool writable, int advice ) {
+    int fd = ::open( path, O_RDONLY ) ;
+    if( fd < 0 ) return NULL ;
+    struct stat st ;
+    if( ::fstat( fd, &st ) != 0 ) {
+      ::close( fd ) ;
+      return NULL ;
+    }
+    if( (size_t)st.st_size <= offset ) {
+      ::close( fd ) ;
+      errno = EINVAL ;
+      return NULL ;
+    }
+    // mmap offsets must be page aligned, the data needn't be
+    size_t page = ::sysconf( _SC_PAGESIZE ) ;
+    size_t start = offset - ( offset % page ) ;
+    size_t bytes = st.st_size - start ;
+    void *p = ::mmap( NULL, bytes, writable ? PROT_READ|PROT_WRITE : PROT_READ, 
+			writable ? MAP_PRIVATE : MAP_SHARED, fd, start ) ;
+    ::close( fd ) ;	// the mapping keeps its own reference to the file
+    if( p == MAP_FAILED ) return NULL ;
+    ::madvise( p, bytes, advice ) ;
+
+    Storage *s = new Storage() ;
+    s->mapBase = p ;
+    s->mapBytes = bytes ;
+    s->readOnly = !writable ;
+    s->data = (float*)( (char*)p + ( offset - start ) ) ;
+    s->capacity = (int)std::min( ( st.st_size - offset ) / sizeof(float), (size_t)INT_MAX ) ;
+    return s ;
+  }
+
+  void Ref() { refs++ ; }
+
+  void Release() {
+    if( --refs == 0 ) {
+      if( external > 0 ) {
+        Isolate *isolate = Isolate::GetCurrent() ;
+        if( isolate != NULL ) isolate->AdjustAmountOfExternalAllocatedMemory( -(int64_t)external ) ;
+      }
+      if( scope != NULL ) {
+        scope->Release() ;	// arena memory is only freed with the arena
+      } else if( mapBase != NULL ) {
+        ::munmap( mapBase, mapBytes ) ;
+      } else if( backing.IsEmpty() ) {
+        BufferPool::Instance().Free( data, capacity ) ;
+      } else {
+        backing.Reset() ;
+      }
+      delete this ;
+    }
+  }
+} ;
+
+/*
+ The element wise operators used by add, sub & hadamard (and mul by a number).
+ The Span methods apply the operator over a contiguous run of elements - 
+ c = a op b, or c = a op x. Floats go to the SIMD kernels, any other type
+ ( the double matrices ) is a plain loop over operator().
+*/
+struct AddOp {
+  template<class T> T operator()( T a, T b ) const { return a + b ; }
+  void Span( const float *a, const float *b, float *c, size_t n ) const { Simd::Kernels().add( a, b, c, n ) ; }
+  void Span( const float *a, float x, float *c, size_t n ) const { Simd::Kernels().addScalar( a, x, c, n ) ; }
+  template<class T> void Span( const T *a, const T *b, T *c, size_t n ) const { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] + b[i] ; }
+  template<class T> void Span( const T *a, T x, T *c, size_t n ) const { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] + x ; }
+} ;
+struct SubOp {
+  template<class T> T operator()( T a, T b ) const { return a - b ; }
+  void Span( const float *a, const float *b, float *c, size_t n ) const { Simd::Kernels().sub( a, b, c, n ) ; }
+  void Span( const float *a, float x, float *c, size_t n ) const { Simd::Kernels().subScalar( a, x, c, n ) ; }
+  template<class T> void Span( const T *a, const T *b, T *c, size_t n ) const { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] - b[i] ; }
+  template<class T> void Span( const T *a, T x, T *c, size_t n ) const { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] - x ; }
+} ;
+struct MulOp {
+  template<class T> T operator()( T a, T b ) const { return a * b ; }
+  void Span( const float *a, const float *b, float *c, size_t n ) const { Simd::Kernels().mul( a, b, c, n ) ; }
+  void Span( const float *a, float x, float *c, size_t n ) const { Simd::Kernels().mulScalar( a, x, c, n ) ; }
+  template<class T> void Span( const T *a, const T *b, T *c, size_t n ) const { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] * b[i] ; }
+  template<class T> void Span( const T *a, T x, T *c, size_t n ) const { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] * x ; }
+} ;
+
+/*
+ The element wise functions used by neg, sqrt, log, abs, the activations
+ ( exp, tanh, sigmoid, relu & softplus ) and the finds, c = op( a ) over
+ a contiguous run of elements.
+*/
+struct NegOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().neg( a, c, n ) ; } } ;
+struct SqrtOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().sqrt( a, c, n ) ; } } ;
+struct LogOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().log( a, c, n ) ; } } ;
+struct AbsOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().abs( a, c, n ) ; } } ;
+struct ExpOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().exp( a, c, n ) ; } } ;
+struct TanhOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().tanh( a, c, n ) ; } } ;
+struct SigmoidOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().sigmoid( a, c, n ) ; } } ;
+struct ReluOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().relu( a, c, n ) ; } } ;
+struct SoftplusOp { void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().softplus( a, c, n ) ; } } ;
+
+/* matches are set to v, or left alone if keep is set. Everything else is 0 */
+struct FindNearOp {
+  float x, epsilon, v ;
+  bool keep ;
+  void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().findNear( a, x, epsilon, v, keep, c, n ) ; }
+} ;
+struct FindGreaterOp {
+  float x, v ;
+  bool keep ;
+  void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().findGreater( a, x, v, keep, c, n ) ; }
+} ;
+struct FindLessEqualOp {
+  float x, v ;
+  bool keep ;
+  void Span( const float *a, float *c, size_t n ) const { Simd::Kernels().findLessEqual( a, x, v, keep, c, n ) ; }
+} ;
 
 /**
  This is the main class to represent a matrix. It is a nodejs compatible
@@ -33,6 +326,11 @@ void CreateObject(const FunctionCallbackInfo<Value>& info) ;
  good enough for most situations. The comments for the C++ code contain
  some javascript examples
 
+ A matrix may be a view on a block of another matrix (see View). A view
+ shares the other matrix's storage, data_ points to its first element and 
+ ld_ is the distance between its columns. Code reading data_ directly must
+ allow for ld_ != m_.
+
 */
 class WrappedArray : public node::ObjectWrap
 {
@@ -56,32 +354,76 @@ class WrappedArray : public node::ObjectWrap
       NODE_SET_PROTOTYPE_METHOD(tpl, "toString", ToString);
       NODE_SET_PROTOTYPE_METHOD(tpl, "inspect", Inspect);
       NODE_SET_PROTOTYPE_METHOD(tpl, "dup", Dup);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "dispose", Dispose);
       NODE_SET_PROTOTYPE_METHOD(tpl, "transpose", Transpose);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "transposei", Transposei);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "t", T);
       NODE_SET_PROTOTYPE_METHOD(tpl, "mul", Mul);
       NODE_SET_PROTOTYPE_METHOD(tpl, "mulp", Mulp);
       NODE_SET_PROTOTYPE_METHOD(tpl, "hadamard", Hadamard);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "hadamardi", Hadamardi);
       NODE_SET_PROTOTYPE_METHOD(tpl, "asum", Asum);
       NODE_SET_PROTOTYPE_METHOD(tpl, "sum", Sum);
       NODE_SET_PROTOTYPE_METHOD(tpl, "mean", Mean);
       NODE_SET_PROTOTYPE_METHOD(tpl, "norm", Norm);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "describe", Describe);
       NODE_SET_PROTOTYPE_METHOD(tpl, "add", Add);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "addi", Addi);
       NODE_SET_PROTOTYPE_METHOD(tpl, "sub", Sub);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "subi", Subi);
       NODE_SET_PROTOTYPE_METHOD(tpl, "find", Find);
       NODE_SET_PROTOTYPE_METHOD(tpl, "findGreater", FindGreater);
       NODE_SET_PROTOTYPE_METHOD(tpl, "findLessEqual", FindLessEqual);
       NODE_SET_PROTOTYPE_METHOD(tpl, "neg", Neg);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "negi", Negi);
       NODE_SET_PROTOTYPE_METHOD(tpl, "log", Log);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "logi", Logi);
       NODE_SET_PROTOTYPE_METHOD(tpl, "sqrt", Sqrt);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sqrti", Sqrti);
       NODE_SET_PROTOTYPE_METHOD(tpl, "abs", Abs);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "absi", Absi);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "exp", Exp);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "expi", Expi);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "tanh", Tanh);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "tanhi", Tanhi);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sigmoid", Sigmoid);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sigmoidi", Sigmoidi);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "relu", Relu);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "relui", Relui);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "softplus", Softplus);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "softplusi", Softplusi);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "softmax", Softmax);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "logsumexp", LogSumExp);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "crossEntropy", CrossEntropy);
       NODE_SET_PROTOTYPE_METHOD(tpl, "inv", Inv);
       NODE_SET_PROTOTYPE_METHOD(tpl, "invp", Invp);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "solveLinear", SolveLinear);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "solveLinearp", SolveLinearp);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "lu", Lu);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "lup", Lup);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "chol", Chol);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "cholp", Cholp);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "qr", Qr);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "qrp", Qrp);
       NODE_SET_PROTOTYPE_METHOD(tpl, "pinv", Pinv);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "pinvp", Pinvp);
       NODE_SET_PROTOTYPE_METHOD(tpl, "svd", Svd);
       NODE_SET_PROTOTYPE_METHOD(tpl, "pca", Pca);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "gram", Gram);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "cov", Cov);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "corr", Corr);
       NODE_SET_PROTOTYPE_METHOD(tpl, "getRows", GetRows);
       NODE_SET_PROTOTYPE_METHOD(tpl, "removeRow", RemoveRow);
       NODE_SET_PROTOTYPE_METHOD(tpl, "getColumns", GetColumns);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "view", View);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "viewRows", ViewRows);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "viewColumns", ViewColumns);
       NODE_SET_PROTOTYPE_METHOD(tpl, "appendColumns", AppendColumns );
+      NODE_SET_PROTOTYPE_METHOD(tpl, "appendColumnsi", AppendColumnsi );
+      NODE_SET_PROTOTYPE_METHOD(tpl, "appendRows", AppendRows );
+      NODE_SET_PROTOTYPE_METHOD(tpl, "appendRowsi", AppendRowsi );
+      NODE_SET_PROTOTYPE_METHOD(tpl, "reserve", Reserve );
+      NODE_SET_PROTOTYPE_METHOD(tpl, "shrinkToFit", ShrinkToFit );
       NODE_SET_PROTOTYPE_METHOD(tpl, "removeColumn", RemoveColumn);
       NODE_SET_PROTOTYPE_METHOD(tpl, "rotateColumns", RotateColumns);
       NODE_SET_PROTOTYPE_METHOD(tpl, "reshape", Reshape);
@@ -89,6 +431,11 @@ class WrappedArray : public node::ObjectWrap
       //NODE_SET_PROTOTYPE_METHOD(tpl, "solvep", Solvep);
       NODE_SET_PROTOTYPE_METHOD(tpl, "set", Set);
       NODE_SET_PROTOTYPE_METHOD(tpl, "get", Get);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "asFloat32Array", AsFloat32Array);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toFloat32Array", ToFloat32Array);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toArray64", ToArray64);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "quantize", Quantize);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "lazy", Lazy);
 
 
      // the macro (or inline) doesn't work for a symbol
@@ -105,17 +452,31 @@ class WrappedArray : public node::ObjectWrap
       NODE_SET_METHOD(exports, "rand", Rand);
       NODE_SET_METHOD(exports, "diag", Diag);
       NODE_SET_METHOD(exports, "read", Read);
+      NODE_SET_METHOD(exports, "fromBuffer", FromBuffer);
+      NODE_SET_METHOD(exports, "mmap", MMap);
+      NODE_SET_METHOD(exports, "scope", RunInScope);
+      NODE_SET_METHOD(exports, "poolStats", PoolStats);
+      NODE_SET_METHOD(exports, "setPoolLimit", SetPoolLimit);
+      NODE_SET_METHOD(exports, "setThreads", SetThreads);
+      NODE_SET_METHOD(exports, "map", Map);
 
       // define how we access the attributes
    //   tpl->InstanceTemplate()->SetAccessor(Local<String>::Cast( Symbol::GetIterator(isolate) ) , GetCoeff);
       tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "m"), GetCoeff);
       tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "n"), GetCoeff);
       tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "length"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "isView"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "version"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "symmetric"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "disposed"), GetCoeff);
       tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "maxPrint"), GetCoeff, SetCoeff);
       tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "name"), GetCoeff, SetCoeff);
 
       constructor.Reset(isolate, tpl->GetFunction());
       exports->Set(String::NewFromUtf8(isolate, "Array"), tpl->GetFunction());
+
+      // which element wise kernels this CPU got - scalar, sse2, avx2 or avx512
+      exports->Set(String::NewFromUtf8(isolate, "simd"), String::NewFromUtf8(isolate, Simd::Kernels().name));
     }
     /*
 	The nodejs constructor. 
@@ -123,188 +484,1015 @@ class WrappedArray : public node::ObjectWrap
     */
     static Local<Object> NewInstance(const FunctionCallbackInfo<Value>& args);
   private: 
+    template<class T> friend class TypedMatrix ;	// for the conversions between precisions
+    friend class QuantizedMatrix ;
+    friend class SparseMatrix ;
+    friend class LazyMatrix ;
+    friend class TransposedMatrix ;
+    friend class Factorization ;
+
    /*
 	The C++ constructor, creates an mxn array.
    */
-    explicit WrappedArray(int m=0, int n=0) : m_(m), n_(n) {
-      dataSize_ = m*n ;
-      data_ = new float[dataSize_] ;
+    explicit WrappedArray(int m=0, int n=0) : m_(m), n_(n), ld_(m) {
+      scopeId_ = Scope::CurrentId() ;
+      storage_ = Storage::New( m*n, scopeId_ ) ;
+      data_ = storage_->data ;
+      dataSize_ = storage_->capacity ;
       isVector = m==1 || n== 1 ;
+      isView_ = false ;
       name_ = NULL ;
       maxPrint_ = 10 ;
+      busy_ = 0 ;
+      disposed_ = false ;
+      symmetric_ = 0 ;
+      if( storage_->scope != NULL ) storage_->scope->Track( this ) ;
     }
     /*
 	The destructor needs to free the data buffer
     */
     ~WrappedArray() { 
-	delete data_ ;
-        delete name_ ;
+	DetachViews( false ) ;
+	ReleaseData() ;
+        delete [] name_ ;
     }
 
     /*
-	The javascript constructor.
-	It takes up to 3 args: 
-	@param [in] number of rows (m) defaults to 0
-	@param [in] number of columns (n) defaults to m
-	@param [in] optional an array of data to use for the array (column major order) or a number to put in all elements
+	Drop the data buffer. The storage is freed once no other matrix (view)
+	uses it. Memory borrowed from a javascript buffer is left alone - we
+	just stop keeping the javascript buffer alive.
     */
-    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
-      Isolate* isolate = args.GetIsolate();
+    void ReleaseData() {
+      DetachViews( true ) ;
+      if( storage_ != NULL ) {
+        if( isView_ ) storage_->views-- ;
+        if( storage_->scope != NULL ) storage_->scope->Forget( this ) ;
+        storage_->Release() ;
+      }
+      storage_ = NULL ;
+      data_ = NULL ;
+      dataSize_ = 0 ;
+    }
 
-      // in a constructor? Which one?
+    /*
+	New storage for this matrix, from the arena if we're still in the scope
+	the matrix was made in.
+    */
+    Storage *NewStorage( int count ) const { return Storage::New( count, scopeId_ ) ; }
 
-      if (args.IsConstructCall()) {
+    /*
+	Switch to a new storage, the current data is released. The caller must
+	set the shape (m_, n_ & ld_) to match.
+    */
+    void UseStorage( Storage *storage ) {
+      ReleaseData() ;
+      storage_ = storage ;
+      data_ = storage->data ;
+      dataSize_ = storage->capacity ;
+      isView_ = false ;
+      if( storage->scope != NULL ) storage->scope->Track( this ) ;
+    }
 
-        WrappedArray* self = NULL ;	// will fill this up later
+    /*
+	A matrix is contiguous if its columns follow each other in memory
+	without a gap. Views of rows from a matrix are not, each column
+	is ld_ floats after the previous one.
+    */
+    bool IsContiguous() const { return ld_ == m_ || n_ <= 1 ; }
 
-        int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue();
-        int n = args[1]->IsUndefined() ? m : args[1]->NumberValue();
+    /*
+	Reference an element by its absolute (column major) index
+    */
+    float &Elem( int i ) const {
+      return IsContiguous() ? data_[i] : data_[ (i % m_) + (i / m_) * ld_ ] ;
+    }
 
-	// Do we have an array to use for data?
-        if( !args[2]->IsUndefined() && args[2]->IsArray() ) {
+    /*
+	Walk a matrix as a set of spans - runs of contiguous floats. A contiguous
+	matrix is a single span of M*N floats, a view of rows is N spans of M
+	floats, each ld_ floats after the previous.
+    */
+    int SpanLength() const { return IsContiguous() ? m_*n_ : m_ ; }
+    int SpanCount() const { return IsContiguous() ? 1 : n_ ; }
 
-          Local<Array> buffer = Local<Array>::Cast(args[2]->ToObject() );
+    /*
+	The distance between elements of a vector, a row vector view 
+	steps over whole columns of the matrix it belongs to.
+    */
+    int VectorStride() const { return m_ == 1 ? ld_ : 1 ; }
 
-          Local<Context> context = isolate->GetCurrentContext() ;
-          self = Create(m, n, context, buffer )	;
-        } else {  // No array? just create it
-          self = Create(m, n) ;
-          if( !args[2]->IsUndefined() && args[2]->IsNumber() ) {
-	    float v = args[2]->NumberValue() ;
-	    for( int i=0 ; i<m*n ; ++i) {
-	      self->data_[i] = v ;
-	    }
-	  }
+    /*
+	Copy the data into a dense MxN buffer ( leading dimension = M )
+    */
+    void CopyTo( float *dst ) const {
+      if( IsContiguous() ) {
+        memcpy( dst, data_, (size_t)m_ * n_ * sizeof(float) ) ;
+      } else {
+        for( int c=0 ; c<n_ ; c++ ) {
+          memcpy( dst + (size_t)c*m_, data_ + (size_t)c*ld_, m_ * sizeof(float) ) ;
         }
+      }
+    }
 
-        if( self != NULL ) {  // double check we managed to create something
-          self->Wrap(args.This());
-//          args.This()->SetInternalField(0, External::New(isolate, self));
-          args.GetReturnValue().Set(args.This());
-        }
-        else {
-          args.GetReturnValue().Set( Undefined(isolate) ) ;
-        }
+    /*
+	Apply a binary operator element by element: c = a op b. a & c are MxN,
+	b may be MxN, a row vector ( bm = 1, applied to each row ) or a column 
+	vector ( bn = 1, applied to each column ). Each has its own leading 
+	dimension, so any of them may be a view. This is shared by the float and 
+	double matrices, T is the element type.
+	@return false if the shapes don't match
+    */
+    template<class T, class Op> static bool ApplyBinary( int m, int n, const T *a, int lda, int bm, int bn, const T *b, int ldb, T *c, int ldc, Op op ) {
+      if( n == bn  &&  m == bm ) {
+        bool contiguous = n <= 1 || ( lda == m && ldb == m && ldc == m ) ;
+        ForSpans( contiguous ? 1 : n, contiguous ? m * n : m, [&]( int j, int off, int len ) {
+          op.Span( a + (size_t)j*lda + off, b + (size_t)j*ldb + off, c + (size_t)j*ldc + off, len ) ;
+        } ) ;
+      } else if( n == bn  &&  bm == 1 ) { // a row vector to each row
+        ForSpans( n, m, [&]( int j, int off, int len ) {
+          op.Span( a + (size_t)j*lda + off, b[(size_t)j*ldb], c + (size_t)j*ldc + off, len ) ;
+        } ) ;
+      } else if( m == bm  &&  bn == 1 ) { // a col vector to each col
+        ForSpans( n, m, [&]( int j, int off, int len ) {
+          op.Span( a + (size_t)j*lda + off, b + off, c + (size_t)j*ldc + off, len ) ;
+        } ) ;
+      } else {
+        return false ;
       }
+      return true ;
     }
 
-/**
-	Create an array with some data provided in a javascript Array
-*/
-    static WrappedArray *Create( 
-	int m, /**< [in] number of rows in the matrix */
-	int n, /**< [in] number of cols in the matrix */
-	Local<Context> context, Local<Array> array /**< [in] data to put into the array - column major order */ 
-	) {
+    /*
+	Apply a binary operator element by element: result = self op other.
+	@see ApplyBinary above for the shapes allowed. The result must be MxN.
+    */
+    template<class Op> static bool ApplyBinary( const WrappedArray *self, const WrappedArray *other, WrappedArray *result, Op op ) {
+      return ApplyBinary( self->m_, self->n_, self->data_, self->ld_, other->m_, other->n_, other->data_, other->ld_, result->data_, result->ld_, op ) ;
+    }
 
-      WrappedArray* self = new WrappedArray(m, n) ;
+    /*
+	Apply a binary operator to each element of the MxN a and a number:
+	c = a op x. Shared by the float and double matrices, like ApplyBinary.
+    */
+    template<class T, class Op> static void ApplyScalar( int m, int n, const T *a, int lda, T x, T *c, int ldc, Op op ) {
+      bool contiguous = n <= 1 || ( lda == m && ldc == m ) ;
+      ForSpans( contiguous ? 1 : n, contiguous ? m * n : m, [&]( int j, int off, int len ) {
+        op.Span( a + (size_t)j*lda + off, x, c + (size_t)j*ldc + off, len ) ;
+      } ) ;
+    }
 
-	// Copy the minimum of ( input array size & internal buffer size ) numbers
-        // into the internal buffer
-        int l = array->Length() ;
-        l = std::min( self->m_*self->n_, l ) ;
-        for( int i=0 ; i<l ; i++ ) {
-          self->data_[i] = array->Get( context, i ).ToLocalChecked()->NumberValue() ;
-        }
-      return self ;
+    /*
+	Apply a binary operator to each element and a number: result = self op x.
+    */
+    template<class Op> static void ApplyScalar( const WrappedArray *self, float x, WrappedArray *result, Op op ) {
+      ApplyScalar( self->m_, self->n_, self->data_, self->ld_, x, result->data_, result->ld_, op ) ;
     }
 
-/**
-	Create an array with some (optional) data. This will be the base call
-	for creation for internal methods.
-	
-*/
-    static WrappedArray *Create( 
-	int m, /**< [in] number of rows in the matrix */
-	int n, /**< [in] number of cols in the matrix */
-	float *data = NULL /**< [in] data to put into the array - column major order */ 
-	) {
-      WrappedArray* self = new WrappedArray(m, n);
+    /*
+	Apply a function to each element: result = op( self ). The result
+	must be MxN, it may be self.
+    */
+    template<class Op> static void ApplyUnary( const WrappedArray *self, WrappedArray *result, Op op ) {
+      ForSpans( SpanCount( self, result ), SpanLength( self, result ), [&]( int c, int off, int len ) {
+        op.Span( self->data_ + (size_t)c*self->ld_ + off, result->data_ + (size_t)c*result->ld_ + off, len ) ;
+      } ) ;
+    }
 
-      if( data != NULL ) {
-        for( int i=0 ; i<(m*n) ; i++ ) {
-          self->data_[i] = data[i] ;
+    /*
+	Call f( c, offset, len ) to cover every element of spans runs of
+	spanLen elements, spread over the thread pool when there's enough
+	work. Long spans are cut into pieces too, so a contiguous matrix
+	( one span ) is still split.
+    */
+    template<class F> static void ForSpans( int spans, int spanLen, F f ) {
+      ThreadPool &pool = ThreadPool::Instance() ;
+      size_t per = std::max( (size_t)1, pool.Pieces( (size_t)spans * spanLen ) / std::max( 1, spans ) ) ;
+      per = std::min( per, (size_t)std::max( 1, spanLen ) ) ;	// pieces per span
+      pool.Ranges( (size_t)spans * per, spanLen / per, [&]( size_t, size_t begin, size_t end ) {
+        for( size_t u=begin ; u<end ; u++ ) {
+          int c = (int)( u / per ) ;
+          size_t p = u % per ;
+          int off = (int)( spanLen * p / per ) ;
+          f( c, off, (int)( spanLen * ( p+1 ) / per ) - off ) ;
         }
+      } ) ;
+    }
+
+    /*
+	Add up f( a, len, stride ) - a partial reduction of len elements
+	stride apart - over the whole matrix, or vector, in parallel pieces. 
+	The pieces are added in order, in double, so the answer doesn't
+	depend on the number of threads or their timing.
+    */
+    template<class F> static double ReduceAll( const WrappedArray *self, F f ) {
+      ThreadPool &pool = ThreadPool::Instance() ;
+      std::vector<double> partial ;
+      if( self->isVector || self->IsContiguous() ) {	// one run of elements
+        int stride = self->isVector ? self->VectorStride() : 1 ;
+        size_t count = (size_t)self->m_ * self->n_ ;
+        partial.assign( pool.RangeCount( count, 1 ), 0. ) ;
+        pool.Ranges( count, 1, [&]( size_t piece, size_t begin, size_t end ) {
+          partial[piece] = f( self->data_ + begin*stride, (int)( end - begin ), stride ) ;
+        } ) ;
+      } else {						// whole columns per piece
+        partial.assign( pool.RangeCount( self->n_, self->m_ ), 0. ) ;
+        pool.Ranges( self->n_, self->m_, [&]( size_t piece, size_t begin, size_t end ) {
+          for( size_t c=begin ; c<end ; c++ ) partial[piece] += f( self->data_ + c*self->ld_, self->m_, 1 ) ;
+        } ) ;
       }
+      double rc = 0 ;
+      for( size_t i=0 ; i<partial.size() ; i++ ) rc += partial[i] ;
+      return rc ;
+    }
 
-      return self ;
+    /*
+	The sum ( or sum of squares ) of the elements in a run. A contiguous
+	run uses the compensated SIMD sum, a strided one adds up in double.
+    */
+    static double SumRun( const float *a, int len, int stride, bool squares ) {
+      if( stride == 1 ) return Simd::Kernels().sum( a, len, squares ) ;
+      double rc = 0 ;
+      for( int i=0 ; i<len ; i++ ) {
+        double x = a[(size_t)i*stride] ;
+        rc += squares ? x * x : x ;
+      }
+      return rc ;
     }
 
-    static void ToString(const FunctionCallbackInfo<Value>& args);
-    static void Inspect(const FunctionCallbackInfo<Value>& args);
-    static void Ones(const FunctionCallbackInfo<Value>& args );
-    static void Zeros(const FunctionCallbackInfo<Value>& args );
-    static void Eye(const FunctionCallbackInfo<Value>& args );
-    static void Diag(const FunctionCallbackInfo<Value>& args );
-    static void Read(const FunctionCallbackInfo<Value>& args );
-    static void Rand(const FunctionCallbackInfo<Value>& args );
-    static void Dup(const FunctionCallbackInfo<Value>& args );
-    static void Find(const FunctionCallbackInfo<Value>& args );
-    static void FindGreater(const FunctionCallbackInfo<Value>& args );
-    static void FindLessEqual(const FunctionCallbackInfo<Value>& args );
-    static void Neg(const FunctionCallbackInfo<Value>& args );
-    static void Log(const FunctionCallbackInfo<Value>& args );
-    static void Sqrt(const FunctionCallbackInfo<Value>& args );
-    static void Abs(const FunctionCallbackInfo<Value>& args );
-    static void Transpose(const FunctionCallbackInfo<Value>& args );
-    static void Hadamard(const FunctionCallbackInfo<Value>& args );
-    static void Mul(const FunctionCallbackInfo<Value>& args );
-    static void Mulp(const FunctionCallbackInfo<Value>& args );
-    static void Asum( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Sum( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Mean( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Norm( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Add( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Sub( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Inv( const FunctionCallbackInfo<v8::Value>& args  );    
-    static void Invp( const FunctionCallbackInfo<v8::Value>& args  );    
-    static void Pinv( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Svd( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Pca( const FunctionCallbackInfo<v8::Value>& args  );
-    static void GetRows( const FunctionCallbackInfo<v8::Value>& args  );
-    static void RemoveRow( const FunctionCallbackInfo<v8::Value>& args  );
-    static void GetColumns( const FunctionCallbackInfo<v8::Value>& args  );
-    static void RemoveColumn( const FunctionCallbackInfo<v8::Value>& args  );
-    static void AppendColumns( const FunctionCallbackInfo<v8::Value>& args  );
-    static void RotateColumns( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Reshape( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Solve( const v8::FunctionCallbackInfo<v8::Value>& args ) ;
-    static void Solvep( const v8::FunctionCallbackInfo<v8::Value>& args ) ;
-    static void Get( const FunctionCallbackInfo<v8::Value>& args  );
-    static void Set( const FunctionCallbackInfo<v8::Value>& args  );
+    /* sum ( or sum the squares of ) each column into out[c], spread over the threads */
+    static void SumColumns( const WrappedArray *self, float *out, bool squares ) {
+      ThreadPool::Instance().Ranges( self->n_, self->m_, [&]( size_t, size_t begin, size_t end ) {
+        for( size_t c=begin ; c<end ; c++ ) out[c] = SumRun( self->data_ + c*self->ld_, self->m_, 1, squares ) ;
+      } ) ;
+    }
 
-    static void MakeIterator( const FunctionCallbackInfo<v8::Value>& args  );
+    /*
+	sum ( or sum the squares of ) each row into out[r]. Each thread takes
+	a block of rows and runs down the columns, so it reads memory in order.
+	The running sums are compensated, like a column sum.
+    */
+    static void SumRows( const WrappedArray *self, float *out, bool squares ) {
+      ThreadPool::Instance().Ranges( self->m_, self->n_, [&]( size_t, size_t begin, size_t end ) {
+        const SimdKernels &k = Simd::Kernels() ;
+        const size_t len = end - begin ;
+        std::vector<float> carry( len, 0.f ) ;
+        std::fill( out+begin, out+end, 0.f ) ;
+        for( int c=0 ; c<self->n_ ; c++ ) {
+          k.accumulate( self->data_ + (size_t)c*self->ld_ + begin, out+begin, carry.data(), len, squares ) ;
+        }
+        k.sub( out+begin, carry.data(), out+begin, len ) ;
+      } ) ;
+    }
 
-    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info);
-    static void SetCoeff(Local<String> property, Local<Value> value, const PropertyCallbackInfo<void>& info);
+    /* the summary of a column, @see Describe */
+    struct ColumnStats {
+      double mean ;
+      double m2 ;		/**< the sum of the squared differences from the mean */
+      float min, max ;
+      int argmin, argmax ;	/**< the first row holding the min & max */
+    } ;
 
-    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
-    int m_;  /**< the number of rows in the matrix */
-    int n_;  /**< the number of columns in the matrix */
-    float *data_ ;   /**< the data buffer holding the values */
-    bool isVector ; /**< helper flag to see whether the target is a vector Mx1 or 1xN */
-    int dataSize_ ;  /**< private - used to remember the last data allocation size */
-    int maxPrint_ ;  /**< the number of rows & columns to print out in toString() */
-    char *name_ ; /**< The name of this matrix - useful for keeping track of things */
+    /*
+	Summarize a column of m numbers in one pass over memory. Each block
+	is small enough to stay in cache while the moments kernel makes its
+	two passes. The blocks' means & squared differences are merged with
+	Chan's update, in double, and a block with a new min ( or max ) is
+	searched for its row.
+    */
+    static ColumnStats DescribeColumn( const float *a, int m ) {
+      const int block = 1024 ;
+      const SimdKernels &k = Simd::Kernels() ;
+      ColumnStats rc = { 0., 0., INFINITY, -INFINITY, 0, 0 } ;
+      double count = 0 ;
+      for( int i=0 ; i<m ; i+=block ) {
+        const int len = std::min( block, m-i ) ;
+        float stats[4] ;
+        k.moments( a+i, len, stats ) ;
+        const double delta = stats[0] - rc.mean ;
+        const double total = count + len ;
+        rc.mean += delta * len / total ;
+        rc.m2 += stats[1] + delta * delta * count * len / total ;
+        count = total ;
+        if( stats[2] < rc.min ) {
+          rc.min = stats[2] ;
+          rc.argmin = i + (int)( std::find( a+i, a+i+len, stats[2] ) - ( a+i ) ) ;
+        }
+        if( stats[3] > rc.max ) {
+          rc.max = stats[3] ;
+          rc.argmax = i + (int)( std::find( a+i, a+i+len, stats[3] ) - ( a+i ) ) ;
+        }
+      }
+      return rc ;
+    }
 
-    static void NextCallback( const v8::FunctionCallbackInfo<v8::Value>& args ) ;
-    static void DataCallback(const FunctionCallbackInfo<Value>& args) ;
-    static void DataEndCallback(const FunctionCallbackInfo<Value>& args) ;
-    static void PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, uv_work_cb work_cb, Local<Object> instance, Local<Object> xtraObj, int xtraInt  ) ;
-    static void PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, uv_work_cb work_cb, Local<Object> instance ) ;
+    /*
+	The log of the sum of the exps of each column ( dimension 0 ) or row
+	( dimension 1 ) into lse, N or M numbers. The biggest element is taken
+	off before the exp, so nothing overflows. If soft isn't NULL the
+	softmax, e^( a - lse ), is written there too - an MxN block with 
+	leading dimension lds, which may be the matrix itself.
+    */
+    static void LogSumExpOf( const WrappedArray *self, int dimension, float *lse, float *soft, int lds ) {
+      const SimdKernels &k = Simd::Kernels() ;
+      const int m = self->m_ ;
+      const int n = self->n_ ;
+      if( dimension == 0 ) {	// a column at a time
+        ThreadPool::Instance().Ranges( n, m, [&]( size_t, size_t begin, size_t end ) {
+          std::vector<float> scratch( soft == NULL ? m : 0 ) ;
+          for( size_t c=begin ; c<end ; c++ ) {
+            const float *a = self->data_ + c*self->ld_ ;
+            float *e = soft == NULL ? scratch.data() : soft + c*lds ;
+            float mx = -INFINITY ;
+            for( int r=0 ; r<m ; r++ ) mx = std::max( mx, a[r] ) ;
+            if( std::isinf( mx ) ) mx = 0 ;	// all -inf, or an inf: leave it to the arithmetic
+            k.subScalar( a, mx, e, m ) ;
+            k.exp( e, e, m ) ;
+            float sum = SumRun( e, m, 1, false ) ;
+            lse[c] = mx + ::logf( sum ) ;
+            if( soft != NULL ) k.mulScalar( e, 1.f / sum, e, m ) ;
+          }
+        } ) ;
+      } else {			// a block of rows, walking down the columns
+        ThreadPool::Instance().Ranges( m, n, [&]( size_t, size_t begin, size_t end ) {
+          const int len = (int)( end - begin ) ;
+          std::vector<float> mx( len, -INFINITY ), sum( len, 0.f ), scratch( soft == NULL ? len : 0 ) ;
+          for( int c=0 ; c<n ; c++ ) {
+            const float *a = self->data_ + (size_t)c*self->ld_ + begin ;
+            for( int r=0 ; r<len ; r++ ) mx[r] = std::max( mx[r], a[r] ) ;
+          }
+          for( int r=0 ; r<len ; r++ ) if( std::isinf( mx[r] ) ) mx[r] = 0 ;
+          for( int c=0 ; c<n ; c++ ) {
+            const float *a = self->data_ + (size_t)c*self->ld_ + begin ;
+            float *e = soft == NULL ? scratch.data() : soft + (size_t)c*lds + begin ;
+            k.sub( a, mx.data(), e, len ) ;
+            k.exp( e, e, len ) ;
+            k.add( sum.data(), e, sum.data(), len ) ;
+          }
+          for( int r=0 ; r<len ; r++ ) lse[begin+r] = mx[r] + ::logf( sum[r] ) ;
+          if( soft != NULL ) {
+            for( int r=0 ; r<len ; r++ ) sum[r] = 1.f / sum[r] ;
+            for( int c=0 ; c<n ; c++ ) {
+              float *e = soft + (size_t)c*lds + begin ;
+              k.mul( e, sum.data(), e, len ) ;
+            }
+          }
+        } ) ;
+      }
+    }
 
-    static void WorkAsyncComplete(uv_work_t *req,int status) ;
-    static void InvpWorkAsync(uv_work_t *req) ;
-    static void MulpWorkAsync(uv_work_t *req) ;
-    static void ReadWorkAsync(uv_work_t *req) ;
-    static void MulHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
-    static void InvHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
+    /*
+	c = alpha x a'a + beta x c for the MxN matrix a, or alpha x aa' + beta x c
+	if outer. ssyrk does half the flops of sgemm as it only writes the upper
+	triangle of c, the lower triangle is filled in from that.
+    */
+    static void SymmetricProduct( const float *a, int lda, int m, int n, bool outer, float alpha, float beta, float *c, int ldc ) {
+      const int size = outer ? m : n ;
+      cblas_ssyrk( CblasColMajor, CblasUpper, outer ? CblasNoTrans : CblasTrans, size, outer ? n : m,
+		alpha, a, std::max( 1, lda ), beta, c, std::max( 1, ldc ) ) ;
+      FillLower( c, size, ldc ) ;
+    }
 
-    static void SolveWorkAsync(uv_work_t *req) ;
-    static void SolveHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
+    /* copy the upper triangle of an NxN matrix over its lower triangle */
+    static void FillLower( float *c, int n, int ldc ) {
+      for( int j=0 ; j<n ; j++ ) {
+        for( int i=j+1 ; i<n ; i++ ) c[i + (size_t)j*ldc] = c[j + (size_t)i*ldc] ;
+      }
+    }
 
+    static const int CovarianceBlock = 1 << 20 ;	/**< the floats in cov's buffer of centered rows */
 
-    struct Work {
+    /*
+	The NxN covariance of the columns of self into c. With center the rows 
+	are taken off their column means into a buffer, a block of rows at a 
+	time, and each block is added in with ssyrk. So the extra memory is one
+	block however many rows there are. The sum is divided by M-1, or M if
+	the data isn't centered.
+    */
+    static void Covariance( const WrappedArray *self, bool center, float *c, int ldc ) {
+      const SimdKernels &k = Simd::Kernels() ;
+      const int m = self->m_ ;
+      const int n = self->n_ ;
+      const float scale = 1.f / std::max( 1, center ? m-1 : m ) ;
+      if( !center ) {
+        SymmetricProduct( self->data_, self->ld_, m, n, false, scale, 0.f, c, ldc ) ;
+        return ;
+      }
+      std::vector<float> mean( n ) ;
+      for( int j=0 ; j<n ; j++ ) mean[j] = (float)( k.sum( self->data_ + (size_t)j*self->ld_, m, false ) / std::max( 1, m ) ) ;
+
+      const int rows = std::max( 1, std::min( m, CovarianceBlock / std::max( 1, n ) ) ) ;
+      std::vector<float> block( (size_t)rows * n ) ;
+      for( int r=0 ; r==0 || r<m ; r+=rows ) {
+        const int len = std::min( rows, m-r ) ;
+        for( int j=0 ; j<n ; j++ ) {
+          k.subScalar( self->data_ + r + (size_t)j*self->ld_, mean[j], block.data() + (size_t)j*len, len ) ;
+        }
+        cblas_ssyrk( CblasColMajor, CblasUpper, CblasTrans, n, len, scale, block.data(), std::max( 1, len ),
+		r == 0 ? 0.f : 1.f, c, std::max( 1, ldc ) ) ;
+      }
+      FillLower( c, n, ldc ) ;
+    }
+
+    /*
+	The common spans of two MxN matrices, which may be views. Used to walk
+	an input and a result together. Column c of the span starts c*ld_ 
+	into each matrix.
+    */
+    static int SpanLength( const WrappedArray *a, const WrappedArray *b ) { 
+      return a->IsContiguous() && b->IsContiguous() ? a->m_*a->n_ : a->m_ ; 
+    }
+    static int SpanCount( const WrappedArray *a, const WrappedArray *b ) { 
+      return a->IsContiguous() && b->IsContiguous() ? 1 : a->n_ ; 
+    }
+
+    /*
+	Get the target of a method call. A disposed matrix can't be used,
+	that throws an exception and returns NULL.
+    */
+    static WrappedArray *Self( const FunctionCallbackInfo<Value>& args ) {
+      WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+      if( self->disposed_ ) {
+        Isolate* isolate = args.GetIsolate();
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Matrix has been disposed")));
+        args.GetReturnValue().Set( Undefined(isolate) );
+        return NULL ;
+      }
+      return self ;
+    }
+
+    /*
+	Is a javascript value one of our matrices?
+    */
+    static bool IsMatrix( Isolate *isolate, Local<Value> value ) {
+      if( !value->IsObject() ) return false ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return value->InstanceOf( isolate->GetCurrentContext(), cons ).FromMaybe( false ) ;
+    }
+
+    /*
+	Find the matrix an op should write into. That's the matrix passed in 
+	args[outIndex] if there is one, otherwise a new MxN matrix. Whichever
+	is used is set as the return value.
+	@return the matrix to write into, or NULL (with an exception thrown) if 
+	the out matrix is the wrong shape. The javascript object is put in instance
+	if that's given.
+    */
+    static WrappedArray *MakeResult( const FunctionCallbackInfo<Value>& args, int outIndex, int m, int n, Local<Object> *instance=NULL ) {
+      Isolate* isolate = args.GetIsolate();
+      return MakeResult( args, outIndex >= 0 ? args[outIndex] : Local<Value>( Undefined(isolate) ), m, n, instance ) ;
+    }
+
+    /*
+	The same, where the out matrix ( if it is one ) is given rather than 
+	its place in args - e.g. from an object of options.
+    */
+    static WrappedArray *MakeResult( const FunctionCallbackInfo<Value>& args, Local<Value> outValue, int m, int n, Local<Object> *instance=NULL ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Context> context = isolate->GetCurrentContext() ;
+
+      if( IsMatrix( isolate, outValue ) ) {
+        Local<Object> out = outValue->ToObject() ;
+        WrappedArray* result = ObjectWrap::Unwrap<WrappedArray>( out ) ;
+        if( result->m_ != m || result->n_ != n ) {
+          char *msg = new char[ 1000 ] ;
+          snprintf( msg, 1000, "Output matrix is |%d x %d| expected |%d x %d|", result->m_, result->n_, m, n ) ;
+          isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+          delete [] msg ;
+          args.GetReturnValue().Set( Undefined(isolate) );
+          return NULL ;
+        }
+        result->MakeWritable() ;
+        args.GetReturnValue().Set( out );
+        if( instance != NULL ) *instance = out ;
+        return result ;
+      }
+
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate,m ), Integer::New( isolate,n ) };
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      Local<Object> rc = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+      args.GetReturnValue().Set( rc );
+      if( instance != NULL ) *instance = rc ;
+      return ObjectWrap::Unwrap<WrappedArray>( rc ) ;
+    }
+
+    /*
+	The body of add, sub & hadamard and their in place versions.
+	The result is written to the target (inPlace), an out matrix in args[1]
+	or a new matrix.
+    */
+    template<class Op> static void BinaryHelper( const FunctionCallbackInfo<Value>& args, Op op, const char *symbol, bool inPlace ) {
+      Isolate* isolate = args.GetIsolate();
+
+      WrappedArray* self = Self( args ) ;
+      if( self == NULL ) return ;
+      WrappedArray* result = self ;
+      if( inPlace ) {
+        self->MakeWritable() ;
+        args.GetReturnValue().Set( args.Holder() );
+      } else {
+        result = MakeResult( args, 1, self->m_, self->n_ ) ;
+        if( result == NULL ) return ;
+      }
+
+      if( args[0]->IsNumber() ) { 
+        ApplyScalar( self, args[0]->NumberValue(), result, op ) ;
+      } else {
+        WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() );
+        if( !ApplyBinary( self, other, result, op ) ) { // incompatible types ...
+          char *msg = new char[ 1000 ] ;
+          snprintf( msg, 1000, "Incompatible args: |%d x %d| %s |%d x %d|", self->m_, self->n_, symbol, other->m_, other->n_ ) ;
+          isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+          delete [] msg ;
+          args.GetReturnValue().Set( Undefined(isolate) );
+        }
+      }
+    }
+
+    /*
+	The body of the single argument element wise functions (neg, sqrt ...) and
+	their in place versions. The result is written to the target (inPlace), an 
+	out matrix in args[0] or a new matrix.
+    */
+    template<class Op> static void UnaryHelper( const FunctionCallbackInfo<Value>& args, Op op, bool inPlace ) {
+      WrappedArray* self = Self( args ) ;
+      if( self == NULL ) return ;
+      WrappedArray* result = self ;
+      if( inPlace ) {
+        self->MakeWritable() ;
+        args.GetReturnValue().Set( args.Holder() );
+      } else {
+        result = MakeResult( args, 0, self->m_, self->n_ ) ;
+        if( result == NULL ) return ;
+      }
+      ApplyUnary( self, result, op ) ;
+    }
+
+    /*
+	Give a view its own copy of its data. Used before anything that changes
+	the shape of a matrix in place ( reshape, removeRow ... ) which would 
+	otherwise scramble the data of the matrix the view belongs to. A matrix
+	with spare rows ( @see Reserve ) is packed down to M x N too.
+    */
+    void Unshare() {
+      if( !isView_ && IsContiguous() ) return ;
+      Storage *storage = NewStorage( m_*n_ ) ;
+      CopyTo( storage->data ) ;
+      UseStorage( storage ) ;
+      ld_ = m_ ;
+    }
+
+    /*
+	Give a copy made by dup() its own data, if it's still sharing storage with 
+	another copy. Views never share that way - they always write through to 
+	the matrix they came from.
+    */
+    void CopyOnWrite() {
+      if( !isView_ && storage_ != NULL && !storage_->readOnly && storage_->refs > 1 && storage_->views == 0 ) {
+        Storage *storage = NewStorage( m_*n_ ) ;
+        CopyTo( storage->data ) ;
+        UseStorage( storage ) ;
+        ld_ = m_ ;
+      }
+    }
+
+    /*
+	Call before changing the data (or shape). Copies shared data, and data
+	in a read only mapping, and bumps the version so anything cached from 
+	the old data can be spotted.
+    */
+    void MakeWritable() {
+      if( storage_ != NULL && storage_->readOnly ) {	// a read only file - a view stops being a view here
+        Storage *storage = NewStorage( m_*n_ ) ;
+        CopyTo( storage->data ) ;
+        UseStorage( storage ) ;
+        ld_ = m_ ;
+      }
+      CopyOnWrite() ;
+      Touch() ;
+    }
+    void Touch() {
+      if( storage_ != NULL ) storage_->version = Storage::NextVersion() ;
+    }
+
+    /*
+	A matrix made symmetric by gram, cov ... is marked with the version of 
+	its data. Any write bumps the version, which drops the mark.
+    */
+    void MarkSymmetric() {
+      if( storage_ != NULL ) symmetric_ = storage_->version ;
+    }
+    bool IsSymmetric() const {
+      return m_ == n_ && storage_ != NULL && symmetric_ == storage_->version ;
+    }
+
+    /*
+	Move the data to a new buffer with room for ld rows and cols columns. The
+	shape is unchanged, any extra space is for growing into. 
+    */
+    void Regrow( int ld, int cols ) {
+      Storage *storage = NewStorage( ld*cols ) ;
+      for( int c=0 ; c<n_ ; c++ ) {
+        memcpy( storage->data + (size_t)c*ld, data_ + (size_t)c*ld_, m_*sizeof(float) ) ;
+      }
+      UseStorage( storage ) ;
+      ld_ = ld ;
+    }
+
+    /*
+	Get ready to grow in place to rows x cols. Views & shared data get their
+	own copy, then if there's not enough room the data moves to a buffer with
+	room to spare - twice the current size - so a run of appends only copies
+	the data a few times.
+    */
+    void Grow( int rows, int cols ) {
+      if( isView_ ) Unshare() ;
+      MakeWritable() ;
+      if( rows <= ld_ && (size_t)ld_*cols <= (size_t)dataSize_ ) return ;
+      int ld = rows <= ld_ ? ld_ : std::max( rows, 2*m_ ) ;
+      int capCols = std::max( cols, std::max( 2*n_, n_+16 ) ) ;
+      if( rows > ld_ && cols <= n_ ) capCols = cols ;	// only growing the rows 
+      Regrow( ld, capCols ) ;
+    }
+
+    /*
+	Move the data to a new storage - from the pool or the enclosing scope. 
+	Used to keep a matrix returned from a scope. A view becomes a normal matrix.
+    */
+    void Promote() {
+      scopeId_ = Scope::CurrentId() ;
+      Storage *storage = Storage::New( m_*n_, scopeId_ ) ;
+      CopyTo( storage->data ) ;
+      UseStorage( storage ) ;
+      ld_ = m_ ;
+    }
+
+    /*
+	Drop the data and become a 0x0 matrix. Used on matrices left over when 
+	a scope ends.
+    */
+    void Empty() {
+      UseStorage( Storage::New( 0 ) ) ;
+      scopeId_ = 0 ;
+      m_ = n_ = ld_ = 0 ;
+      isVector = false ;
+    }
+
+    /*
+	Forget the Float32Array views of data_ handed out by AsFloat32Array. 
+	When data_ is about to be freed or moved the views are detached (neutered)
+	so javascript sees an empty array rather than stale memory. The destructor
+	must not touch the javascript heap - and any view would have kept us alive
+	anyway - so it just drops the handles.
+    */
+    void DetachViews( bool neuter ) {
+      if( views_.empty() ) return ;
+      Isolate *isolate = Isolate::GetCurrent() ;
+      for( size_t i=0 ; i<views_.size() ; i++ ) {
+        if( neuter && !views_[i]->IsEmpty() ) {
+          HandleScope scope(isolate) ;
+          Local<ArrayBuffer> ab = Local<ArrayBuffer>::New( isolate, *views_[i] ) ;
+          ab->DeletePrivate( isolate->GetCurrentContext(), ViewOwnerKey( isolate ) ) ;
+          if( ab->IsNeuterable() ) ab->Neuter() ;
+        }
+        views_[i]->Reset() ;
+        delete views_[i] ;
+      }
+      views_.clear() ;
+    }
+
+    static Local<Private> ViewOwnerKey( Isolate *isolate ) {
+      return Private::ForApi( isolate, String::NewFromUtf8(isolate, "lalg:viewOwner") ) ;
+    }
+
+    /*
+	The javascript constructor.
+	It takes up to 3 args: 
+	@param [in] number of rows (m) defaults to 0
+	@param [in] number of columns (n) defaults to m
+	@param [in] optional an array of data to use for the array (column major order) or a number to put in all elements
+    */
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
+      Isolate* isolate = args.GetIsolate();
+
+      // in a constructor? Which one?
+
+      if (args.IsConstructCall()) {
+
+        WrappedArray* self = NULL ;	// will fill this up later
+
+        int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue();
+        int n = args[1]->IsUndefined() ? m : args[1]->NumberValue();
+
+	// Do we have a typed array or a buffer to use (without copying) for data?
+        if( args[2]->IsFloat32Array() || args[2]->IsFloat64Array() ||
+            args[2]->IsArrayBuffer() || args[2]->IsSharedArrayBuffer() ) {
+          self = Create(m, n, isolate, args[2] ) ;
+	// Do we have an array to use for data?
+        } else if( !args[2]->IsUndefined() && args[2]->IsArray() ) {
+
+          Local<Array> buffer = Local<Array>::Cast(args[2]->ToObject() );
+
+          Local<Context> context = isolate->GetCurrentContext() ;
+          self = Create(m, n, context, buffer )	;
+        } else {  // No array? just create it
+          self = Create(m, n) ;
+          if( !args[2]->IsUndefined() && args[2]->IsNumber() ) {
+	    float v = args[2]->NumberValue() ;
+	    for( int i=0 ; i<m*n ; ++i) {
+	      self->data_[i] = v ;
+	    }
+	  }
+        }
+
+        if( self != NULL ) {  // double check we managed to create something
+          self->Wrap(args.This());
+//          args.This()->SetInternalField(0, External::New(isolate, self));
+          args.GetReturnValue().Set(args.This());
+        }
+        else {
+          args.GetReturnValue().Set( Undefined(isolate) ) ;
+        }
+      }
+    }
+
+/**
+	Create an array with some data provided in a javascript Array
+*/
+    static WrappedArray *Create( 
+	int m, /**< [in] number of rows in the matrix */
+	int n, /**< [in] number of cols in the matrix */
+	Local<Context> context, Local<Array> array /**< [in] data to put into the array - column major order */ 
+	) {
+
+      WrappedArray* self = new WrappedArray(m, n) ;
+
+	// Copy the minimum of ( input array size & internal buffer size ) numbers
+        // into the internal buffer
+        int l = array->Length() ;
+        l = std::min( self->m_*self->n_, l ) ;
+        for( int i=0 ; i<l ; i++ ) {
+          self->data_[i] = array->Get( context, i ).ToLocalChecked()->NumberValue() ;
+        }
+      return self ;
+    }
+
+/**
+	Create an array on top of the memory of a javascript buffer
+	@see Adopt
+*/
+    static WrappedArray *Create( 
+	int m, /**< [in] number of rows in the matrix */
+	int n, /**< [in] number of cols in the matrix */
+	Isolate *isolate, Local<Value> buffer /**< [in] the typed array or buffer holding the data - column major order */ 
+	) {
+      WrappedArray* self = new WrappedArray() ;
+      if( !self->Adopt( isolate, buffer, m, n ) ) {
+        delete self ;
+        return NULL ;
+      }
+      return self ;
+    }
+
+/**
+	Use the memory of a javascript buffer for this matrix's data.
+
+	A Float32Array, ArrayBuffer or SharedArrayBuffer is used in place, the
+	matrix and the buffer share their data, so changes to one are seen in the
+	other. The matrix keeps the buffer alive, but never frees its memory.
+	Any other typed array is taken as raw bytes of floats (e.g. a nodejs Buffer
+	read from a file) except a Float64Array, which is converted to new memory.
+	If the memory isn't aligned to a float it is copied.
+
+	Throws and returns false if the buffer is too small for the matrix.
+*/
+    bool Adopt( Isolate *isolate, Local<Value> buffer, int m, int n ) {
+      size_t count = (size_t)m * n ;
+      Local<Object> backing ;	// the object that owns the memory
+      char *bytes = NULL ;
+      size_t byteLength = 0 ;
+
+      if( buffer->IsArrayBufferView() ) {
+        Local<ArrayBufferView> view = Local<ArrayBufferView>::Cast( buffer ) ;
+        Local<ArrayBuffer> ab = view->Buffer() ;
+        bytes = (char*)ab->GetContents().Data() + view->ByteOffset() ;
+        byteLength = view->ByteLength() ;
+        backing = ab ;
+      } else if( buffer->IsSharedArrayBuffer() ) {
+        Local<SharedArrayBuffer> sab = Local<SharedArrayBuffer>::Cast( buffer ) ;
+        bytes = (char*)sab->GetContents().Data() ;
+        byteLength = sab->ByteLength() ;
+        backing = sab ;
+      } else {
+        Local<ArrayBuffer> ab = Local<ArrayBuffer>::Cast( buffer ) ;
+        bytes = (char*)ab->GetContents().Data() ;
+        byteLength = ab->ByteLength() ;
+        backing = ab ;
+      }
+
+      bool isDouble = buffer->IsFloat64Array() ;
+      if( byteLength < count * ( isDouble ? sizeof(double) : sizeof(float) ) ) {
+        char *msg = new char[ 1000 ] ;
+        snprintf( msg, 1000, "Buffer of %lu bytes is too small for |%d x %d|", (unsigned long)byteLength, m, n ) ;
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+        delete [] msg ;
+        return false ;
+      }
+
+      if( isDouble || ( (uintptr_t)bytes % sizeof(float) ) != 0 ) {
+        // doubles or misaligned floats - take a copy
+        UseStorage( NewStorage( count ) ) ;
+        if( isDouble ) {
+          double *src = (double*)bytes ;
+          for( size_t i=0 ; i<count ; i++ ) {
+            data_[i] = src[i] ;
+          }
+        } else {
+          memcpy( data_, bytes, count * sizeof(float) ) ;
+        }
+      } else {
+        Storage *storage = new Storage() ;
+        storage->data = (float*)bytes ;
+        storage->capacity = byteLength / sizeof(float) ;
+        storage->backing.Reset( isolate, backing ) ;
+        UseStorage( storage ) ;
+      }
+      m_ = m ;
+      n_ = n ;
+      ld_ = m ;
+      isVector = m==1 || n== 1 ;
+      return true ;
+    }
+
+/**
+	Create an array with some (optional) data. This will be the base call
+	for creation for internal methods.
+	
+*/
+    static WrappedArray *Create( 
+	int m, /**< [in] number of rows in the matrix */
+	int n, /**< [in] number of cols in the matrix */
+	float *data = NULL /**< [in] data to put into the array - column major order */ 
+	) {
+      WrappedArray* self = new WrappedArray(m, n);
+
+      if( data != NULL ) {
+        for( int i=0 ; i<(m*n) ; i++ ) {
+          self->data_[i] = data[i] ;
+        }
+      }
+
+      return self ;
+    }
+
+    static void ToString(const FunctionCallbackInfo<Value>& args);
+    static void Inspect(const FunctionCallbackInfo<Value>& args);
+    static void Ones(const FunctionCallbackInfo<Value>& args );
+    static void Zeros(const FunctionCallbackInfo<Value>& args );
+    static void Eye(const FunctionCallbackInfo<Value>& args );
+    static void Diag(const FunctionCallbackInfo<Value>& args );
+    static void Read(const FunctionCallbackInfo<Value>& args );
+    static void FromBuffer(const FunctionCallbackInfo<Value>& args );
+    static void MMap(const FunctionCallbackInfo<Value>& args );
+    static void RunInScope(const FunctionCallbackInfo<Value>& args );
+    static void Dispose(const FunctionCallbackInfo<Value>& args );
+    static void EndScope( Isolate *isolate, Scope *scope, Local<Value> keep ) ;
+    static void Rand(const FunctionCallbackInfo<Value>& args );
+    static void PoolStats(const FunctionCallbackInfo<Value>& args );
+    static void SetPoolLimit(const FunctionCallbackInfo<Value>& args );
+    static void SetThreads(const FunctionCallbackInfo<Value>& args );
+    static void Map(const FunctionCallbackInfo<Value>& args );
+    static void Dup(const FunctionCallbackInfo<Value>& args );
+    static void Find(const FunctionCallbackInfo<Value>& args );
+    static void FindGreater(const FunctionCallbackInfo<Value>& args );
+    static void FindLessEqual(const FunctionCallbackInfo<Value>& args );
+    static void Neg(const FunctionCallbackInfo<Value>& args );
+    static void Negi(const FunctionCallbackInfo<Value>& args );
+    static void Log(const FunctionCallbackInfo<Value>& args );
+    static void Logi(const FunctionCallbackInfo<Value>& args );
+    static void Sqrt(const FunctionCallbackInfo<Value>& args );
+    static void Sqrti(const FunctionCallbackInfo<Value>& args );
+    static void Abs(const FunctionCallbackInfo<Value>& args );
+    static void Absi(const FunctionCallbackInfo<Value>& args );
+    static void Exp(const FunctionCallbackInfo<Value>& args );
+    static void Expi(const FunctionCallbackInfo<Value>& args );
+    static void Tanh(const FunctionCallbackInfo<Value>& args );
+    static void Tanhi(const FunctionCallbackInfo<Value>& args );
+    static void Sigmoid(const FunctionCallbackInfo<Value>& args );
+    static void Sigmoidi(const FunctionCallbackInfo<Value>& args );
+    static void Relu(const FunctionCallbackInfo<Value>& args );
+    static void Relui(const FunctionCallbackInfo<Value>& args );
+    static void Softplus(const FunctionCallbackInfo<Value>& args );
+    static void Softplusi(const FunctionCallbackInfo<Value>& args );
+    static void Softmax(const FunctionCallbackInfo<Value>& args );
+    static void LogSumExp(const FunctionCallbackInfo<Value>& args );
+    static void CrossEntropy(const FunctionCallbackInfo<Value>& args );
+    static void Transpose(const FunctionCallbackInfo<Value>& args );
+    static void Transposei(const FunctionCallbackInfo<Value>& args );
+    static void T(const FunctionCallbackInfo<Value>& args );
+    static void Hadamard(const FunctionCallbackInfo<Value>& args );
+    static void Hadamardi(const FunctionCallbackInfo<Value>& args );
+    static void Mul(const FunctionCallbackInfo<Value>& args );
+    static void Mulp(const FunctionCallbackInfo<Value>& args );
+    static void Asum( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Sum( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Mean( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Norm( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Describe( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Add( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Addi( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Sub( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Subi( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Inv( const FunctionCallbackInfo<v8::Value>& args  );    
+    static void Invp( const FunctionCallbackInfo<v8::Value>& args  );    
+    static void SolveLinear( const FunctionCallbackInfo<v8::Value>& args  );
+    static void SolveLinearp( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Lu( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Lup( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Chol( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Cholp( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Qr( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Qrp( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Pinv( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Pinvp( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Svd( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Pca( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Gram( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Cov( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Corr( const FunctionCallbackInfo<v8::Value>& args  );
+    static WrappedArray *CovarianceHelper( const FunctionCallbackInfo<v8::Value>& args  );
+    static void GetRows( const FunctionCallbackInfo<v8::Value>& args  );
+    static void RemoveRow( const FunctionCallbackInfo<v8::Value>& args  );
+    static void GetColumns( const FunctionCallbackInfo<v8::Value>& args  );
+    static void View( const FunctionCallbackInfo<v8::Value>& args  );
+    static void ViewRows( const FunctionCallbackInfo<v8::Value>& args  );
+    static void ViewColumns( const FunctionCallbackInfo<v8::Value>& args  );
+    static void MakeView( const FunctionCallbackInfo<v8::Value>& args, WrappedArray *self, int r0, int c0, int rows, int cols );
+    static void RemoveColumn( const FunctionCallbackInfo<v8::Value>& args  );
+    static void AppendColumns( const FunctionCallbackInfo<v8::Value>& args  );
+    static void AppendColumnsi( const FunctionCallbackInfo<v8::Value>& args  );
+    static void AppendRows( const FunctionCallbackInfo<v8::Value>& args  );
+    static void AppendRowsi( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Reserve( const FunctionCallbackInfo<v8::Value>& args  );
+    static void ShrinkToFit( const FunctionCallbackInfo<v8::Value>& args  );
+    static void RotateColumns( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Reshape( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Solve( const v8::FunctionCallbackInfo<v8::Value>& args ) ;
+    static void Solvep( const v8::FunctionCallbackInfo<v8::Value>& args ) ;
+    static void Get( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Set( const FunctionCallbackInfo<v8::Value>& args  );
+    static void AsFloat32Array( const FunctionCallbackInfo<v8::Value>& args  );
+    static void ToFloat32Array( const FunctionCallbackInfo<v8::Value>& args  );
+    static void ToArray64( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Quantize( const FunctionCallbackInfo<v8::Value>& args  );
+    static void Lazy( const FunctionCallbackInfo<v8::Value>& args  );
+
+    static void MakeIterator( const FunctionCallbackInfo<v8::Value>& args  );
+
+    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info);
+    static void SetCoeff(Local<String> property, Local<Value> value, const PropertyCallbackInfo<void>& info);
+
+    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
+    int m_;  /**< the number of rows in the matrix */
+    int n_;  /**< the number of columns in the matrix */
+    int ld_; /**< the leading dimension - the distance between columns in data_, M except for views */
+    float *data_ ;   /**< the data buffer holding the values */
+    bool isVector ; /**< helper flag to see whether the target is a vector Mx1 or 1xN */
+    int dataSize_ ;  /**< private - the capacity (in floats) of the data buffer */
+    int maxPrint_ ;  /**< the number of rows & columns to print out in toString() */
+    char *name_ ; /**< The name of this matrix - useful for keeping track of things */
+    Storage *storage_ ; /**< the memory holding data_, maybe shared with other matrices */
+    bool isView_ ;  /**< is this a view - sharing storage with another matrix */
+    int busy_ ;     /**< the number of background (uv) jobs using this matrix */
+    bool disposed_ ; /**< has dispose() been called - the matrix can't be used */
+    unsigned long scopeId_ ; /**< the scope this matrix was made in, 0 if none */
+    unsigned long symmetric_ ; /**< the version of the data when it was made symmetric, @see IsSymmetric */
+    std::vector< Persistent<ArrayBuffer>* > views_ ; /**< weak handles to the ArrayBuffers exposing data_ to javascript */
+
+    static void NextCallback( const v8::FunctionCallbackInfo<v8::Value>& args ) ;
+    static void DataCallback(const FunctionCallbackInfo<Value>& args) ;
+    static void DataEndCallback(const FunctionCallbackInfo<Value>& args) ;
+    static void PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, uv_work_cb work_cb, Local<Object> instance, Local<Object> xtraObj, int xtraInt, float xtraFloat=0.f, WrappedArray *target=NULL, void *xtraPtr=NULL, WrappedArray *other=NULL, float alpha=1.f, Local<Object> returned=Local<Object>() ) ;
+    static void PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, uv_work_cb work_cb, Local<Object> instance ) ;
+
+    static void WorkAsyncComplete(uv_work_t *req,int status) ;
+    static void InvpWorkAsync(uv_work_t *req) ;
+    static void PinvWorkAsync(uv_work_t *req) ;
+    static void MulpWorkAsync(uv_work_t *req) ;
+    static void ReadWorkAsync(uv_work_t *req) ;
+    static void MulHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
+    static void InvHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
+    static void PinvHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
+
+    static void SolveWorkAsync(uv_work_t *req) ;
+    static void SolveHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
+    static void SolveLinearWorkAsync(uv_work_t *req) ;
+    static void SolveLinearHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) ;
+    static bool IsSymmetricData( const float *a, int n, int lda ) ;
+    static void FactorHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, int kind ) ;
+
+
+    struct Work {
       uv_work_t  request;
       Persistent<Function> callback;
       Persistent<Promise::Resolver> resolver ;
@@ -316,402 +1504,3118 @@ class WrappedArray : public node::ObjectWrap
       Persistent<Object> resultLocal;
       Persistent<Object> selfObj;
       Persistent<Object> xtraObj;
+      Persistent<Object> holderObj;	/**< keeps self alive while the work is queued */
+      Persistent<Object> otherObj;	/**< keeps other alive while the work is queued */
       Isolate *isolate ;
       int xtraInt;
+      float xtraFloat;
+      void *xtraPtr;	/**< the C++ side of xtraObj, for work on a sparse or quantized matrix */
+      float alpha;	/**< the multiple of the product, for mul */
+    } ;
+
+class UserGradientFunction : public cppoptlib::Problem<float, 2> {
+  public:
+    using typename cppoptlib::Problem<float, 2>::TVector;
+    using typename cppoptlib::Problem<float, 2>::THessian;
+
+
+    UserGradientFunction( Isolate* isolate, WrappedArray* self, Local<Object> instance, Local<Object> suppliedFunctionHolder ) {
+
+	Local<Context> context = isolate->GetCurrentContext() ;
+/*
+  {
+    Local<String> className = suppliedFunctionHolder->GetConstructorName() ;
+    char *c = new char[className->Utf8Length() + 10 ] ;
+    className->WriteUtf8( c ) ;
+    printf( "Self sfh ... %s\n", c ) ;
+    delete [] c ;
+  }
+*/
+	Local<String> valueKey = String::NewFromUtf8(isolate, "value") ;
+suppliedFunctionHolder->GetPropertyNames( context ) ;
+        MaybeLocal<Value> mlv = suppliedFunctionHolder->Get( context, String::NewFromUtf8(isolate, "value") ) ;
+
+	Local<Value> valuetmp = suppliedFunctionHolder->Get( context, String::NewFromUtf8(isolate, "value") ).ToLocalChecked() ;
+	value_ = Local<Function>::Cast( valuetmp ) ;
+	Local<Value> gradtmp = suppliedFunctionHolder->Get( context, String::NewFromUtf8(isolate, "gradient") ).ToLocalChecked() ;
+	gradient_ = Local<Function>::Cast( gradtmp ) ;
+	self_ = self ;
+	isolate_ = isolate ;
+	instance_ = instance ;
+    }
+    
+    float value(const TVector &x) {
+	for( int i=0 ; i<self_->m_ * self_->n_ ; i++ ) {
+		self_->Elem(i) = x[i] ;
+	}
+        Handle<Value> argv[] = { instance_ } ;
+        MaybeLocal<Value> value = value_ -> Call(isolate_->GetCurrentContext()->Global(), 1, argv) ;
+	for( int i=0 ; i<self_->m_ * self_->n_ ; i++ ) {
+		self_->Elem(i) = x[i] ;
+	}
+  	
+	float rc = value.ToLocalChecked()->NumberValue() ;
+	return rc ;
+    }
+
+
+    void gradient(const TVector &x, TVector &grad) {
+	for( int i=0 ; i<self_->m_ * self_->n_ ; i++ ) {
+		self_->Elem(i) = x[i] ;
+	}
+        Handle<Value> argv[] = { instance_ } ;
+        Local<Value> obj = gradient_ -> Call(isolate_->GetCurrentContext()->Global(), 1, argv) ;
+
+	WrappedArray *gradient = WrappedArray::ObjectWrap::Unwrap<WrappedArray>( obj->ToObject() );
+
+	for( int i=0 ; i<gradient->m_*gradient->n_ ; i++ ) {
+	  grad[i] = gradient->Elem(i) ;
+	}
+    }
+
+   private:
+	Local<Function> value_ ;
+	Local<Function> gradient_ ;
+	WrappedArray* self_ ;
+	Isolate* isolate_ ;
+	Local<Object> instance_ ;
+
+};
+
+
+} ;
+Persistent<Function> WrappedArray::constructor;
+
+
+/**
+ A matrix with a wider element type - lalg.Array64 is a TypedMatrix<double>.
+
+ Some problems need more precision than a float gives, e.g. the normal 
+ equations of a badly conditioned regression, or anything that sums many
+ small numbers. This has the same layout as WrappedArray - column major,
+ m_ rows and n_ columns - but every element is a T, and the BLAS & LAPACK
+ calls go through Blas<T>, so they're the d* routines for a double.
+
+ Only the dense core is here: construction, element access, add, sub,
+ hadamard, mul, transpose, sums, inv, pinv & svd. Move between the 
+ precisions with toArray() and lalg.Array's toArray64(). The element wise
+ operators run through WrappedArray's ApplyBinary & ApplyScalar, and the
+ float matrices call BLAS & LAPACK through Blas<float> too, so most of 
+ what's here is the javascript wrapping.
+
+ The data comes from the buffer pool like any other matrix ( and is 
+ reported to V8 the same way ), but these matrices are always packed, never
+ views, never in a scope's arena and never mapped files.
+*/
+template<class T>
+class TypedMatrix : public node::ObjectWrap
+{
+  public:
+    /*
+	Define the javascript class, called when the module is loaded
+    */
+    static void Init( Local<Object> exports, const char *className ) {
+      Isolate* isolate = exports->GetIsolate();
+
+      Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+      tpl->SetClassName(String::NewFromUtf8(isolate, className));
+      tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toString", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "inspect", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "dup", Dup);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "get", Get);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "set", Set);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "transpose", Transpose);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "add", Add);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sub", Sub);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "hadamard", Hadamard);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "mul", Mul);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sum", Sum);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "asum", Asum);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "norm", Norm);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "inv", Inv);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "pinv", Pinv);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "svd", Svd);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toArray", ToArray);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toFloat64Array", ToFloat64Array);
+
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "m"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "n"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "length"), GetCoeff);
+
+      constructor.Reset(isolate, tpl->GetFunction());
+      exports->Set(String::NewFromUtf8(isolate, className), tpl->GetFunction());
+    }
+
+    /*
+	A new, uninitialized, MxN matrix as a javascript object
+    */
+    static Local<Object> NewMatrix( Isolate *isolate, int m, int n ) {
+      Local<Context> context = isolate->GetCurrentContext() ;
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate, m ), Integer::New( isolate, n ) };
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+    }
+
+    /*
+	Is a javascript value one of these matrices?
+    */
+    static bool IsMatrix( Isolate *isolate, Local<Value> value ) {
+      if( !value->IsObject() ) return false ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return value->InstanceOf( isolate->GetCurrentContext(), cons ).FromMaybe( false ) ;
+    }
+
+    int m_;  /**< the number of rows in the matrix */
+    int n_;  /**< the number of columns in the matrix */
+    T *data_ ;   /**< the data, always packed - the leading dimension is m_ */
+
+  private:
+    static const int MaxPrint = 10 ;	/**< the number of rows & columns to print out in toString() */
+
+    explicit TypedMatrix( int m=0, int n=0 ) : m_(m), n_(n) {
+      storage_ = Storage::New( Floats( m*n ) ) ;
+      data_ = (T*)storage_->data ;
+    }
+
+    ~TypedMatrix() {
+      storage_->Release() ;
+    }
+
+    /* the number of floats of storage needed to hold count elements */
+    static int Floats( int count ) {
+      return (int)( ( (size_t)count * sizeof(T) + sizeof(float) - 1 ) / sizeof(float) ) ;
+    }
+
+    static void Throw( Isolate *isolate, const char *msg ) {
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    }
+
+    /*
+	The javascript constructor.
+	@param [in] number of rows (m) defaults to 0
+	@param [in] number of columns (n) defaults to m
+	@param [in] optional an Array, Float64Array or Float32Array of data (column major order) or a number to put in all elements
+    */
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
+      Isolate* isolate = args.GetIsolate();
+      if( !args.IsConstructCall() ) return ;
+
+      int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue();
+      int n = args[1]->IsUndefined() ? m : args[1]->NumberValue();
+      TypedMatrix<T>* self = new TypedMatrix<T>( m, n ) ;
+      int sz = m * n ;
+
+      if( args[2]->IsFloat64Array() || args[2]->IsFloat32Array() ) {
+        Local<v8::TypedArray> array = Local<v8::TypedArray>::Cast( args[2] ) ;
+        const char *base = (const char*)array->Buffer()->GetContents().Data() + array->ByteOffset() ;
+        int l = std::min( sz, (int)array->Length() ) ;
+        if( args[2]->IsFloat64Array() ) {
+          for( int i=0 ; i<l ; i++ ) self->data_[i] = ((const double*)base)[i] ;
+        } else {
+          for( int i=0 ; i<l ; i++ ) self->data_[i] = ((const float*)base)[i] ;
+        }
+      } else if( args[2]->IsArray() ) {
+        Local<Context> context = isolate->GetCurrentContext() ;
+        Local<Array> array = Local<Array>::Cast( args[2] ) ;
+        int l = std::min( sz, (int)array->Length() ) ;
+        for( int i=0 ; i<l ; i++ ) {
+          self->data_[i] = array->Get( context, i ).ToLocalChecked()->NumberValue() ;
+        }
+      } else if( args[2]->IsNumber() ) {
+        T v = args[2]->NumberValue() ;
+        for( int i=0 ; i<sz ; i++ ) self->data_[i] = v ;
+      }
+
+      self->Wrap(args.This());
+      args.GetReturnValue().Set(args.This());
+    }
+
+    /** 
+	returns a string representation of the matrix, up to 10 rows and columns
+    */
+    static void ToString( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+
+      int mm = std::min( self->m_, (int)MaxPrint ) ;
+      int nn = std::min( self->n_, (int)MaxPrint ) ;
+      std::string rc ;
+      char buf[ 100 ] ;
+      snprintf( buf, sizeof(buf), "%d x %d %s\n", self->m_, self->n_, ( self->m_==1 || self->n_==1 ) ? "Vector" : "" ) ;
+      rc += buf ;
+      for( int r=0 ; r<mm ; r++ ) {
+        for( int c=0 ; c<nn ; c++ ) {
+          snprintf( buf, sizeof(buf), "% 10.6f ", (double)self->data_[ c * self->m_ + r ] ) ;
+          rc += buf ;
+        }
+        if( self->n_ > nn ) rc += " ..." ;
+        rc += "\n" ;
+      }
+      if( self->m_ > mm ) {
+        for( int i=0 ; i<nn ; i++ ) rc += "    ...    " ;
+        rc += "\n" ;
+      }
+      args.GetReturnValue().Set( String::NewFromUtf8( isolate, rc.c_str() ) );
+    }
+
+    /*
+	Find the element at (args[first], args[first+1]) - or the absolute index
+	args[first] if there's no column. Negative indices count from the end.
+	@return the index into data_ or -1 ( an exception is thrown ) if out of bounds
+    */
+    static int Index( const v8::FunctionCallbackInfo<v8::Value>& args, TypedMatrix<T> *self, int first ) {
+      Isolate* isolate = args.GetIsolate();
+      int m = args[first]->IsUndefined() ? 0 : args[first]->NumberValue() ;
+      char msg[ 1000 ] ;
+      if( args[first+1]->IsUndefined() ) {
+        int len = self->m_ * self->n_ ;
+        if( m >= len || m < -len ) {
+          snprintf( msg, sizeof(msg), "Array index (%d) out of bounds, max length is %d", m, len-1 ) ;
+          Throw( isolate, msg ) ;
+          return -1 ;
+        }
+        return m < 0 ? len + m : m ;
+      }
+      int n = args[first+1]->NumberValue() ;
+      if( m >= self->m_ || m < -self->m_ || n >= self->n_ || n < -self->n_ ) {
+        snprintf( msg, sizeof(msg), "Array index (%d,%d) out of bounds  for matrix |%d x %d|", m, n, self->m_, self->n_ ) ;
+        Throw( isolate, msg ) ;
+        return -1 ;
+      }
+      if( m<0 ) m += self->m_ ;
+      if( n<0 ) n += self->n_ ;
+      return m + n * self->m_ ;
+    }
+
+    /** 
+	Get a value from the matrix @see WrappedArray::Get
+	@param [in,default=0] M the row index ( or the absolute index is N is missing )
+	@param [in,optional] N the column index
+    */
+    static void Get( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      int ix = Index( args, self, 0 ) ;
+      if( ix >= 0 ) args.GetReturnValue().Set( (double)self->data_[ix] );
+    }
+
+    /** 
+	Set a value in the matrix @see WrappedArray::Set
+	@param [in] value to set into the matrix
+	@param [in,default=0] M the row index ( or the absolute index is N is missing )
+	@param [in,optional] N the column index
+	@return the previous value
+    */
+    static void Set( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      if( args[0]->IsUndefined() ) {
+        Throw( isolate, "Missing value to set into a matrix" ) ;
+        return ;
+      }
+      int ix = Index( args, self, 1 ) ;
+      if( ix >= 0 ) {
+        args.GetReturnValue().Set( (double)self->data_[ix] );
+        self->data_[ix] = args[0]->NumberValue() ;
+      }
+    }
+
+    /** Duplicate a matrix - this is always a copy */
+    static void Dup( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      Local<Object> instance = NewMatrix( isolate, self->m_, self->n_ ) ;
+      TypedMatrix<T>* result = ObjectWrap::Unwrap<TypedMatrix<T> >( instance ) ;
+      memcpy( result->data_, self->data_, (size_t)self->m_ * self->n_ * sizeof(T) ) ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /** Transpose a matrix into a new NxM matrix */
+    static void Transpose( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      Local<Object> instance = NewMatrix( isolate, self->n_, self->m_ ) ;
+      TypedMatrix<T>* result = ObjectWrap::Unwrap<TypedMatrix<T> >( instance ) ;
+      Transposer::Copy( self->data_, self->m_, self->m_, self->n_, result->data_, self->n_ ) ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /*
+	add, sub & hadamard. The other argument is a number, a matrix of the
+	same size, a row vector ( applied to each row ) or a column vector ( 
+	applied to each column ), the same as the float matrices.
+    */
+    template<class Op> static void BinaryHelper( const FunctionCallbackInfo<Value>& args, Op op, const char *symbol ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      int m = self->m_ ;
+      int n = self->n_ ;
+
+      if( !args[0]->IsNumber() && !IsMatrix( isolate, args[0] ) ) {
+        Throw( isolate, "Expected a number or a matrix of the same type" ) ;
+        return ;
+      }
+      Local<Object> instance = NewMatrix( isolate, m, n ) ;
+      TypedMatrix<T>* result = ObjectWrap::Unwrap<TypedMatrix<T> >( instance ) ;
+
+      // the same broadcasting ( and thread pool ) as the float matrices
+      if( args[0]->IsNumber() ) {
+        WrappedArray::ApplyScalar( m, n, self->data_, m, (T)args[0]->NumberValue(), result->data_, m, op ) ;
+      } else {
+        TypedMatrix<T>* other = ObjectWrap::Unwrap<TypedMatrix<T> >( args[0]->ToObject() );
+        if( !WrappedArray::ApplyBinary( m, n, (const T*)self->data_, m, other->m_, other->n_, (const T*)other->data_, other->m_, result->data_, m, op ) ) {
+          char msg[ 1000 ] ;
+          snprintf( msg, sizeof(msg), "Incompatible args: |%d x %d| %s |%d x %d|", m, n, symbol, other->m_, other->n_ ) ;
+          Throw( isolate, msg ) ;
+          return ;
+        }
+      }
+      args.GetReturnValue().Set( instance );
+    }
+
+    static void Add( const v8::FunctionCallbackInfo<v8::Value>& args ) { BinaryHelper( args, AddOp(), "+" ) ; }
+    static void Sub( const v8::FunctionCallbackInfo<v8::Value>& args ) { BinaryHelper( args, SubOp(), "-" ) ; }
+    static void Hadamard( const v8::FunctionCallbackInfo<v8::Value>& args ) { BinaryHelper( args, MulOp(), ".*" ) ; }
+
+    /**
+	Multiply by a number, or by a KxN matrix to give an MxN matrix (?gemm)
+    */
+    static void Mul( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      if( args[0]->IsNumber() ) {
+        BinaryHelper( args, MulOp(), "*" ) ;
+        return ;
+      }
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      if( !IsMatrix( isolate, args[0] ) ) {
+        Throw( isolate, "Expected a number or a matrix of the same type" ) ;
+        return ;
+      }
+      TypedMatrix<T>* other = ObjectWrap::Unwrap<TypedMatrix<T> >( args[0]->ToObject() );
+      if( self->n_ != other->m_ ) {
+        char msg[ 1000 ] ;
+        snprintf( msg, sizeof(msg), "Incompatible args: |%d x %d| x |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+        Throw( isolate, msg ) ;
+        return ;
+      }
+      Local<Object> instance = NewMatrix( isolate, self->m_, other->n_ ) ;
+      TypedMatrix<T>* result = ObjectWrap::Unwrap<TypedMatrix<T> >( instance ) ;
+      Blas<T>::gemm( CblasNoTrans, CblasNoTrans, self->m_, other->n_, self->n_,
+		1, self->data_, std::max( 1, self->m_ ), other->data_, std::max( 1, other->m_ ),
+		0, result->data_, std::max( 1, self->m_ ) ) ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /**
+	Sum the columns ( dimension 0, the default ) or rows ( dimension 1 ) of
+	a matrix, or all the elements of a vector
+	@param [in,default=0] the dimension to sum
+	@return the vector of sums, or a number if the target is a vector
+    */
+    static void Sum( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      int m = self->m_ ;
+      int n = self->n_ ;
+      if( m == 1 || n == 1 ) {
+        T rc = 0 ;
+        for( int i=0 ; i<m*n ; i++ ) rc += self->data_[i] ;
+        args.GetReturnValue().Set( (double)rc );
+        return ;
+      }
+      int dimension = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
+      Local<Object> instance = dimension == 0 ? NewMatrix( isolate, 1, n ) : NewMatrix( isolate, m, 1 ) ;
+      TypedMatrix<T>* result = ObjectWrap::Unwrap<TypedMatrix<T> >( instance ) ;
+      memset( result->data_, 0, ( dimension == 0 ? n : m ) * sizeof(T) ) ;
+      for( int c=0 ; c<n ; c++ ) {
+        for( int r=0 ; r<m ; r++ ) {
+          result->data_[ dimension == 0 ? c : r ] += self->data_[ r + c*m ] ;
+        }
+      }
+      args.GetReturnValue().Set( instance );
+    }
+
+    /** The sum of the absolute values of all elements (?asum) */
+    static void Asum( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      args.GetReturnValue().Set( (double)Blas<T>::asum( self->m_ * self->n_, self->data_, 1 ) );
+    }
+
+    /** The Frobenius norm - the euclidian norm of all elements (?nrm2) */
+    static void Norm( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      args.GetReturnValue().Set( (double)Blas<T>::nrm2( self->m_ * self->n_, self->data_, 1 ) );
+    }
+
+    /**
+	Invert a square matrix (?getrf then ?getri)
+    */
+    static void Inv( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      int n = self->n_ ;
+      char msg[ 1000 ] ;
+      if( self->m_ != n ) {
+        snprintf( msg, sizeof(msg), "Only square matrices can be inverted, this is |%d x %d|", self->m_, n ) ;
+        Throw( isolate, msg ) ;
+        return ;
+      }
+      Local<Object> instance = NewMatrix( isolate, n, n ) ;
+      TypedMatrix<T>* result = ObjectWrap::Unwrap<TypedMatrix<T> >( instance ) ;
+      memcpy( result->data_, self->data_, (size_t)n * n * sizeof(T) ) ;
+
+      std::vector<int> ipiv( std::max( 1, n ) ) ;
+      int rc = Blas<T>::getrf( n, n, result->data_, std::max( 1, n ), &ipiv[0] ) ;
+      if( rc > 0 ) {
+        Throw( isolate, "This matrix is singular and cannot be inverted" ) ;
+        return ;
+      }
+      const char *routine = "getrf" ;
+      if( rc == 0 ) {
+        routine = "getri" ;
+        rc = Blas<T>::getri( n, result->data_, std::max( 1, n ), &ipiv[0] ) ;
+      }
+      if( rc != 0 ) {
+        snprintf( msg, sizeof(msg), "Internal failure - %c%s() failed with %d", Blas<T>::Prefix, routine, rc ) ;
+        Throw( isolate, msg ) ;
+        return ;
+      }
+      args.GetReturnValue().Set( instance );
+    }
+
+    /*
+	The thin SVD of self: U is m x k, S is k and VT is k x n where k = min(m,n)
+	@return the ?gesvd info code
+    */
+    int ThinSvd( std::vector<T> &u, std::vector<T> &s, std::vector<T> &vt ) const {
+      int m = m_ ;
+      int n = n_ ;
+      int k = std::min( m, n ) ;
+      std::vector<T> a( data_, data_ + (size_t)m * n ) ;
+      std::vector<T> superb( std::max( 1, k ) ) ;
+      u.resize( std::max( 1, m * k ) ) ;
+      s.resize( std::max( 1, k ) ) ;
+      vt.resize( std::max( 1, k * n ) ) ;
+      return Blas<T>::gesvd( 'S', 'S', m, n, &a[0], std::max( 1, m ), &s[0], 
+			&u[0], std::max( 1, m ), &vt[0], std::max( 1, k ), &superb[0] ) ;
+    }
+
+    /**
+	The Moore-Penrose pseudo inverse, an NxM matrix
+
+	This is done from the SVD ( A = U S VT so pinv(A) = V inv(S) UT ), which
+	copes with rank deficient matrices. Singular values below the tolerance
+	are treated as 0.
+
+	@param [in,optional] the tolerance, default is max(m,n) * epsilon * the largest singular value
+    */
+    static void Pinv( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      int m = self->m_ ;
+      int n = self->n_ ;
+      int k = std::min( m, n ) ;
+
+      std::vector<T> u, s, vt ;
+      int rc = self->ThinSvd( u, s, vt ) ;
+      if( rc != 0 ) {
+        char msg[ 1000 ] ;
+        snprintf( msg, sizeof(msg), "Internal failure - %cgesvd() failed with %d", Blas<T>::Prefix, rc ) ;
+        Throw( isolate, msg ) ;
+        return ;
+      }
+      T tol = args[0]->IsNumber() ? (T)args[0]->NumberValue() : 
+		( k > 0 ? std::max( m, n ) * std::numeric_limits<T>::epsilon() * s[0] : 0 ) ;
+
+      // W = V inv(S) ( n x k ), VT is k x n
+      std::vector<T> w( std::max( 1, n * k ) ) ;
+      for( int i=0 ; i<k ; i++ ) {
+        T f = s[i] > tol ? 1 / s[i] : 0 ;
+        for( int j=0 ; j<n ; j++ ) {
+          w[ j + i*n ] = vt[ i + j*k ] * f ;
+        }
+      }
+
+      Local<Object> instance = NewMatrix( isolate, n, m ) ;
+      TypedMatrix<T>* result = ObjectWrap::Unwrap<TypedMatrix<T> >( instance ) ;
+      Blas<T>::gemm( CblasNoTrans, CblasTrans, n, m, k,
+		1, &w[0], std::max( 1, n ), &u[0], std::max( 1, m ),
+		0, result->data_, std::max( 1, n ) ) ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /**
+	Singular Value Decomposition @see WrappedArray::Svd
+
+	@return a JS object with U ( MxM ), S ( a vector of the min(M,N) singular values )
+		and VT ( NxN )
+    */
+    static void Svd( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      int m = self->m_ ;
+      int n = self->n_ ;
+      int k = std::min( m, n ) ;
+
+      Local<Object> U = NewMatrix( isolate, m, m ) ;
+      Local<Object> S = NewMatrix( isolate, k, 1 ) ;
+      Local<Object> VT = NewMatrix( isolate, n, n ) ;
+      TypedMatrix<T>* u = ObjectWrap::Unwrap<TypedMatrix<T> >( U ) ;
+      TypedMatrix<T>* s = ObjectWrap::Unwrap<TypedMatrix<T> >( S ) ;
+      TypedMatrix<T>* vt = ObjectWrap::Unwrap<TypedMatrix<T> >( VT ) ;
+
+      std::vector<T> a( self->data_, self->data_ + (size_t)m * n ) ;
+      std::vector<T> superb( std::max( 1, k ) ) ;
+      int rc = Blas<T>::gesvd( 'A', 'A', m, n, a.empty() ? NULL : &a[0], std::max( 1, m ), s->data_,
+			u->data_, std::max( 1, m ), vt->data_, std::max( 1, n ), &superb[0] ) ;
+      if( rc != 0 ) {
+        char msg[ 1000 ] ;
+        snprintf( msg, sizeof(msg), "Internal failure - %cgesvd() failed with %d", Blas<T>::Prefix, rc ) ;
+        Throw( isolate, msg ) ;
+        return ;
+      }
+
+      Local<Object> result = Object::New(isolate);
+      result->Set(String::NewFromUtf8(isolate, "U"), U );
+      result->Set(String::NewFromUtf8(isolate, "S"), S );
+      result->Set(String::NewFromUtf8(isolate, "VT"), VT );
+      args.GetReturnValue().Set( result );
+    }
+
+    /**
+	A float lalg.Array copy of this matrix, elements are rounded to float
+    */
+    static void ToArray( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Context> context = isolate->GetCurrentContext() ;
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate, self->m_ ), Integer::New( isolate, self->n_ ) };
+      Local<Function> cons = Local<Function>::New(isolate, WrappedArray::constructor);
+      Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+      WrappedArray* result = ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+      for( int i=0 ; i<self->m_*self->n_ ; i++ ) {
+        result->data_[i] = (float)self->data_[i] ;
+      }
+      args.GetReturnValue().Set( instance );
+    }
+
+    /**
+	Copy the matrix data to a new Float64Array, in column major order
+    */
+    static void ToFloat64Array( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(args.Holder());
+      size_t count = (size_t)self->m_ * self->n_ ;
+      Local<ArrayBuffer> ab = ArrayBuffer::New( isolate, count * sizeof(double) ) ;
+      double *data = (double*)ab->GetContents().Data() ;
+      for( size_t i=0 ; i<count ; i++ ) data[i] = self->data_[i] ;
+      args.GetReturnValue().Set( Float64Array::New( ab, 0, count ) ) ;
+    }
+
+    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info) {
+      Isolate* isolate = info.GetIsolate();
+      TypedMatrix<T>* self = ObjectWrap::Unwrap<TypedMatrix<T> >(info.This());
+      v8::String::Utf8Value s(property);
+      std::string str(*s);
+      if ( str == "m") {
+        info.GetReturnValue().Set(Number::New(isolate, self->m_));
+      } else if (str == "n") {
+        info.GetReturnValue().Set(Number::New(isolate, self->n_));
+      } else if (str == "length") {
+        info.GetReturnValue().Set(Number::New(isolate, self->n_*self->m_ ));
+      }
+    }
+
+    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
+    Storage *storage_ ; /**< the memory holding data_ */
+} ;
+template<class T> Persistent<Function> TypedMatrix<T>::constructor;
+
+
+/**
+ A read only matrix held in a compact form - lalg.QuantizedArray.
+
+ Made by lalg.Array's quantize(), it stores each element as a bf16, fp16 or
+ a per column scaled int8 ( @see Quantizer ). It's meant for large, fixed
+ matrices ( e.g. model weights ) that are multiplied by small batches, 
+ where the time goes on reading the matrix from memory. Both Q.mul(B) and
+ A.mul(Q) widen Q to float a panel at a time, so the sums are in float.
+
+ The data comes from the buffer pool, like a float matrix's.
+*/
+class QuantizedMatrix : public node::ObjectWrap
+{
+  public:
+    static void Init( Local<Object> exports ) {
+      Isolate* isolate = exports->GetIsolate();
+
+      Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+      tpl->SetClassName(String::NewFromUtf8(isolate, "QuantizedArray"));
+      tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toString", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "inspect", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toArray", ToArray);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "mul", Mul);
+
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "m"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "n"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "length"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "type"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "bytes"), GetCoeff);
+
+      constructor.Reset(isolate, tpl->GetFunction());
+      exports->Set(String::NewFromUtf8(isolate, "QuantizedArray"), tpl->GetFunction());
+    }
+
+    /*
+	A quantized copy of a float matrix, as a javascript object
+    */
+    static Local<Object> NewMatrix( Isolate *isolate, const WrappedArray *src, Quantizer::Type type ) {
+      Local<Context> context = isolate->GetCurrentContext() ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      Local<Object> instance = cons->NewInstance(context, 0, NULL).ToLocalChecked() ;
+      QuantizedMatrix* self = ObjectWrap::Unwrap<QuantizedMatrix>( instance ) ;
+      self->Allocate( src->m_, src->n_, type ) ;
+      Quantizer::Encode( type, src->data_, src->m_, src->n_, src->ld_, self->data_, self->scales_ ) ;
+      return instance ;
+    }
+
+    static bool IsMatrix( Isolate *isolate, Local<Value> value ) {
+      if( !value->IsObject() ) return false ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return value->InstanceOf( isolate->GetCurrentContext(), cons ).FromMaybe( false ) ;
+    }
+
+    /*
+	The body of A.mul(Q) & A.mulp(Q) - called from WrappedArray::PrepareWork
+	with A as self and Q as xtraPtr.
+    */
+    static void MulLeftWorkAsync( uv_work_t *req ) {
+      WrappedArray::Work *work = static_cast<WrappedArray::Work *>(req->data);
+      WrappedArray *self = work->self ;
+      WrappedArray *result = work->result ;
+      QuantizedMatrix *other = static_cast<QuantizedMatrix *>(work->xtraPtr) ;
+      Quantizer::MulLeft( other->type_, other->data_, other->scales_, other->m_, other->n_,
+		self->data_, std::max( 1, self->ld_ ), self->m_, work->xtraFloat, result->data_, std::max( 1, result->ld_ ) ) ;
+    }
+
+    int m_;  /**< the number of rows in the matrix */
+    int n_;  /**< the number of columns in the matrix */
+
+  private:
+    QuantizedMatrix() : m_(0), n_(0), type_(Quantizer::Bf16), data_(NULL), scales_(NULL), storage_(NULL) {}
+
+    ~QuantizedMatrix() {
+      if( storage_ != NULL ) storage_->Release() ;
+    }
+
+    /* room for an m x n matrix of type, followed by the n column scales */
+    void Allocate( int m, int n, Quantizer::Type type ) {
+      m_ = m ;
+      n_ = n ;
+      type_ = type ;
+      int dataFloats = (int)( ( (size_t)m * n * Quantizer::ElementBytes( type ) + sizeof(float) - 1 ) / sizeof(float) ) ;
+      storage_ = Storage::New( dataFloats + n ) ;
+      data_ = storage_->data ;
+      scales_ = storage_->data + dataFloats ;
+    }
+
+    /* QuantizedArrays are only made by quantize() - this just wraps an empty one */
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
+      if( !args.IsConstructCall() ) return ;
+      QuantizedMatrix* self = new QuantizedMatrix() ;
+      self->Wrap(args.This());
+      args.GetReturnValue().Set(args.This());
+    }
+
+    static void ToString( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      QuantizedMatrix* self = ObjectWrap::Unwrap<QuantizedMatrix>(args.Holder());
+      char msg[ 100 ] ;
+      snprintf( msg, sizeof(msg), "%d x %d %s\n", self->m_, self->n_, Quantizer::Name( self->type_ ) ) ;
+      args.GetReturnValue().Set( String::NewFromUtf8( isolate, msg ) );
+    }
+
+    /**
+	Widen back to a float lalg.Array. Precision lost in quantizing doesn't come back.
+    */
+    static void ToArray( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Context> context = isolate->GetCurrentContext() ;
+      QuantizedMatrix* self = ObjectWrap::Unwrap<QuantizedMatrix>(args.Holder());
+
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate, self->m_ ), Integer::New( isolate, self->n_ ) };
+      Local<Function> cons = Local<Function>::New(isolate, WrappedArray::constructor);
+      Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+      WrappedArray* result = ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+      Quantizer::Decode( self->type_, self->data_, self->scales_, self->m_, 0, self->n_, result->data_, std::max( 1, result->ld_ ) ) ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /**
+	Q x B, where B is a float lalg.Array. 
+
+	@param [in] the other ( KxN ) matrix
+	@param [in,optional] an MxN matrix to write the result into @see WrappedArray::Mul
+	@param [in,optional] beta, the multiple of out to add to the product
+	@return a new float matrix, or the output matrix
+    */
+    static void Mul( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      QuantizedMatrix* self = ObjectWrap::Unwrap<QuantizedMatrix>(args.Holder());
+      if( !WrappedArray::IsMatrix( isolate, args[0] ) ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected a lalg.Array to multiply by") ) );
+        return ;
+      }
+      WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() );
+      if( self->n_ != other->m_ ) {
+        char msg[ 1000 ] ;
+        snprintf( msg, sizeof(msg), "Incompatible args: |%d x %d| x |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+        return ;
+      }
+      WrappedArray *result = WrappedArray::MakeResult( args, 1, self->m_, other->n_ ) ;
+      if( result == NULL ) return ;
+      if( result->storage_ == other->storage_ ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Output matrix must not share data with the matrices being multiplied") ) );
+        args.GetReturnValue().Set( Undefined(isolate) );
+        return ;
+      }
+      float beta = args[2]->IsNumber() ? args[2]->NumberValue() : 0.f ;
+      Quantizer::MulRight( self->type_, self->data_, self->scales_, self->m_, self->n_,
+		other->data_, std::max( 1, other->ld_ ), other->n_, beta, result->data_, std::max( 1, result->ld_ ) ) ;
+    }
+
+    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info) {
+      Isolate* isolate = info.GetIsolate();
+      QuantizedMatrix* self = ObjectWrap::Unwrap<QuantizedMatrix>(info.This());
+      v8::String::Utf8Value s(property);
+      std::string str(*s);
+      if ( str == "m") {
+        info.GetReturnValue().Set(Number::New(isolate, self->m_));
+      } else if (str == "n") {
+        info.GetReturnValue().Set(Number::New(isolate, self->n_));
+      } else if (str == "length") {
+        info.GetReturnValue().Set(Number::New(isolate, self->n_*self->m_ ));
+      } else if (str == "type") {
+        info.GetReturnValue().Set(String::NewFromUtf8(isolate, Quantizer::Name( self->type_ ) ));
+      } else if (str == "bytes") {
+        info.GetReturnValue().Set(Number::New(isolate, (double)self->m_ * self->n_ * Quantizer::ElementBytes( self->type_ ) ));
+      }
+    }
+
+    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
+    Quantizer::Type type_ ;	/**< how each element is stored */
+    void *data_ ;	/**< the packed elements, column major */
+    float *scales_ ;	/**< the int8 column scales, after the data in the same storage */
+    Storage *storage_ ;	/**< the memory holding data_ & scales_ */
+} ;
+Persistent<Function> QuantizedMatrix::constructor;
+
+
+/**
+ A sparse matrix - lalg.SparseArray.
+
+ Only the non zero elements are kept, in compressed sparse column form
+ ( @see SparseCsc ). Matrices of mostly zeros ( e.g. one hot or bag of
+ words features ) take a fraction of the memory of a dense matrix, and
+ multiplying them only does the work for the non zeros.
+
+ Made by lalg.sparse(), from coordinates or from a dense matrix. S.mul(B)
+ and A.mul(S) multiply with a dense lalg.Array, giving a dense result, the
+ mulp versions run on the uv thread pool like any other mulp.
+*/
+class SparseMatrix : public node::ObjectWrap
+{
+  public:
+    static void Init( Local<Object> exports ) {
+      Isolate* isolate = exports->GetIsolate();
+
+      Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+      tpl->SetClassName(String::NewFromUtf8(isolate, "SparseArray"));
+      tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toString", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "inspect", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toArray", ToArray);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "transpose", Transpose);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "get", Get);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "mul", Mul);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "mulp", Mulp);
+
+      NODE_SET_METHOD(exports, "sparse", Sparse);
+
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "m"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "n"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "length"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "nnz"), GetCoeff);
+
+      constructor.Reset(isolate, tpl->GetFunction());
+      exports->Set(String::NewFromUtf8(isolate, "SparseArray"), tpl->GetFunction());
+    }
+
+    static bool IsMatrix( Isolate *isolate, Local<Value> value ) {
+      if( !value->IsObject() ) return false ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return value->InstanceOf( isolate->GetCurrentContext(), cons ).FromMaybe( false ) ;
+    }
+
+    /*
+	The body of A.mul(S) & A.mulp(S) - called from WrappedArray::PrepareWork
+	with A as self and S as xtraPtr.
+    */
+    static void DenseMulWorkAsync( uv_work_t *req ) {
+      WrappedArray::Work *work = static_cast<WrappedArray::Work *>(req->data);
+      WrappedArray *self = work->self ;
+      WrappedArray *result = work->result ;
+      SparseMatrix *other = static_cast<SparseMatrix *>(work->xtraPtr) ;
+      other->csc_.DenseMul( self->data_, self->ld_, self->m_, work->xtraFloat, result->data_, result->ld_ ) ;
+    }
+
+    SparseCsc csc_ ;	/**< the matrix */
+
+  private:
+    SparseMatrix() : reported_(0) {}
+
+    ~SparseMatrix() {
+      csc_ = SparseCsc() ;
+      Report() ;
+    }
+
+    /* keep V8 up to date with the memory we're using, @see Storage::Report */
+    void Report() {
+      Isolate *isolate = Isolate::GetCurrent() ;
+      if( isolate == NULL ) return ;
+      size_t bytes = csc_.Bytes() ;
+      isolate->AdjustAmountOfExternalAllocatedMemory( (int64_t)bytes - (int64_t)reported_ ) ;
+      reported_ = bytes ;
+    }
+
+    /* a new empty sparse matrix as a javascript object */
+    static Local<Object> NewMatrix( Isolate *isolate ) {
+      Local<Context> context = isolate->GetCurrentContext() ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return cons->NewInstance(context, 0, NULL).ToLocalChecked() ;
+    }
+
+    /* SparseArrays are made by lalg.sparse() - this just wraps an empty one */
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
+      if( !args.IsConstructCall() ) return ;
+      SparseMatrix* self = new SparseMatrix() ;
+      self->Wrap(args.This());
+      args.GetReturnValue().Set(args.This());
+    }
+
+    /*
+	Read a list of numbers from a javascript Array, a typed array or a lalg.Array
+    */
+    template<class T> static void ReadList( Isolate *isolate, Local<Value> value, std::vector<T> &list ) {
+      list.clear() ;
+      if( WrappedArray::IsMatrix( isolate, value ) ) {
+        WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( value->ToObject() ) ;
+        for( int i=0 ; i<a->m_*a->n_ ; i++ ) list.push_back( (T)a->Elem(i) ) ;
+      } else if( value->IsObject() ) {
+        Local<Context> context = isolate->GetCurrentContext() ;
+        Local<Object> obj = value->ToObject() ;
+        int len = obj->Get( String::NewFromUtf8(isolate, "length") )->NumberValue() ;
+        for( int i=0 ; i<len ; i++ ) {
+          list.push_back( (T)obj->Get( context, i ).ToLocalChecked()->NumberValue() ) ;
+        }
+      }
+    }
+
+    /**
+	Make a sparse matrix
+
+	From coordinates - the row, column and value of each non zero element,
+	in any order. Elements given more than once are added together.
+
+	\code{.js}
+
+	var S = lalg.sparse( 1000, 50000, rows, cols, values ) ;
+
+	\endcode
+
+	Or from a dense matrix, keeping elements bigger than a threshold. This takes
+	the output of find() & co. straight in.
+
+	\code{.js}
+
+	var S = lalg.sparse( A.findGreater( 0.5 ) ) ;
+
+	\endcode
+
+	@param [in] the number of rows, or a dense lalg.Array
+	@param [in] the number of columns, or the threshold for a dense matrix ( default 0 )
+	@param [in] the rows - an Array, typed array or lalg.Array
+	@param [in] the columns
+	@param [in] the values
+	@return a new lalg.SparseArray
+    */
+    static void Sparse( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+
+      Local<Object> instance = NewMatrix( isolate ) ;
+      SparseMatrix* self = ObjectWrap::Unwrap<SparseMatrix>( instance ) ;
+
+      if( WrappedArray::IsMatrix( isolate, args[0] ) ) {
+        WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() ) ;
+        float threshold = args[1]->IsNumber() ? args[1]->NumberValue() : 0.f ;
+        self->csc_.FromDense( a->data_, a->m_, a->n_, std::max( 1, a->ld_ ), threshold ) ;
+      } else {
+        int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
+        int n = args[1]->IsUndefined() ? m : args[1]->NumberValue() ;
+        std::vector<int> rows ;
+        std::vector<int> cols ;
+        std::vector<float> values ;
+        ReadList( isolate, args[2], rows ) ;
+        ReadList( isolate, args[3], cols ) ;
+        ReadList( isolate, args[4], values ) ;
+        long bad = self->csc_.FromTriplets( m, n, rows, cols, values ) ;
+        if( bad != -1 ) {
+          char *msg = new char[ 1000 ] ;
+          if( bad < 0 ) {
+            snprintf( msg, 1000, "Invalid size for a sparse matrix |%d x %d|", m, n ) ;
+          } else {
+            snprintf( msg, 1000, "Element %ld at (%d,%d) is out of bounds for matrix |%d x %d|", bad, rows[bad], cols[bad], m, n ) ;
+          }
+          isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+          delete [] msg ;
+          return ;
+        }
+      }
+      self->Report() ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /** a string showing the size & the first few non zeros */
+    static void ToString( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      SparseMatrix* self = ObjectWrap::Unwrap<SparseMatrix>(args.Holder());
+      const SparseCsc &s = self->csc_ ;
+      char buf[ 100 ] ;
+      snprintf( buf, sizeof(buf), "%d x %d Sparse, %lu non zero\n", s.m, s.n, (unsigned long)s.Nnz() ) ;
+      std::string rc( buf ) ;
+      int printed = 0 ;
+      for( int j=0 ; j<s.n && printed<10 ; j++ ) {
+        for( size_t p=s.colPtr[j] ; p<s.colPtr[j+1] && printed<10 ; p++, printed++ ) {
+          snprintf( buf, sizeof(buf), "  (%d,%d) % 6.2f\n", s.rowIdx[p], j, s.values[p] ) ;
+          rc += buf ;
+        }
+      }
+      if( (size_t)printed < s.Nnz() ) rc += "  ...\n" ;
+      args.GetReturnValue().Set( String::NewFromUtf8( isolate, rc.c_str() ) );
+    }
+
+    /** the dense form, as a new lalg.Array */
+    static void ToArray( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Context> context = isolate->GetCurrentContext() ;
+      SparseMatrix* self = ObjectWrap::Unwrap<SparseMatrix>(args.Holder());
+
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate, self->csc_.m ), Integer::New( isolate, self->csc_.n ) };
+      Local<Function> cons = Local<Function>::New(isolate, WrappedArray::constructor);
+      Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+      WrappedArray* result = ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+      self->csc_.ToDense( result->data_, std::max( 1, result->ld_ ) ) ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /** the transpose, as a new sparse matrix */
+    static void Transpose( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      SparseMatrix* self = ObjectWrap::Unwrap<SparseMatrix>(args.Holder());
+      Local<Object> instance = NewMatrix( isolate ) ;
+      SparseMatrix* result = ObjectWrap::Unwrap<SparseMatrix>( instance ) ;
+      self->csc_.Transpose( result->csc_ ) ;
+      result->Report() ;
+      args.GetReturnValue().Set( instance );
+    }
+
+    /** 
+	Get the value at (m,n) - 0 if it's not stored
+    */
+    static void Get( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      SparseMatrix* self = ObjectWrap::Unwrap<SparseMatrix>(args.Holder());
+      int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
+      int n = args[1]->IsUndefined() ? 0 : args[1]->NumberValue() ;
+      if( m<0 || m>=self->csc_.m || n<0 || n>=self->csc_.n ) {
+        char *msg = new char[1000] ;
+        snprintf( msg, 1000, "Array index (%d,%d) out of bounds  for matrix |%d x %d|", m, n, self->csc_.m, self->csc_.n ) ;
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg) ) );
+        delete [] msg ;
+        return ;
+      }
+      args.GetReturnValue().Set( self->csc_.Get( m, n ) );
+    }
+
+    /**
+	Multiply by a dense KxN lalg.Array, giving a dense MxN lalg.Array. A
+	vector ( Kx1 ) is a sparse matrix x vector multiply.
+
+	@param [in] the other matrix
+	@param [in,optional] an MxN matrix to write the result into @see WrappedArray::Mul
+	@param [in,optional] beta, the multiple of out to add to the product
+    */
+    static void Mul( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      MulHelper( args, false, 1 ) ;
+    }
+
+    /**
+	Multiply in non-blocking mode, the same arguments as mul then a callback.
+	Returns a promise if there's no callback. @see WrappedArray::Mulp
+    */
+    static void Mulp( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      MulHelper( args, true, 1 ) ;
+    }
+
+    static void MulHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) {
+      Isolate* isolate = args.GetIsolate();
+      SparseMatrix* self = ObjectWrap::Unwrap<SparseMatrix>(args.Holder());
+
+      if( !WrappedArray::IsMatrix( isolate, args[0] ) ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected a lalg.Array to multiply by") ) );
+        return ;
+      }
+      WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() );
+      if( self->csc_.n != other->m_ ) {
+        char *msg = new char[ 1000 ] ;
+        snprintf( msg, 1000, "Incompatible args: |%d x %d| x |%d x %d|", self->csc_.m, self->csc_.n, other->m_, other->n_ ) ;
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+        delete [] msg ;
+        return ;
+      }
+
+      bool hasOut = WrappedArray::IsMatrix( isolate, args[1] ) ;
+      float beta = 0.f ;
+      if( hasOut ) {
+        callbackIndex++ ;
+        if( args[2]->IsNumber() ) {
+          beta = args[2]->NumberValue() ;
+          callbackIndex++ ;
+        }
+      }
+      Local<Object> instance ;
+      WrappedArray *result = WrappedArray::MakeResult( args, hasOut ? 1 : -1, self->csc_.m, other->n_, &instance ) ;
+      if( result == NULL ) return ;
+      if( result->storage_ == other->storage_ ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Output matrix must not share data with the matrices being multiplied") ) );
+        args.GetReturnValue().Set( Undefined(isolate) );
+        return ;
+      }
+      WrappedArray::PrepareWork( args, block, callbackIndex, MulWorkAsync, instance, args.Holder(), 0, beta, other, self ) ;
+    }
+
+    /* the body of S.mul(B) & S.mulp(B), B is the work's self */
+    static void MulWorkAsync( uv_work_t *req ) {
+      WrappedArray::Work *work = static_cast<WrappedArray::Work *>(req->data);
+      WrappedArray *other = work->self ;
+      WrappedArray *result = work->result ;
+      SparseMatrix *self = static_cast<SparseMatrix *>(work->xtraPtr) ;
+      self->csc_.MulDense( other->data_, other->ld_, other->n_, work->xtraFloat, result->data_, result->ld_ ) ;
+    }
+
+    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info) {
+      Isolate* isolate = info.GetIsolate();
+      SparseMatrix* self = ObjectWrap::Unwrap<SparseMatrix>(info.This());
+      v8::String::Utf8Value s(property);
+      std::string str(*s);
+      if ( str == "m") {
+        info.GetReturnValue().Set(Number::New(isolate, self->csc_.m));
+      } else if (str == "n") {
+        info.GetReturnValue().Set(Number::New(isolate, self->csc_.n));
+      } else if (str == "length") {
+        info.GetReturnValue().Set(Number::New(isolate, (double)self->csc_.m*self->csc_.n ));
+      } else if (str == "nnz") {
+        info.GetReturnValue().Set(Number::New(isolate, (double)self->csc_.Nnz() ));
+      }
+    }
+
+    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
+    size_t reported_ ;	/**< the bytes reported to V8 */
+} ;
+Persistent<Function> SparseMatrix::constructor;
+
+/**
+ A lazy expression - a record of element wise operations on lalg.Arrays that
+ haven't been done yet. @see FusedProgram
+
+ A.lazy() starts one. add, sub, hadamard, mul by a number, neg, abs, sqrt,
+ log, exp, tanh, sigmoid, relu & softplus on it return a new lazy 
+ expression instead of doing the work.
+ eval() runs the whole expression in one pass, without the temporaries.
+ Any other matrix function ( e.g. mul by a matrix, inv, svd, sum ) evals the
+ expression and calls the function on the result.
+
+ The expression holds on to its input matrices, and reads them when it's
+ evaluated - not when it's built.
+*/
+class LazyMatrix : public node::ObjectWrap
+{
+  public:
+    static void Init( Local<Object> exports ) {
+      Isolate* isolate = exports->GetIsolate();
+
+      Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+      tpl->SetClassName(String::NewFromUtf8(isolate, "LazyArray"));
+      tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toString", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "inspect", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "eval", Eval);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "add", Add);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sub", Sub);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "hadamard", Hadamard);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "mul", Mul);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "neg", Neg);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "abs", Abs);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sqrt", Sqrt);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "log", Log);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "exp", Exp);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "tanh", Tanh);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "sigmoid", Sigmoid);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "relu", Relu);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "softplus", Softplus);
+
+      // everything else is done on the evaluated matrix
+      const char *forwarded[] = { "mulp", "inv", "pinv", "pinvp", "svd", "pca", "transpose", "sum", "mean", "norm", "asum",
+		"get", "getRows", "getColumns", "find", "findGreater", "findLessEqual", "toArray", "toArray64",
+		"asFloat32Array", "dup", "quantize", "solveLinear", "solveLinearp", "lu", "lup", "chol", "cholp", "qr", "qrp", "softmax", "logsumexp", "crossEntropy", "describe", "gram", "cov", "corr" } ;
+      for( size_t i=0 ; i<sizeof(forwarded)/sizeof(forwarded[0]) ; i++ ) {
+        Local<String> name = String::NewFromUtf8(isolate, forwarded[i]) ;
+        tpl->PrototypeTemplate()->Set( name, FunctionTemplate::New(isolate, Forward, name) ) ;
+      }
+
+      NODE_SET_METHOD(exports, "lazy", Lazy);
+
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "m"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "n"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "length"), GetCoeff);
+
+      constructor.Reset(isolate, tpl->GetFunction());
+      exports->Set(String::NewFromUtf8(isolate, "LazyArray"), tpl->GetFunction());
+    }
+
+    static bool IsMatrix( Isolate *isolate, Local<Value> value ) {
+      if( !value->IsObject() ) return false ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return value->InstanceOf( isolate->GetCurrentContext(), cons ).FromMaybe( false ) ;
+    }
+
+    /**
+	Start a lazy expression from a lalg.Array, @see WrappedArray::Lazy
+
+	\code{.js}
+
+	var X = lalg.lazy( A ).sub( mean ).hadamard( B ).add( 1 ).log().eval() ;
+
+	\endcode
+    */
+    static void Lazy( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      if( LazyMatrix::IsMatrix( isolate, args[0] ) ) {
+        args.GetReturnValue().Set( args[0] ) ;
+        return ;
+      }
+      if( !WrappedArray::IsMatrix( isolate, args[0] ) ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected a lalg.Array to make lazy") ) );
+        return ;
+      }
+      args.GetReturnValue().Set( FromArray( isolate, args[0]->ToObject() ) ) ;
+    }
+
+    /* a lazy expression that is just the matrix */
+    static Local<Object> FromArray( Isolate *isolate, Local<Object> array ) {
+      WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( array ) ;
+      Local<Object> instance = NewMatrix( isolate ) ;
+      LazyMatrix *self = ObjectWrap::Unwrap<LazyMatrix>( instance ) ;
+      self->m_ = a->m_ ;
+      self->n_ = a->n_ ;
+      self->program_.PushInput( self->AddInput( isolate, array, FusedProgram::Full ) ) ;
+      return instance ;
+    }
+
+  private:
+    LazyMatrix() : m_(0), n_(0) {}
+
+    /* an input matrix, and its shape when it was added */
+    struct InputRef {
+      Global<Object> array ;
+      FusedProgram::Shape shape ;
+      int m, n ;
     } ;
 
-class UserGradientFunction : public cppoptlib::Problem<float, 2> {
-  public:
-    using typename cppoptlib::Problem<float, 2>::TVector;
-    using typename cppoptlib::Problem<float, 2>::THessian;
+    static Local<Object> NewMatrix( Isolate *isolate ) {
+      Local<Context> context = isolate->GetCurrentContext() ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return cons->NewInstance(context, 0, NULL).ToLocalChecked() ;
+    }
+
+    /* LazyArrays are made by lalg.lazy() or A.lazy() - this just wraps an empty one */
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
+      if( !args.IsConstructCall() ) return ;
+      LazyMatrix* self = new LazyMatrix() ;
+      self->Wrap(args.This());
+      args.GetReturnValue().Set(args.This());
+    }
+
+    /*
+	The input number for a matrix, adding it if it's not already an
+	input with the same shape
+    */
+    int AddInput( Isolate *isolate, Local<Object> array, FusedProgram::Shape shape ) {
+      for( size_t i=0 ; i<inputs_.size() ; i++ ) {
+        if( inputs_[i]->shape == shape && Local<Object>::New( isolate, inputs_[i]->array )->StrictEquals( array ) ) return (int)i ;
+      }
+      WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( array ) ;
+      InputRef *ref = new InputRef() ;
+      ref->array.Reset( isolate, array ) ;
+      ref->shape = shape ;
+      ref->m = a->m_ ;
+      ref->n = a->n_ ;
+      inputs_.push_back( std::shared_ptr<InputRef>( ref ) ) ;
+      return (int)inputs_.size() - 1 ;
+    }
+
+    /* a copy of this expression as a new object, to add operations to */
+    Local<Object> Copy( Isolate *isolate ) const {
+      Local<Object> instance = NewMatrix( isolate ) ;
+      LazyMatrix *copy = ObjectWrap::Unwrap<LazyMatrix>( instance ) ;
+      copy->m_ = m_ ;
+      copy->n_ = n_ ;
+      copy->program_ = program_ ;
+      copy->inputs_ = inputs_ ;
+      return instance ;
+    }
+
+    /*
+	Run the expression into result, which must be MxN.
+	@return false ( with an exception thrown ) if an input has been
+	disposed or has changed shape since it was added
+    */
+    bool Run( Isolate *isolate, WrappedArray *result ) const {
+      std::vector<FusedProgram::Source> sources( inputs_.size() ) ;
+      for( size_t i=0 ; i<inputs_.size() ; i++ ) {
+        const InputRef &ref = *inputs_[i] ;
+        WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( Local<Object>::New( isolate, ref.array ) ) ;
+        if( a->disposed_ ) {
+          isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Matrix has been disposed")));
+          return false ;
+        }
+        if( a->m_ != ref.m || a->n_ != ref.n ) {
+          char *msg = new char[ 1000 ] ;
+          snprintf( msg, 1000, "A lazy expression input was |%d x %d| and is now |%d x %d|", ref.m, ref.n, a->m_, a->n_ ) ;
+          isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+          delete [] msg ;
+          return false ;
+        }
+        sources[i].data = a->data_ ;
+        sources[i].ld = std::max( 1, a->ld_ ) ;
+        sources[i].shape = ref.shape ;
+      }
+      program_.Run( sources, m_, n_, result->data_, std::max( 1, result->ld_ ) ) ;
+      return true ;
+    }
+
+    /* evaluate into a new lalg.Array, an empty handle if that failed */
+    Local<Object> ToArray( Isolate *isolate ) const {
+      Local<Context> context = isolate->GetCurrentContext() ;
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate, m_ ), Integer::New( isolate, n_ ) };
+      Local<Function> cons = Local<Function>::New(isolate, WrappedArray::constructor);
+      Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+      if( !Run( isolate, ObjectWrap::Unwrap<WrappedArray>( instance ) ) ) return Local<Object>() ;
+      return instance ;
+    }
+
+    /**
+	Evaluate the expression
+
+	\code{.js}
+
+	var X = A.lazy().sub( mean ).hadamard( B ).add( 1 ).log().eval() ;
+	A.lazy().mul( 2 ).add( 1 ).eval( A ) ;		// in place
+
+	\endcode
+
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix. It may be one of the inputs.
+	@return the lalg.Array result
+    */
+    static void Eval( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(args.Holder());
+      WrappedArray* result = WrappedArray::MakeResult( args, 0, self->m_, self->n_ ) ;
+      if( result == NULL ) return ;
+      if( !self->Run( isolate, result ) ) args.GetReturnValue().Set( Undefined(isolate) );
+    }
+
+    /*
+	Eval, then call the matrix function of the same name ( held in the
+	function's data ) on the result, with the same args.
+    */
+    static void Forward( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Context> context = isolate->GetCurrentContext() ;
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(args.Holder());
+      Local<Object> instance = self->ToArray( isolate ) ;
+      if( instance.IsEmpty() ) return ;
+
+      Local<Function> f = Local<Function>::Cast( instance->Get( args.Data() ) ) ;
+      std::vector< Local<Value> > argv ;
+      for( int i=0 ; i<args.Length() ; i++ ) argv.push_back( args[i] ) ;
+      MaybeLocal<Value> rc = f->Call( context, instance, (int)argv.size(), argv.empty() ? NULL : &argv[0] ) ;
+      if( !rc.IsEmpty() ) args.GetReturnValue().Set( rc.ToLocalChecked() ) ;
+    }
+
+    /*
+	The body of add, sub & hadamard. The other arg is a number, a matrix or 
+	lazy expression the same shape, or a row or column vector to apply to
+	each row or column. A lazy vector is evaluated first.
+    */
+    static void BinaryHelper( const v8::FunctionCallbackInfo<v8::Value>& args, FusedProgram::Code code, const char *symbol ) {
+      Isolate* isolate = args.GetIsolate();
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(args.Holder());
+
+      if( args[0]->IsNumber() ) {
+        ScalarHelper( args, code, args[0]->NumberValue() ) ;
+        return ;
+      }
+
+      Local<Object> otherObj ;
+      int m, n ;
+      if( LazyMatrix::IsMatrix( isolate, args[0] ) ) {
+        LazyMatrix *other = ObjectWrap::Unwrap<LazyMatrix>( args[0]->ToObject() ) ;
+        m = other->m_ ;
+        n = other->n_ ;
+        otherObj = args[0]->ToObject() ;
+      } else if( WrappedArray::IsMatrix( isolate, args[0] ) ) {
+        WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() ) ;
+        m = other->m_ ;
+        n = other->n_ ;
+        otherObj = args[0]->ToObject() ;
+      } else {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected a number, lalg.Array or lalg.LazyArray") ) );
+        return ;
+      }
+
+      FusedProgram::Shape shape ;
+      if( m == self->m_ && n == self->n_ ) shape = FusedProgram::Full ;
+      else if( m == 1 && n == self->n_ ) shape = FusedProgram::Row ;
+      else if( n == 1 && m == self->m_ ) shape = FusedProgram::Column ;
+      else {
+        char *msg = new char[ 1000 ] ;
+        snprintf( msg, 1000, "Incompatible args: |%d x %d| %s |%d x %d|", self->m_, self->n_, symbol, m, n ) ;
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+        delete [] msg ;
+        return ;
+      }
+
+      if( LazyMatrix::IsMatrix( isolate, otherObj ) && shape != FusedProgram::Full ) {
+        otherObj = ObjectWrap::Unwrap<LazyMatrix>( otherObj )->ToArray( isolate ) ;
+        if( otherObj.IsEmpty() ) return ;
+      }
+
+      Local<Object> instance = self->Copy( isolate ) ;
+      LazyMatrix *result = ObjectWrap::Unwrap<LazyMatrix>( instance ) ;
+      if( LazyMatrix::IsMatrix( isolate, otherObj ) ) {
+        LazyMatrix *other = ObjectWrap::Unwrap<LazyMatrix>( otherObj ) ;
+        std::vector<int> inputMap( other->inputs_.size() ) ;
+        for( size_t i=0 ; i<other->inputs_.size() ; i++ ) {
+          const InputRef &ref = *other->inputs_[i] ;
+          inputMap[i] = result->AddInput( isolate, Local<Object>::New( isolate, ref.array ), ref.shape ) ;
+        }
+        result->program_.Append( other->program_, inputMap ) ;
+      } else {
+        result->program_.PushInput( result->AddInput( isolate, otherObj, shape ) ) ;
+      }
+      result->program_.Push( code ) ;
+      args.GetReturnValue().Set( instance ) ;
+    }
+
+    /* the body of add, sub & mul with a number */
+    static void ScalarHelper( const v8::FunctionCallbackInfo<v8::Value>& args, FusedProgram::Code code, float x ) {
+      Isolate* isolate = args.GetIsolate();
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(args.Holder());
+      Local<Object> instance = self->Copy( isolate ) ;
+      LazyMatrix *result = ObjectWrap::Unwrap<LazyMatrix>( instance ) ;
+      result->program_.PushConstant( x ) ;
+      result->program_.Push( code ) ;
+      args.GetReturnValue().Set( instance ) ;
+    }
+
+    /* the body of neg, abs, sqrt, log, exp and the activations */
+    static void UnaryHelper( const v8::FunctionCallbackInfo<v8::Value>& args, FusedProgram::Code code ) {
+      Isolate* isolate = args.GetIsolate();
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(args.Holder());
+      Local<Object> instance = self->Copy( isolate ) ;
+      LazyMatrix *result = ObjectWrap::Unwrap<LazyMatrix>( instance ) ;
+      result->program_.Push( code ) ;
+      args.GetReturnValue().Set( instance ) ;
+    }
+
+    static void Add( const v8::FunctionCallbackInfo<v8::Value>& args ) { BinaryHelper( args, FusedProgram::Add, "+" ) ; }
+    static void Sub( const v8::FunctionCallbackInfo<v8::Value>& args ) { BinaryHelper( args, FusedProgram::Sub, "-" ) ; }
+    static void Hadamard( const v8::FunctionCallbackInfo<v8::Value>& args ) { BinaryHelper( args, FusedProgram::Mul, ".*" ) ; }
+    static void Neg( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Neg ) ; }
+    static void Abs( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Abs ) ; }
+    static void Sqrt( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Sqrt ) ; }
+    static void Log( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Log ) ; }
+    static void Exp( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Exp ) ; }
+    static void Tanh( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Tanh ) ; }
+    static void Sigmoid( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Sigmoid ) ; }
+    static void Relu( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Relu ) ; }
+    static void Softplus( const v8::FunctionCallbackInfo<v8::Value>& args ) { UnaryHelper( args, FusedProgram::Softplus ) ; }
+
+    /* mul by a number stays lazy, mul by a matrix is done on the evaluated expression */
+    static void Mul( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      if( args[0]->IsNumber() ) {
+        ScalarHelper( args, FusedProgram::Mul, args[0]->NumberValue() ) ;
+        return ;
+      }
+      Local<Context> context = isolate->GetCurrentContext() ;
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(args.Holder());
+      Local<Object> instance = self->ToArray( isolate ) ;
+      if( instance.IsEmpty() ) return ;
+
+      std::vector< Local<Value> > argv ;
+      for( int i=0 ; i<args.Length() ; i++ ) {	// either side of the multiply could be lazy too
+        if( i == 0 && LazyMatrix::IsMatrix( isolate, args[0] ) ) {
+          Local<Object> other = ObjectWrap::Unwrap<LazyMatrix>( args[0]->ToObject() )->ToArray( isolate ) ;
+          if( other.IsEmpty() ) return ;
+          argv.push_back( other ) ;
+        } else {
+          argv.push_back( args[i] ) ;
+        }
+      }
+      Local<Function> f = Local<Function>::Cast( instance->Get( String::NewFromUtf8(isolate, "mul") ) ) ;
+      MaybeLocal<Value> rc = f->Call( context, instance, (int)argv.size(), argv.empty() ? NULL : &argv[0] ) ;
+      if( !rc.IsEmpty() ) args.GetReturnValue().Set( rc.ToLocalChecked() ) ;
+    }
+
+    /** the size and how much work is waiting */
+    static void ToString( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(args.Holder());
+      char buf[ 100 ] ;
+      snprintf( buf, sizeof(buf), "%d x %d Lazy, %lu steps over %lu inputs\n", self->m_, self->n_,
+		(unsigned long)self->program_.Instructions().size(), (unsigned long)self->inputs_.size() ) ;
+      args.GetReturnValue().Set( String::NewFromUtf8( isolate, buf ) );
+    }
+
+    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info) {
+      Isolate* isolate = info.GetIsolate();
+      LazyMatrix* self = ObjectWrap::Unwrap<LazyMatrix>(info.This());
+      v8::String::Utf8Value s(property);
+      std::string str(*s);
+      if ( str == "m") {
+        info.GetReturnValue().Set(Number::New(isolate, self->m_));
+      } else if (str == "n") {
+        info.GetReturnValue().Set(Number::New(isolate, self->n_));
+      } else if (str == "length") {
+        info.GetReturnValue().Set(Number::New(isolate, (double)self->m_*self->n_ ));
+      }
+    }
+
+    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
+    int m_ ;					/**< the rows in the result */
+    int n_ ;					/**< the columns in the result */
+    FusedProgram program_ ;			/**< the operations */
+    std::vector< std::shared_ptr<InputRef> > inputs_ ;	/**< the matrices read by Input, shared with copies */
+} ;
+Persistent<Function> LazyMatrix::constructor;
+
+/**
+ A transposed view of a lalg.Array - A.t() or A.transpose( true ). Nothing
+ is copied, the view just holds on to the matrix.
+
+ mul & mulp on a view, or with a view as the other matrix, hand the matrix
+ to sgemm with its transpose flag set, so A.t().mul( B ) is A'B without 
+ making A'. Any other matrix function makes the transposed copy and calls 
+ the function on that. transpose() of a view is the matrix again.
+
+ The view reads the matrix when it's used, so it follows changes to the
+ matrix's data ( and shape ).
+*/
+class TransposedMatrix : public node::ObjectWrap
+{
+  public:
+    static void Init( Local<Object> exports ) {
+      Isolate* isolate = exports->GetIsolate();
+
+      Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+      tpl->SetClassName(String::NewFromUtf8(isolate, "TransposedArray"));
+      tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+      NODE_SET_PROTOTYPE_METHOD(tpl, "eval", Eval);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "mul", Mul);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "mulp", Mulp);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "transpose", Transpose);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "t", Transpose);
+
+      // everything else is done on the transposed copy
+      const char *forwarded[] = { "toString", "inspect", "add", "sub", "hadamard", "neg", "abs", "sqrt", "log", "exp",
+		"tanh", "sigmoid", "relu", "softplus", "inv", "pinv", "pinvp", "svd", "pca", "sum", "mean", "norm", "asum",
+		"get", "getRows", "getColumns", "find", "findGreater", "findLessEqual", "toArray", "toArray64",
+		"asFloat32Array", "dup", "lazy", "quantize", "solveLinear", "solveLinearp", "lu", "lup", "chol", "cholp", "qr", "qrp", "softmax", "logsumexp", "crossEntropy", "describe", "gram", "cov", "corr" } ;
+      for( size_t i=0 ; i<sizeof(forwarded)/sizeof(forwarded[0]) ; i++ ) {
+        Local<String> name = String::NewFromUtf8(isolate, forwarded[i]) ;
+        tpl->PrototypeTemplate()->Set( name, FunctionTemplate::New(isolate, Forward, name) ) ;
+      }
+
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "m"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "n"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "length"), GetCoeff);
+
+      constructor.Reset(isolate, tpl->GetFunction());
+      exports->Set(String::NewFromUtf8(isolate, "TransposedArray"), tpl->GetFunction());
+    }
+
+    static bool IsMatrix( Isolate *isolate, Local<Value> value ) {
+      if( !value->IsObject() ) return false ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      return value->InstanceOf( isolate->GetCurrentContext(), cons ).FromMaybe( false ) ;
+    }
+
+    /* a view of a lalg.Array, @see WrappedArray::T */
+    static Local<Object> FromArray( Isolate *isolate, Local<Object> array ) {
+      Local<Context> context = isolate->GetCurrentContext() ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      Local<Object> instance = cons->NewInstance(context, 0, NULL).ToLocalChecked() ;
+      ObjectWrap::Unwrap<TransposedMatrix>( instance )->array_.Reset( isolate, array ) ;
+      return instance ;
+    }
+
+    /*
+	The matrix behind a view, NULL ( with an exception thrown ) if it
+	has been disposed
+    */
+    static WrappedArray *Base( Isolate *isolate, Local<Object> view ) {
+      TransposedMatrix *self = ObjectWrap::Unwrap<TransposedMatrix>( view ) ;
+      WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( Local<Object>::New( isolate, self->array_ ) ) ;
+      if( a->disposed_ ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Matrix has been disposed")));
+        return NULL ;
+      }
+      return a ;
+    }
+
+  private:
+    TransposedMatrix() {}
+
+    /* TransposedArrays are made by A.t() - this just wraps an empty one */
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
+      if( !args.IsConstructCall() ) return ;
+      TransposedMatrix* self = new TransposedMatrix() ;
+      self->Wrap(args.This());
+      args.GetReturnValue().Set(args.This());
+    }
+
+    /* the transposed copy, as a new lalg.Array. An empty handle if that failed */
+    static Local<Object> ToArray( Isolate *isolate, Local<Object> view ) {
+      WrappedArray *a = Base( isolate, view ) ;
+      if( a == NULL ) return Local<Object>() ;
+      Local<Context> context = isolate->GetCurrentContext() ;
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate, a->n_ ), Integer::New( isolate, a->m_ ) };
+      Local<Function> cons = Local<Function>::New(isolate, WrappedArray::constructor);
+      Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+      WrappedArray *result = ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+      Transposer::Copy( a->data_, std::max( 1, a->ld_ ), a->m_, a->n_, result->data_, std::max( 1, result->ld_ ) ) ;
+      return instance ;
+    }
+
+    /**
+	Make the transposed copy
+
+	\code{.js}
+
+	var At = A.t().eval() ;		// the same as A.transpose()
+
+	\endcode
+
+	@param [in,optional] an NxM matrix to write the result into, instead of a new matrix. It mustn't share data with the target.
+	@return the lalg.Array result
+    */
+    static void Eval( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      WrappedArray *a = Base( isolate, args.Holder() ) ;
+      if( a == NULL ) return ;
+      WrappedArray* result = WrappedArray::MakeResult( args, 0, a->n_, a->m_ ) ;
+      if( result == NULL ) return ;
+      if( result->storage_ == a->storage_ ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Output matrix must not share data with the matrix being transposed, @see transposei") ) );
+        args.GetReturnValue().Set( Undefined(isolate) );
+        return ;
+      }
+      Transposer::Copy( a->data_, std::max( 1, a->ld_ ), a->m_, a->n_, result->data_, std::max( 1, result->ld_ ) ) ;
+    }
+
+    /* the transpose of a view is the matrix */
+    static void Transpose( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      TransposedMatrix* self = ObjectWrap::Unwrap<TransposedMatrix>(args.Holder());
+      args.GetReturnValue().Set( Local<Object>::New( isolate, self->array_ ) ) ;
+    }
+
+    /*
+	Make the transposed copy, then call the matrix function of the same 
+	name ( held in the function's data ) on it, with the same args.
+    */
+    static void Forward( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Object> instance = ToArray( isolate, args.Holder() ) ;
+      if( instance.IsEmpty() ) return ;
+      Call( args, instance, args.Data(), 0, args.Length() ) ;
+    }
+
+    /* call name on target with args[from..to) after any in argv */
+    static void Call( const v8::FunctionCallbackInfo<v8::Value>& args, Local<Object> target, Local<Value> name, 
+		int from, int to, std::vector< Local<Value> > argv = std::vector< Local<Value> >() ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Context> context = isolate->GetCurrentContext() ;
+      for( int i=from ; i<to ; i++ ) argv.push_back( args[i] ) ;
+      Local<Function> f = Local<Function>::Cast( target->Get( name ) ) ;
+      MaybeLocal<Value> rc = f->Call( context, target, (int)argv.size(), argv.empty() ? NULL : &argv[0] ) ;
+      if( !rc.IsEmpty() ) args.GetReturnValue().Set( rc.ToLocalChecked() ) ;
+    }
+
+    static void Mul( const v8::FunctionCallbackInfo<v8::Value>& args ) { MulHelper( args, "mul" ) ; }
+    static void Mulp( const v8::FunctionCallbackInfo<v8::Value>& args ) { MulHelper( args, "mulp" ) ; }
+
+    /*
+	A'.mul( B, ... ) is A.mul( B, { transA:true, ... } ). The out matrix
+	& beta, or the options, are folded into the options for the matrix.
+	A number, sparse or quantized other is multiplied by the transposed copy.
+    */
+    static void MulHelper( const v8::FunctionCallbackInfo<v8::Value>& args, const char *name ) {
+      Isolate* isolate = args.GetIsolate();
+      Local<Context> context = isolate->GetCurrentContext() ;
+      Local<String> method = String::NewFromUtf8(isolate, name) ;
+
+      if( !WrappedArray::IsMatrix( isolate, args[0] ) && !TransposedMatrix::IsMatrix( isolate, args[0] ) ) {
+        Local<Object> instance = ToArray( isolate, args.Holder() ) ;
+        if( instance.IsEmpty() ) return ;
+        Call( args, instance, method, 0, args.Length() ) ;
+        return ;
+      }
+      TransposedMatrix* self = ObjectWrap::Unwrap<TransposedMatrix>(args.Holder());
+      if( Base( isolate, args.Holder() ) == NULL ) return ;
+
+      Local<Object> options = Object::New( isolate ) ;
+      bool transA = true ;
+      int next = 1 ;		// the first arg after the options ( the callback )
+      if( WrappedArray::IsMatrix( isolate, args[1] ) ) {
+        options->Set( String::NewFromUtf8(isolate, "out"), args[1] ) ;
+        next++ ;
+        if( args[2]->IsNumber() ) {
+          options->Set( String::NewFromUtf8(isolate, "beta"), args[2] ) ;
+          next++ ;
+        }
+      } else if( args[1]->IsObject() && !args[1]->IsFunction() ) {
+        Local<Object> given = args[1]->ToObject() ;
+        const char *keys[] = { "transB", "alpha", "beta", "out" } ;
+        for( size_t i=0 ; i<sizeof(keys)/sizeof(keys[0]) ; i++ ) {
+          Local<String> key = String::NewFromUtf8(isolate, keys[i]) ;
+          options->Set( key, given->Get( context, key ).ToLocalChecked() ) ;
+        }
+        transA = !given->Get( context, String::NewFromUtf8(isolate, "transA") ).ToLocalChecked()->BooleanValue() ;
+        next++ ;
+      }
+      options->Set( String::NewFromUtf8(isolate, "transA"), Boolean::New( isolate, transA ) ) ;
+
+      std::vector< Local<Value> > argv ;
+      argv.push_back( args[0] ) ;
+      argv.push_back( options ) ;
+      Call( args, Local<Object>::New( isolate, self->array_ ), method, next, args.Length(), argv ) ;
+    }
+
+    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info) {
+      Isolate* isolate = info.GetIsolate();
+      TransposedMatrix* self = ObjectWrap::Unwrap<TransposedMatrix>(info.This());
+      WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( Local<Object>::New( isolate, self->array_ ) ) ;
+      v8::String::Utf8Value s(property);
+      std::string str(*s);
+      if ( str == "m") {
+        info.GetReturnValue().Set(Number::New(isolate, a->n_));
+      } else if (str == "n") {
+        info.GetReturnValue().Set(Number::New(isolate, a->m_));
+      } else if (str == "length") {
+        info.GetReturnValue().Set(Number::New(isolate, (double)a->m_*a->n_ ));
+      }
+    }
+
+    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
+    Global<Object> array_ ;	/**< the matrix this is a view of */
+} ;
+Persistent<Function> TransposedMatrix::constructor;
+
+/**
+ A factorization of a matrix, made by A.lu(), A.chol() or A.qr(), that can
+ be used again and again. The LAPACK factors ( and LU's pivots or QR's
+ Householder scalars ) are kept, so each solve is O(N^2) work instead of 
+ factoring from scratch.
+
+ - lu - PA = LU ( sgetrf ) of a square matrix
+ - chol - A = U'U ( spotrf ) of a symmetric positive definite matrix, 
+   only the upper triangle of A is read
+ - qr - A = QR ( sgeqrf ) of an MxN matrix with M >= N. solve gives the
+   least squares solution and inv the pseudo inverse
+
+ The factors are held in a lalg.Array that's not seen from javascript, and
+ isn't part of any scope(), so a factorization can outlive the scope it 
+ was made in.
+*/
+class Factorization : public node::ObjectWrap
+{
+  public:
+    enum Kind { Lu, Cholesky, Qr } ;
+
+    static void Init( Local<Object> exports ) {
+      Isolate* isolate = exports->GetIsolate();
+
+      Local<FunctionTemplate> tpl = FunctionTemplate::New(isolate, New);
+      tpl->SetClassName(String::NewFromUtf8(isolate, "Factorization"));
+      tpl->InstanceTemplate()->SetInternalFieldCount(1);
+
+      NODE_SET_PROTOTYPE_METHOD(tpl, "toString", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "inspect", ToString);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "solve", Solve);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "det", Det);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "logdet", LogDet);
+      NODE_SET_PROTOTYPE_METHOD(tpl, "inv", Inv);
+
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "m"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "n"), GetCoeff);
+      tpl->InstanceTemplate()->SetAccessor(String::NewFromUtf8(isolate, "kind"), GetCoeff);
+
+      constructor.Reset(isolate, tpl->GetFunction());
+      exports->Set(String::NewFromUtf8(isolate, "Factorization"), tpl->GetFunction());
+    }
+
+    /*
+	A new, empty, factorization of an MxN matrix. The matrix to hold the
+	factors is put in factors - the work, @see FactorWorkAsync, fills it.
+    */
+    static Local<Object> Create( Isolate *isolate, Kind kind, int m, int n, Local<Object> *factors ) {
+      Local<Context> context = isolate->GetCurrentContext() ;
+      Local<Function> cons = Local<Function>::New(isolate, constructor);
+      Local<Object> instance = cons->NewInstance(context, 0, NULL).ToLocalChecked() ;
+      Factorization *self = ObjectWrap::Unwrap<Factorization>( instance ) ;
+
+      const unsigned argc = 2;
+      Local<Value> argv[argc] = { Integer::New( isolate, m ), Integer::New( isolate, n ) };
+      Local<Function> arrayCons = Local<Function>::New(isolate, WrappedArray::constructor);
+      *factors = arrayCons->NewInstance(context, argc, argv).ToLocalChecked() ;
+      WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( *factors ) ;
+      if( a->storage_->scope != NULL ) {	// out of the scope's arena
+        a->UseStorage( Storage::New( m*n ) ) ;
+        a->scopeId_ = 0 ;
+      }
+
+      self->kind_ = kind ;
+      self->m_ = m ;
+      self->n_ = n ;
+      self->singular_ = false ;
+      self->factors_.Reset( isolate, *factors ) ;
+      return instance ;
+    }
+
+    /*
+	Factor the matrix in work->self into work->result ( the factors ), the
+	factorization is work->xtraPtr and its kind is work->xtraInt. This may
+	be in a background thread.
+    */
+    static void FactorWorkAsync( uv_work_t *req ) {
+      WrappedArray::Work *work = static_cast<WrappedArray::Work *>(req->data);
+      WrappedArray *self = work->self ;
+      WrappedArray *a = work->result ;
+      Factorization *f = static_cast<Factorization *>(work->xtraPtr) ;
+      const int m = self->m_ ;
+      const int n = self->n_ ;
+      const int lda = std::max( 1, m ) ;
+      self->CopyTo( a->data_ ) ;
+
+      int rc = 0 ;
+      const char *routine = "sgetrf" ;
+      if( f->kind_ == Lu ) {
+        f->ipiv_.resize( std::max( 1, n ) ) ;
+        rc = LAPACKE_sgetrf( CblasColMajor, m, n, a->data_, lda, f->ipiv_.data() ) ;
+        if( rc > 0 ) {		// U has a 0 on its diagonal - still a factorization, det() is 0
+          f->singular_ = true ;
+          rc = 0 ;
+        }
+      } else if( f->kind_ == Cholesky ) {
+        routine = "spotrf" ;
+        rc = LAPACKE_spotrf( CblasColMajor, 'U', n, a->data_, lda ) ;
+      } else {
+        routine = "sgeqrf" ;
+        f->tau_.resize( std::max( 1, n ) ) ;
+        rc = LAPACKE_sgeqrf( CblasColMajor, m, n, a->data_, lda, f->tau_.data() ) ;
+      }
+      if( rc != 0 ) {
+        work->err = new char[ 1000 ] ;
+        if( rc > 0 ) {
+          snprintf( work->err, 1000, "This matrix is not positive definite" ) ;
+        } else {
+          snprintf( work->err, 1000, "Internal failure - %s() failed with %d", routine, rc ) ;
+        }
+      }
+    }
+
+  private:
+    Factorization() : kind_(Lu), m_(0), n_(0), singular_(false) {}
+
+    /* Factorizations are made by A.lu(), A.chol() & A.qr() - this just wraps an empty one */
+    static void New(const v8::FunctionCallbackInfo<v8::Value>& args) {
+      if( !args.IsConstructCall() ) return ;
+      Factorization* self = new Factorization() ;
+      self->Wrap(args.This());
+      args.GetReturnValue().Set(args.This());
+    }
+
+    WrappedArray *Factors( Isolate *isolate ) const {
+      return ObjectWrap::Unwrap<WrappedArray>( Local<Object>::New( isolate, factors_ ) ) ;
+    }
+
+    /*
+	Solve for the MxK right hand sides in b ( leading dimension ldb ), X is
+	left in the first N rows of b.
+	@return NULL, or an error message
+    */
+    const char *SolveInPlace( Isolate *isolate, float *b, int ldb, int k ) const {
+      const float *a = Factors( isolate )->data_ ;
+      const int lda = std::max( 1, m_ ) ;
+      int rc = 0 ;
+      if( kind_ == Lu ) {
+        if( singular_ ) return "This matrix is singular" ;
+        rc = LAPACKE_sgetrs( CblasColMajor, 'N', n_, k, a, lda, ipiv_.data(), b, ldb ) ;
+      } else if( kind_ == Cholesky ) {
+        rc = LAPACKE_spotrs( CblasColMajor, 'U', n_, k, a, lda, b, ldb ) ;
+      } else {		// Q'b then back substitute with R
+        rc = LAPACKE_sormqr( CblasColMajor, 'L', 'T', m_, k, n_, a, lda, tau_.data(), b, ldb ) ;
+        if( rc == 0 ) {
+          rc = LAPACKE_strtrs( CblasColMajor, 'U', 'N', 'N', n_, k, a, lda, b, ldb ) ;
+          if( rc > 0 ) return "R is singular, the columns are not independent" ;
+        }
+      }
+      return rc == 0 ? NULL : "Internal failure - the LAPACK solve failed" ;
+    }
+
+    /**
+	Solve A x X = B, or the least squares solution for a QR
+
+	\code{.js}
+
+	var F = A.lu() ;
+	var X1 = F.solve( B1 ) ;
+	var X2 = F.solve( B2 ) ;	// no new factoring
+
+	\endcode
+
+	@param [in] B, an MxK matrix of right hand sides
+	@param [in,optional] an NxK matrix to write the result into, instead of a new matrix
+	@return the NxK solution X
+    */
+    static void Solve( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Factorization* self = ObjectWrap::Unwrap<Factorization>(args.Holder());
+
+      if( !WrappedArray::IsMatrix( isolate, args[0] ) ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected a lalg.Array of right hand sides") ) );
+        return ;
+      }
+      WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() ) ;
+      if( other->m_ != self->m_ ) {
+        char *msg = new char[ 1000 ] ;
+        snprintf( msg, 1000, "Incompatible args: |%d x %d| X = |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+        delete [] msg ;
+        return ;
+      }
+      const int k = other->n_ ;
+      WrappedArray *result = WrappedArray::MakeResult( args, 1, self->n_, k ) ;
+      if( result == NULL ) return ;
+
+      const int ldb = std::max( 1, self->m_ ) ;
+      std::vector<float> b( (size_t)ldb * k ) ;
+      other->CopyTo( b.data() ) ;
+      const char *err = self->SolveInPlace( isolate, b.data(), ldb, k ) ;
+      if( err != NULL ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, err) ) );
+        args.GetReturnValue().Set( Undefined(isolate) );
+        return ;
+      }
+      for( int c=0 ; c<k ; c++ ) {
+        memcpy( result->data_ + (size_t)c*result->ld_, b.data() + (size_t)c*ldb, self->n_*sizeof(float) ) ;
+      }
+    }
+
+    /*
+	log |det| from the diagonal of the factors, in double. The sign of det 
+	goes in sign. Each row swap of an LU, and each Householder reflection
+	of a QR ( tau != 0 ), flips it.
+    */
+    double LogAbsDet( Isolate *isolate, int &sign ) const {
+      const WrappedArray *f = Factors( isolate ) ;
+      const int lda = std::max( 1, m_ ) ;
+      double rc = 0 ;
+      sign = 1 ;
+      for( int i=0 ; i<n_ ; i++ ) {
+        const float d = f->data_[ i + (size_t)i*lda ] ;
+        if( d < 0 ) sign = -sign ;
+        rc += ::log( ::fabs( (double)d ) ) ;
+        if( kind_ == Lu && ipiv_[i] != i+1 ) sign = -sign ;
+        if( kind_ == Qr && tau_[i] != 0 ) sign = -sign ;
+      }
+      if( kind_ == Cholesky ) {		// det( U'U ) = det( U )^2
+        rc *= 2 ;
+        sign = 1 ;
+      }
+      return rc ;
+    }
+
+    /* a QR of a matrix that's not square has no determinant */
+    bool CheckSquare( Isolate *isolate ) const {
+      if( m_ == n_ ) return true ;
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "Incompatible args: |%d x %d| should be a square matrix for a determinant", m_, n_ ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      return false ;
+    }
+
+    /**
+	The determinant. Worked out in double from the log, so it's 0 or
+	infinite if it's beyond the range of a number. @see LogDet
+	@return the determinant
+    */
+    static void Det( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Factorization* self = ObjectWrap::Unwrap<Factorization>(args.Holder());
+      if( !self->CheckSquare( isolate ) ) return ;
+      int sign ;
+      double logdet = self->LogAbsDet( isolate, sign ) ;
+      args.GetReturnValue().Set( sign * ::exp( logdet ) ) ;
+    }
+
+    /**
+	The log of the absolute value of the determinant, which doesn't
+	overflow for a big matrix. -Infinity for a singular matrix.
+	@return log |det|
+    */
+    static void LogDet( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Factorization* self = ObjectWrap::Unwrap<Factorization>(args.Holder());
+      if( !self->CheckSquare( isolate ) ) return ;
+      int sign ;
+      args.GetReturnValue().Set( self->LogAbsDet( isolate, sign ) ) ;
+    }
+
+    /**
+	The inverse, from the factors. The pseudo inverse ( NxM ) for the QR
+	of a matrix with more rows than columns. A Cholesky inverse is marked 
+	symmetric.
+	@return the new inverse
+    */
+    static void Inv( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Factorization* self = ObjectWrap::Unwrap<Factorization>(args.Holder());
+      const int m = self->m_ ;
+      const int n = self->n_ ;
+      WrappedArray *result = WrappedArray::MakeResult( args, -1, n, m ) ;
+      const float *a = self->Factors( isolate )->data_ ;
+      const int lda = std::max( 1, m ) ;
+
+      int rc = 0 ;
+      const char *err = NULL ;
+      if( self->kind_ == Lu ) {
+        memcpy( result->data_, a, (size_t)m*n*sizeof(float) ) ;
+        if( self->singular_ ) err = "This matrix is singular and cannot be inverted" ;
+        else rc = LAPACKE_sgetri( CblasColMajor, n, result->data_, lda, self->ipiv_.data() ) ;
+      } else if( self->kind_ == Cholesky ) {
+        memcpy( result->data_, a, (size_t)m*n*sizeof(float) ) ;
+        rc = LAPACKE_spotri( CblasColMajor, 'U', n, result->data_, lda ) ;
+        if( rc == 0 ) {
+          WrappedArray::FillLower( result->data_, n, lda ) ;
+          result->MarkSymmetric() ;
+        }
+      } else {		// solve for the identity
+        std::vector<float> b( (size_t)lda * m, 0.f ) ;
+        for( int i=0 ; i<m ; i++ ) b[ i + (size_t)i*lda ] = 1.f ;
+        err = self->SolveInPlace( isolate, b.data(), lda, m ) ;
+        for( int c=0 ; c<m && err == NULL ; c++ ) {
+          memcpy( result->data_ + (size_t)c*result->ld_, b.data() + (size_t)c*lda, n*sizeof(float) ) ;
+        }
+      }
+      if( rc > 0 ) err = "This matrix is singular and cannot be inverted" ;
+      if( rc < 0 ) err = "Internal failure - the LAPACK inverse failed" ;
+      if( err != NULL ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, err) ) );
+        args.GetReturnValue().Set( Undefined(isolate) );
+      }
+    }
+
+    static const char *KindName( Kind kind ) {
+      return kind == Lu ? "lu" : kind == Cholesky ? "chol" : "qr" ;
+    }
+
+    /** the size and kind */
+    static void ToString( const v8::FunctionCallbackInfo<v8::Value>& args ) {
+      Isolate* isolate = args.GetIsolate();
+      Factorization* self = ObjectWrap::Unwrap<Factorization>(args.Holder());
+      char buf[ 100 ] ;
+      snprintf( buf, sizeof(buf), "%d x %d %s factorization\n", self->m_, self->n_, KindName( self->kind_ ) ) ;
+      args.GetReturnValue().Set( String::NewFromUtf8( isolate, buf ) );
+    }
+
+    static void GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info) {
+      Isolate* isolate = info.GetIsolate();
+      Factorization* self = ObjectWrap::Unwrap<Factorization>(info.This());
+      v8::String::Utf8Value s(property);
+      std::string str(*s);
+      if ( str == "m") {
+        info.GetReturnValue().Set(Number::New(isolate, self->m_));
+      } else if (str == "n") {
+        info.GetReturnValue().Set(Number::New(isolate, self->n_));
+      } else if (str == "kind") {
+        info.GetReturnValue().Set(String::NewFromUtf8(isolate, KindName( self->kind_ )));
+      }
+    }
+
+    static v8::Persistent<v8::Function> constructor; /**< a nodejs constructor for this object */
+    Kind kind_ ;
+    int m_ ;			/**< the rows in the factored matrix */
+    int n_ ;			/**< the columns in the factored matrix */
+    bool singular_ ;		/**< an LU with a 0 on the diagonal of U */
+    Global<Object> factors_ ;	/**< the lalg.Array holding LAPACK's factors */
+    std::vector<int> ipiv_ ;	/**< LU's row swaps */
+    std::vector<float> tau_ ;	/**< QR's Householder scalars */
+} ;
+Persistent<Function> Factorization::constructor;
+
+Local<Object> WrappedArray::NewInstance(const FunctionCallbackInfo<Value>& args)
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+  EscapableHandleScope scope(isolate) ; ;
+
+  const unsigned argc = 2;
+  Local<Value> argv[argc] = { args[0], args[1] };
+  Local<Function> cons = Local<Function>::New(isolate, constructor);
+  MaybeLocal<Object> instance = cons->NewInstance(context, argc, argv);
+
+  return scope.Escape(instance.ToLocalChecked() );
+}
+
+/** 
+	returns a string representation of the matrix 
+
+	This will print up to maxPrint rows and columns
+*/
+void WrappedArray::ToString( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+//  Local<Context> context = isolate->GetCurrentContext() ;
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  int mm = std::min( self->m_, self->maxPrint_ ) ;
+  int nn = std::min( self->n_, self->maxPrint_ ) ;
+  char *rc = new char[ 100 + (mm * nn * 50 * self->maxPrint_ ) ] ;   // allocate a big array. This can still overflow :( TODO: fix this crap
+  int n = 0 ;
+  if( self->name_ != NULL ) {
+  	n = sprintf( rc, "[ %s ] ", self->name_ ) ;
+  }
+  n += sprintf( rc+n, "%d x %d %s\n", self->m_, self->n_, self->isVector?"Vector" : "" ) ;
+
+  for( int r=0 ; r<mm ; r++ ) {
+    for( int c=0 ; c<nn ; c++ ) {
+      n += sprintf( rc+n, "% 6.2f ", self->data_[ c * self->ld_ + r ] ) ;
+    }
+    if( self->n_ > nn ) {
+      strcat( rc, " ..." ) ;
+      n+=4 ;
+    }
+    strcat( rc, "\n" ) ;
+    n++ ;
+  }
+  if( self->m_ > mm ) {
+    for( int i=0 ; i<nn ; i++ ) {
+      strcat( rc, "  ...  " ) ;
+    }
+    strcat( rc, "\n" ) ;
+  }
+
+  args.GetReturnValue().Set( String::NewFromUtf8( isolate, rc) );
+  delete [] rc ;
+}
+
+/** internally calls ToString. @see ToString */
+void WrappedArray::Inspect( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  ToString( args ) ;
+}
+
 
 
-    UserGradientFunction( Isolate* isolate, WrappedArray* self, Local<Object> instance, Local<Object> suppliedFunctionHolder ) {
+/** 
+	Get a value from the matrix
 
-	Local<Context> context = isolate->GetCurrentContext() ;
-/*
-  {
-    Local<String> className = suppliedFunctionHolder->GetConstructorName() ;
-    char *c = new char[className->Utf8Length() + 10 ] ;
-    className->WriteUtf8( c ) ;
-    printf( "Self sfh ... %s\n", c ) ;
-    delete c ;
+	Returns a value from the matrix at the X,Y. If a single index is given it is used an an absolute
+	address into the underlying store. Negative indices count from the end.
+
+	@param [in,default=0] M the row index ( or the absolute index is N is missing )
+	@param [in,optional] N the column index
+	@return the value in the matrix at required
+*/
+void WrappedArray::Get( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+//  Local<Context> context = isolate->GetCurrentContext() ;
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
+  if( args[1]->IsUndefined() ) {
+    if( ::abs(m)>=(self->m_ * self->n_)) {
+      char *msg = new char[1000] ;
+      snprintf( msg, 1000, "Array index (%d) out of bounds, max length is %d", m, ((self->m_ * self->n_)-1) ) ;
+      Local<String> err = String::NewFromUtf8(isolate, msg);
+      isolate->ThrowException(Exception::TypeError( err ) );
+      delete [] msg ;
+    } else {
+      if( m<0) m = (self->m_ * self->n_) - m - 1 ;
+      args.GetReturnValue().Set( self->Elem(m) );
+    }
+  } else {
+    int n = args[1]->NumberValue() ;
+    if( ::abs(m)>=self->m_ || ::abs(n)>=self->n_) {
+      char *msg = new char[1000] ;
+      snprintf( msg, 1000, "Array index (%d,%d) out of bounds  for matrix |%d x %d|", m, n, self->m_, self->n_ ) ;
+      Local<String> err = String::NewFromUtf8(isolate, msg);
+      isolate->ThrowException(Exception::TypeError( err ) );
+      delete [] msg ;
+    } else {
+      if( m<0) m = self->m_ - m - 1 ;
+      if( n<0) n = self->n_ - n - 1 ;
+      args.GetReturnValue().Set( self->data_[m+n*self->ld_] );
+    }
   }
+}
+
+
+
+/** 
+	Set a value in the matrix
+
+	Overwrites a the value in the matrix at the X,Y. If the target is a vector
+	only the first argument is used. If a single index is given it is used an an absolute
+	address into the underlying store. Negative indices count from the end.
+
+	@param [in] value to set into the matrix
+	@param [in,default=0] M the row index ( or the absolute index is N is missing )
+	@param [in,optional] N the column index
+	@return the previous value in the matrix at location (m,n)
 */
-	Local<String> valueKey = String::NewFromUtf8(isolate, "value") ;
-suppliedFunctionHolder->GetPropertyNames( context ) ;
-        MaybeLocal<Value> mlv = suppliedFunctionHolder->Get( context, String::NewFromUtf8(isolate, "value") ) ;
+void WrappedArray::Set( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+//  Local<Context> context = isolate->GetCurrentContext() ;
 
-	Local<Value> valuetmp = suppliedFunctionHolder->Get( context, String::NewFromUtf8(isolate, "value") ).ToLocalChecked() ;
-	value_ = Local<Function>::Cast( valuetmp ) ;
-	Local<Value> gradtmp = suppliedFunctionHolder->Get( context, String::NewFromUtf8(isolate, "gradient") ).ToLocalChecked() ;
-	gradient_ = Local<Function>::Cast( gradtmp ) ;
-	self_ = self ;
-	isolate_ = isolate ;
-	instance_ = instance ;
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  if( args[0]->IsUndefined() ) {
+    Local<String> err = String::NewFromUtf8(isolate, "Missing value to set into a matrix");
+    isolate->ThrowException(Exception::TypeError( err ) );
+  } else {
+    float newValue = args[0]->NumberValue() ;
+    int m = args[1]->IsUndefined() ? 0 : args[1]->NumberValue() ;
+    if( args[2]->IsUndefined() ) {
+      if( ::abs(m)>=(self->m_ * self->n_)) {
+        char *msg = new char[1000] ;
+        snprintf( msg, 1000, "Array index (%d) out of bounds, max length is %d", m, ((self->m_ * self->n_)-1) ) ;
+        Local<String> err = String::NewFromUtf8(isolate, msg);
+        isolate->ThrowException(Exception::TypeError( err ) );
+        delete [] msg ;
+      } else {
+	if( m<0) m = (self->m_ * self->n_) - m - 1 ;
+        self->MakeWritable() ;		// only once the index is good - this may copy shared data
+        args.GetReturnValue().Set( self->Elem(m) );
+        self->Elem(m) = newValue ;
+      }
+    } else {
+      int n = args[2]->NumberValue() ;
+      if( ::abs(m)>=self->m_ || ::abs(n)>=self->n_) {
+        char *msg = new char[1000] ;
+        snprintf( msg, 1000, "Array index (%d,%d) out of bounds  for matrix |%d x %d|", m, n, self->m_, self->n_ ) ;
+        Local<String> err = String::NewFromUtf8(isolate, msg);
+        isolate->ThrowException(Exception::TypeError( err ) );
+        delete [] msg ;
+      } else {
+	if( m<0) m = self->m_ - m - 1 ;
+	if( n<0) n = self->n_ - n - 1 ;
+        self->MakeWritable() ;
+        args.GetReturnValue().Set( self->data_[m+n*self->ld_] );
+        self->data_[m+n*self->ld_] = newValue ;
+      }
     }
-    
-    float value(const TVector &x) {
-	for( int i=0 ; i<self_->m_ * self_->n_ ; i++ ) {
-		self_->data_[i] = x[i] ;
-	}
-        Handle<Value> argv[] = { instance_ } ;
-        MaybeLocal<Value> value = value_ -> Call(isolate_->GetCurrentContext()->Global(), 1, argv) ;
-	for( int i=0 ; i<self_->m_ * self_->n_ ; i++ ) {
-		self_->data_[i] = x[i] ;
-	}
-  	
-	float rc = value.ToLocalChecked()->NumberValue() ;
-	return rc ;
+  }
+}
+
+
+
+/** 
+	Get a Float32Array view of the matrix data
+
+	The typed array uses the matrix memory directly - nothing is copied - so
+	changes made through the view are changes to the matrix and vice versa. The 
+	view covers the m*n elements in column major order at the time it was made,
+	the view keeps the matrix alive.
+
+	A view is only valid while the matrix keeps its memory. Any operation that
+	moves the data to a new buffer - e.g. reshape() to a bigger size - detaches
+	all the views: they become zero length arrays, and never point at freed
+	memory. Ask for a new view after such a change. A matrix built on a 
+	javascript buffer returns a view of that buffer, which stays valid, but stops
+	sharing data with the matrix once the matrix moves. A view of rows 
+	( @see ViewRows ) isn't contiguous in memory and can't be exported this way.
+
+	\code{.js}
+
+	var lalg = require('lalg');
+	var A = lalg.rand( 1000, 100 ) ;
+	var f = A.asFloat32Array() ;	// 100000 floats, no copy
+	response.end( Buffer.from( f.buffer, f.byteOffset, f.byteLength ) ) ;
+
+	\endcode
+
+	@see ToFloat32Array for a copy
+	@return a Float32Array sharing the matrix memory 
+*/
+void WrappedArray::AsFloat32Array( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  size_t count = (size_t)self->m_ * self->n_ ;
+
+  if( !self->IsContiguous() ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "asFloat32Array() needs contiguous data - this is a view of rows, use toFloat32Array()")));
+    return ;
+  }
+
+  // javascript can write to the data whenever it likes, so it mustn't be shared by dup()
+  self->MakeWritable() ;
+  self->storage_->exported = true ;
+
+  // memory from a javascript buffer - just make a view on that buffer
+  if( !self->storage_->backing.IsEmpty() ) {
+    Local<Object> backing = Local<Object>::New( isolate, self->storage_->backing ) ;
+    if( backing->IsSharedArrayBuffer() ) {
+      Local<SharedArrayBuffer> sab = Local<SharedArrayBuffer>::Cast( backing ) ;
+      size_t offset = (char*)self->data_ - (char*)sab->GetContents().Data() ;
+      args.GetReturnValue().Set( Float32Array::New( sab, offset, count ) ) ;
+    } else {
+      Local<ArrayBuffer> ab = Local<ArrayBuffer>::Cast( backing ) ;
+      size_t offset = (char*)self->data_ - (char*)ab->GetContents().Data() ;
+      args.GetReturnValue().Set( Float32Array::New( ab, offset, count ) ) ;
+    }
+    return ;
+  }
+
+  // forget views that javascript has finished with
+  size_t live = 0 ;
+  for( size_t i=0 ; i<self->views_.size() ; i++ ) {
+    if( self->views_[i]->IsEmpty() ) {
+      delete self->views_[i] ;
+    } else {
+      self->views_[live++] = self->views_[i] ;
     }
+  }
+  self->views_.resize( live ) ;
 
+  // an external buffer - we own the memory. The buffer keeps the matrix alive
+  Local<ArrayBuffer> ab = ArrayBuffer::New( isolate, self->data_, count * sizeof(float) ) ;
+  ab->SetPrivate( context, ViewOwnerKey( isolate ), args.Holder() ) ;
 
-    void gradient(const TVector &x, TVector &grad) {
-	for( int i=0 ; i<self_->m_ * self_->n_ ; i++ ) {
-		self_->data_[i] = x[i] ;
-	}
-        Handle<Value> argv[] = { instance_ } ;
-        Local<Value> obj = gradient_ -> Call(isolate_->GetCurrentContext()->Global(), 1, argv) ;
+  Persistent<ArrayBuffer> *view = new Persistent<ArrayBuffer>( isolate, ab ) ;
+  view->SetWeak() ;
+  self->views_.push_back( view ) ;
 
-	WrappedArray *gradient = WrappedArray::ObjectWrap::Unwrap<WrappedArray>( obj->ToObject() );
+  args.GetReturnValue().Set( Float32Array::New( ab, 0, count ) ) ;
+}
+
+
+/** 
+	Copy the matrix data to a new Float32Array
+
+	The typed array is a copy of the m*n elements of the matrix in column major order.
+	It's independent of the matrix.
+
+	@see AsFloat32Array for a view without copying
+	@return a new Float32Array 
+*/
+void WrappedArray::ToFloat32Array( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  size_t count = (size_t)self->m_ * self->n_ ;
+
+  Local<ArrayBuffer> ab = ArrayBuffer::New( isolate, count * sizeof(float) ) ;
+  self->CopyTo( (float*)ab->GetContents().Data() ) ;
+
+  args.GetReturnValue().Set( Float32Array::New( ab, 0, count ) ) ;
+}
+
+
+/**
+	Copy the matrix to a double precision lalg.Array64
+
+	Use this before work that needs more precision than a float gives,
+	e.g. inverting a badly conditioned matrix. toArray() converts back.
+
+	\code{.js}
+
+	var A = lalg.rand( 100, 5 ) ;
+	var W = A.toArray64().pinv().toArray() ;
+
+	\endcode
+
+	@return a new lalg.Array64
+*/
+void WrappedArray::ToArray64( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  Local<Object> instance = TypedMatrix<double>::NewMatrix( isolate, self->m_, self->n_ ) ;
+  TypedMatrix<double>* result = node::ObjectWrap::Unwrap<TypedMatrix<double> >( instance ) ;
+  for( int c=0 ; c<self->n_ ; c++ ) {
+    const float *a = self->data_ + c*self->ld_ ;
+    double *data = result->data_ + c*self->m_ ;
+    for( int r=0 ; r<self->m_ ; r++ ) {
+      data[r] = a[r] ;
+    }
+  }
+  args.GetReturnValue().Set( instance );
+}
+
+
+/**
+	Make a compact, read only, copy of a matrix for fast multiplies
+
+	Big matrices that are used many times but never changed, like the weights
+	of a model, can be stored in fewer bytes per element. Multiplying by them
+	reads less memory, which is what limits the speed of a matrix x vector
+	( or small batch ) multiply.
+
+	- bf16 - 2 bytes, the range of a float but only ~3 significant digits
+	- fp16 - 2 bytes, ~3.5 significant digits, values must be within +/- 65504
+	- int8 - 1 byte, each column is scaled so its largest value is 127
+
+	\code{.js}
+
+	var Q = W.quantize( 'int8' ) ;
+	var y = Q.mul( x ) ;		// W x x
+	var z = X.mul( Q ) ;		// X x W
+	var W2 = Q.toArray() ;		// back to float
+
+	\endcode
+
+	@param [in,default=bf16] the type - bf16, fp16 or int8
+	@return a new lalg.QuantizedArray
+*/
+void WrappedArray::Quantize( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  Quantizer::Type type = Quantizer::Bf16 ;
+  if( !args[0]->IsUndefined() ) {
+    v8::String::Utf8Value s( args[0] ) ;
+    if( *s == NULL || !Quantizer::Parse( *s, type ) ) {
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "Unknown quantized type '%s', expected bf16, fp16 or int8", *s == NULL ? "" : *s ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      return ;
+    }
+  }
+  args.GetReturnValue().Set( QuantizedMatrix::NewMatrix( isolate, self, type ) );
+}
+
+
+/**
+	Start a lazy expression
+
+	Element wise functions on the returned lalg.LazyArray are recorded, not
+	done. eval() then runs them all in one pass over memory, without making
+	a matrix for each step. @see LazyMatrix
+
+	\code{.js}
+
+	var X = A.lazy().sub( mean ).hadamard( B ).add( 1 ).log().eval() ;
+	var Y = A.lazy().mul( 2 ).add( B ).mul( C ) ;	// evals then A*2+B x C 
+
+	\endcode
+
+	@return a new lalg.LazyArray
+*/
+void WrappedArray::Lazy( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  args.GetReturnValue().Set( LazyMatrix::FromArray( isolate, args.Holder() ) ) ;
+}
+
+
+/**
+	Work out an expression for each element of some matrices
+
+	The expression is written with a for the first matrix ( or number ) 
+	after it, b for the second and so on. It's compiled the first time
+	it's seen and then run in one pass - in tiles, with the SIMD kernels,
+	over the thread pool - like an eval()ed lazy expression. @see FusedProgram::Parse
+
+	- numbers: 2, 0.5, 1e-3
+	- operators: + - * / ^ ( power )
+	- functions: exp log sqrt abs tanh sigmoid, pow(x,y) min(x,y) max(x,y) clip(x,lo,hi)
+
+	The result is the size of the biggest matrix. The others must be the
+	same size, a row vector ( applied to each row ), a column vector ( applied
+	to each column ) or 1x1.
+
+	\code{.js}
+
+	var C = lalg.map( 'log( a*b + 1 )', A, B ) ;
+	var S = lalg.map( '1 / ( 1 + exp( -a ) )', A ) ;
+	var N = lalg.map( 'clip( ( a - b ) / c, -3, 3 )', X, X.mean(), X.std ) ;
+	var P = lalg.map( 'a^b', A, 2.5 ) ;
+
+	\endcode
+
+	@param [in] the expression
+	@param [in] the lalg.Arrays and numbers for a, b, c ...
+	@return a new lalg.Array
+*/
+void WrappedArray::Map( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  if( !args[0]->IsString() ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected an expression string")));
+    return ;
+  }
+  v8::String::Utf8Value text( args[0] ) ;
+
+  // compiled expressions, by their text
+  static std::map<std::string,FusedProgram> programs ;
+  std::map<std::string,FusedProgram>::iterator it = programs.find( *text ) ;
+  if( it == programs.end() ) {
+    FusedProgram program ;
+    std::string error = FusedProgram::Parse( *text, program ) ;
+    if( !error.empty() ) {
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, error.c_str())));
+      return ;
+    }
+    if( programs.size() >= 256 ) programs.clear() ;
+    it = programs.insert( std::make_pair( std::string( *text ), program ) ).first ;
+  }
+  const FusedProgram &program = it->second ;
+
+  int values = args.Length() - 1 ;
+  if( program.Inputs() > values ) {
+    char *msg = new char[ 1000 ] ;
+    snprintf( msg, 1000, "The expression uses '%c' but only %d values were given", 'a' + program.Inputs() - 1, values ) ;
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    delete [] msg ;
+    return ;
+  }
+
+  // the result is the size of the biggest matrix
+  int m = 0 ;
+  int n = 0 ;
+  for( int i=0 ; i<program.Inputs() ; i++ ) {
+    if( IsMatrix( isolate, args[i+1] ) ) {
+      WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( args[i+1]->ToObject() ) ;
+      if( a->disposed_ ) {
+        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Matrix has been disposed")));
+        return ;
+      }
+      m = std::max( m, a->m_ ) ;
+      n = std::max( n, a->n_ ) ;
+    } else if( !args[i+1]->IsNumber() ) {
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "'%c' must be a lalg.Array or a number", 'a' + i ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      return ;
+    }
+  }
+  if( m == 0 || n == 0 ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "The expression needs at least one lalg.Array")));
+    return ;
+  }
 
-	for( int i=0 ; i<gradient->m_*gradient->n_ ; i++ ) {
-	  grad[i] = gradient->data_[i] ;
-	}
+  const unsigned argc = 2;
+  Local<Value> argv[argc] = { Integer::New( isolate, m ), Integer::New( isolate, n ) };
+  Local<Function> cons = Local<Function>::New(isolate, constructor);
+  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+  WrappedArray *result = ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+
+  std::vector<float> numbers( program.Inputs() ) ;
+  std::vector<FusedProgram::Source> sources( program.Inputs() ) ;
+  for( int i=0 ; i<program.Inputs() ; i++ ) {
+    FusedProgram::Source &src = sources[i] ;
+    if( args[i+1]->IsNumber() ) {
+      numbers[i] = args[i+1]->NumberValue() ;
+      src.data = &numbers[i] ;
+      src.ld = 1 ;
+      src.shape = FusedProgram::Scalar ;
+      continue ;
+    }
+    WrappedArray *a = ObjectWrap::Unwrap<WrappedArray>( args[i+1]->ToObject() ) ;
+    src.data = a->data_ ;
+    src.ld = std::max( 1, a->ld_ ) ;
+    if( a->m_ == m && a->n_ == n ) src.shape = FusedProgram::Full ;
+    else if( a->m_ == 1 && a->n_ == 1 ) src.shape = FusedProgram::Scalar ;
+    else if( a->m_ == 1 && a->n_ == n ) src.shape = FusedProgram::Row ;
+    else if( a->n_ == 1 && a->m_ == m ) src.shape = FusedProgram::Column ;
+    else {
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "Incompatible args: '%c' is |%d x %d|, the result is |%d x %d|", 'a' + i, a->m_, a->n_, m, n ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      return ;
     }
+  }
+  program.Run( sources, m, n, result->data_, std::max( 1, result->ld_ ) ) ;
+  args.GetReturnValue().Set( instance ) ;
+}
 
-   private:
-	Local<Function> value_ ;
-	Local<Function> gradient_ ;
-	WrappedArray* self_ ;
-	Isolate* isolate_ ;
-	Local<Object> instance_ ;
 
-};
 
+/**
+	Duplicate a matrix
 
-} ;
-Persistent<Function> WrappedArray::constructor;
+	Returns a new matrix which is an identical copy of the target. 
+	A copy of a view is a normal matrix - it doesn't share any data.
 
-Local<Object> WrappedArray::NewInstance(const FunctionCallbackInfo<Value>& args)
+	Nothing is copied straight away, the two matrices share the data until 
+	one of them is changed (copy on write). A matrix with views, or one whose data
+	is visible to javascript ( asFloat32Array, fromBuffer ... ) is copied immediately.
+*/
+void WrappedArray::Dup( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
   EscapableHandleScope scope(isolate) ; ;
 
+  Storage *storage = self->storage_ ;
+  bool share = !self->isView_ && storage != NULL && storage->views == 0 && 
+		!storage->exported && storage->backing.IsEmpty() ;
+
   const unsigned argc = 2;
-  Local<Value> argv[argc] = { args[0], args[1] };
+  Local<Value> argv[argc] = { Integer::New( isolate,share ? 0 : self->m_ ), Integer::New( isolate,share ? 0 : self->n_ ) };
   Local<Function> cons = Local<Function>::New(isolate, constructor);
-  MaybeLocal<Object> instance = cons->NewInstance(context, argc, argv);
+  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
 
-  return scope.Escape(instance.ToLocalChecked() );
+  scope.Escape( instance );
+
+  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+  args.GetReturnValue().Set( instance );
+  if( share ) {		// copy on write - whoever writes first will copy
+    storage->Ref() ;
+    result->UseStorage( storage ) ;
+    result->m_ = self->m_ ;
+    result->n_ = self->n_ ;
+    result->ld_ = self->ld_ ;
+    result->isVector = self->isVector ;
+  } else {
+    self->CopyTo( result->data_ ) ;
+  }
 }
 
+
 /** 
-	returns a string representation of the matrix 
+	Free a matrix's memory now
 
-	This will print up to maxPrint rows and columns
+	The data is released straight away instead of waiting for the matrix to be
+	garbage collected. Any later use of the matrix throws an exception. Memory
+	shared with a view or a dup() of the matrix is freed when they're done with it. 
+	Disposing twice does nothing.
+
+	\code{.js}
+
+	var T = X.transpose() ;
+	var G = T.mul( X ) ;
+	T.dispose() ;
+	
+	\endcode
 */
-void WrappedArray::ToString( const v8::FunctionCallbackInfo<v8::Value>& args )
+void WrappedArray::Dispose( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
   Isolate* isolate = args.GetIsolate();
-//  Local<Context> context = isolate->GetCurrentContext() ;
 
   WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-
-  int mm = std::min( self->m_, self->maxPrint_ ) ;
-  int nn = std::min( self->n_, self->maxPrint_ ) ;
-  char *rc = new char[ 100 + (mm * nn * 50 * self->maxPrint_ ) ] ;   // allocate a big array. This can still overflow :( TODO: fix this crap
-  int n = 0 ;
-  if( self->name_ != NULL ) {
-  	n = sprintf( rc, "[ %s ] ", self->name_ ) ;
-  }
-  n += sprintf( rc+n, "%d x %d %s\n", self->m_, self->n_, self->isVector?"Vector" : "" ) ;
-
-  for( int r=0 ; r<mm ; r++ ) {
-    for( int c=0 ; c<nn ; c++ ) {
-      n += sprintf( rc+n, "% 6.2f ", self->data_[ c * self->m_ + r ] ) ;
-    }
-    if( self->n_ > nn ) {
-      strcat( rc, " ..." ) ;
-      n+=4 ;
-    }
-    strcat( rc, "\n" ) ;
-    n++ ;
+  if( self->busy_ > 0 ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Matrix is in use by a background job, it can't be disposed")));
+    return ;
   }
-  if( self->m_ > mm ) {
-    for( int i=0 ; i<nn ; i++ ) {
-      strcat( rc, "  ...  " ) ;
-    }
-    strcat( rc, "\n" ) ;
+  if( !self->disposed_ ) {
+    self->Empty() ;
+    self->disposed_ = true ;
   }
-
-  args.GetReturnValue().Set( String::NewFromUtf8( isolate, rc) );
-  delete  rc ;
 }
 
-/** internally calls ToString. @see ToString */
-void WrappedArray::Inspect( const v8::FunctionCallbackInfo<v8::Value>& args )
+
+/** 
+	Negate a matrix
+
+	Returns a new matrix which is an copy of the target with each element sign reversed
+
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
+*/
+void WrappedArray::Neg( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  ToString( args ) ;
+  UnaryHelper( args, NegOp(), false ) ;
 }
 
+/** 
+	In place version of neg - the target is overwritten.
+
+	@see Neg
+	@return the target
+*/
+void WrappedArray::Negi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, NegOp(), true ) ;
+}
 
 
 /** 
-	Get a value from the matrix
+	Square root a matrix
 
-	Returns a value from the matrix at the X,Y. If a single index is given it is used an an absolute
-	address into the underlying store. Negative indices count from the end.
+	Returns a new matrix which is an copy of the target with each element 
+	being the square root of the target. Negative target values will result
+	in NaN entries.
 
-	@param [in,default=0] M the row index ( or the absolute index is N is missing )
-	@param [in,optional] N the column index
-	@return the value in the matrix at required
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
 */
-void WrappedArray::Get( const v8::FunctionCallbackInfo<v8::Value>& args )
+void WrappedArray::Sqrt( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-//  Local<Context> context = isolate->GetCurrentContext() ;
+  UnaryHelper( args, SqrtOp(), false ) ;
+}
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+/** 
+	In place version of sqrt - the target is overwritten.
 
-  int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
-  if( args[1]->IsUndefined() ) {
-    if( ::abs(m)>=(self->m_ * self->n_)) {
-      char *msg = new char[1000] ;
-      snprintf( msg, 1000, "Array index (%d) out of bounds, max length is %d", m, ((self->m_ * self->n_)-1) ) ;
-      Local<String> err = String::NewFromUtf8(isolate, msg);
-      isolate->ThrowException(Exception::TypeError( err ) );
-      delete msg ;
-    } else {
-      if( m<0) m = (self->m_ * self->n_) - m - 1 ;
-      args.GetReturnValue().Set( self->data_[m] );
-    }
-  } else {
-    int n = args[1]->NumberValue() ;
-    if( ::abs(m)>=self->m_ || ::abs(n)>=self->n_) {
-      char *msg = new char[1000] ;
-      snprintf( msg, 1000, "Array index (%d,%d) out of bounds  for matrix |%d x %d|", m, n, self->m_, self->n_ ) ;
-      Local<String> err = String::NewFromUtf8(isolate, msg);
-      isolate->ThrowException(Exception::TypeError( err ) );
-      delete msg ;
-    } else {
-      if( m<0) m = self->m_ - m - 1 ;
-      if( n<0) n = self->n_ - n - 1 ;
-      args.GetReturnValue().Set( self->data_[m+n*self->m_] );
-    }
-  }
+	@see Sqrt
+	@return the target
+*/
+void WrappedArray::Sqrti( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, SqrtOp(), true ) ;
 }
 
+/** 
+	Log a matrix
+
+	Returns a new matrix which is an copy of the target with each element being the 
+	natural log of the target. Since we're not doing complex values (yet:o), negative
+	and zero values will result in NaN
 
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
+*/
+void WrappedArray::Log( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, LogOp(), false ) ;
+}
 
 /** 
-	Set a value in the matrix
+	In place version of log - the target is overwritten.
 
-	Overwrites a the value in the matrix at the X,Y. If the target is a vector
-	only the first argument is used. If a single index is given it is used an an absolute
-	address into the underlying store. Negative indices count from the end.
+	@see Log
+	@return the target
+*/
+void WrappedArray::Logi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, LogOp(), true ) ;
+}
 
-	@param [in] value to set into the matrix
-	@param [in,default=0] M the row index ( or the absolute index is N is missing )
-	@param [in,optional] N the column index
-	@return the previous value in the matrix at location (m,n)
+
+/** 
+	Absolute value of matrix
+
+	Returns a new matrix which is an copy of the target with each element set to positive
+
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
 */
-void WrappedArray::Set( const v8::FunctionCallbackInfo<v8::Value>& args )
+void WrappedArray::Abs( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-//  Local<Context> context = isolate->GetCurrentContext() ;
+  UnaryHelper( args, AbsOp(), false ) ;
+}
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+/** 
+	In place version of abs - the target is overwritten.
 
-  if( args[0]->IsUndefined() ) {
-    Local<String> err = String::NewFromUtf8(isolate, "Missing value to set into a matrix");
-    isolate->ThrowException(Exception::TypeError( err ) );
-  } else {
-    float newValue = args[0]->NumberValue() ;
-    int m = args[1]->IsUndefined() ? 0 : args[1]->NumberValue() ;
-    if( args[2]->IsUndefined() ) {
-      if( ::abs(m)>=(self->m_ * self->n_)) {
-        char *msg = new char[1000] ;
-        snprintf( msg, 1000, "Array index (%d) out of bounds, max length is %d", m, ((self->m_ * self->n_)-1) ) ;
-        Local<String> err = String::NewFromUtf8(isolate, msg);
-        isolate->ThrowException(Exception::TypeError( err ) );
-        delete msg ;
-      } else {
-	if( m<0) m = (self->m_ * self->n_) - m - 1 ;
-        args.GetReturnValue().Set( self->data_[m] );
-        self->data_[m] = newValue ;
-      }
-    } else {
-      int n = args[2]->NumberValue() ;
-      if( ::abs(m)>=self->m_ || ::abs(n)>=self->n_) {
-        char *msg = new char[1000] ;
-        snprintf( msg, 1000, "Array index (%d,%d) out of bounds  for matrix |%d x %d|", m, n, self->m_, self->n_ ) ;
-        Local<String> err = String::NewFromUtf8(isolate, msg);
-        isolate->ThrowException(Exception::TypeError( err ) );
-        delete msg ;
-      } else {
-	if( m<0) m = self->m_ - m - 1 ;
-	if( n<0) n = self->n_ - n - 1 ;
-        args.GetReturnValue().Set( self->data_[m+n*self->m_] );
-        self->data_[m+n*self->m_] = newValue ;
-      }
-    }
-  }
+	@see Abs
+	@return the target
+*/
+void WrappedArray::Absi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, AbsOp(), true ) ;
 }
 
 
+/** 
+	Exponential of a matrix
+
+	Returns a new matrix which is a copy of the target with each element 
+	being e raised to the target element.
+
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
+*/
+void WrappedArray::Exp( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, ExpOp(), false ) ;
+}
 
 /** 
-	Duplicate a matrix
+	In place version of exp - the target is overwritten.
 
-	Returns a new matrix which is an identical copy of the target
+	@see Exp
+	@return the target
 */
-void WrappedArray::Dup( const v8::FunctionCallbackInfo<v8::Value>& args )
+void WrappedArray::Expi( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
+  UnaryHelper( args, ExpOp(), true ) ;
+}
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ; ;
 
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+/** 
+	Hyperbolic tangent of a matrix
 
-  scope.Escape( instance );
+	Returns a new matrix which is a copy of the target with each element 
+	being the tanh of the target element.
 
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  memcpy( result->data_, self->data_, sizeof(float) * self->m_ * self->n_ ) ;
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
+*/
+void WrappedArray::Tanh( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, TanhOp(), false ) ;
+}
+
+/** 
+	In place version of tanh - the target is overwritten.
+
+	@see Tanh
+	@return the target
+*/
+void WrappedArray::Tanhi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, TanhOp(), true ) ;
 }
 
 
 /** 
-	Negate a matrix
+	Logistic function of a matrix
 
-	Returns a new matrix which is an copy of the target with each element sign reversed
+	Returns a new matrix which is a copy of the target with each element 
+	x replaced by 1 / ( 1 + e^-x ).
 
-	It takes 0 args:
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
 */
-void WrappedArray::Neg( const v8::FunctionCallbackInfo<v8::Value>& args )
+void WrappedArray::Sigmoid( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
+  UnaryHelper( args, SigmoidOp(), false ) ;
+}
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ; ;
+/** 
+	In place version of sigmoid - the target is overwritten.
 
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+	@see Sigmoid
+	@return the target
+*/
+void WrappedArray::Sigmoidi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, SigmoidOp(), true ) ;
+}
 
-  scope.Escape( instance );
 
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  int sz = self->m_ * self->n_  ;
-  for( int i=0 ; i<sz ; i++ ) {
-	result->data_[i] = -self->data_[i] ;
-  }
+/** 
+	Rectified linear unit of a matrix
+
+	Returns a new matrix which is a copy of the target with each negative 
+	element set to 0.
+
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
+*/
+void WrappedArray::Relu( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, ReluOp(), false ) ;
+}
+
+/** 
+	In place version of relu - the target is overwritten.
+
+	@see Relu
+	@return the target
+*/
+void WrappedArray::Relui( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, ReluOp(), true ) ;
 }
 
 
 /** 
-	Square root a matrix
+	Softplus of a matrix
 
-	Returns a new matrix which is an copy of the target with each element 
-	being the square root of the target. Negative target values will result
-	in NaN entries.
+	Returns a new matrix which is a copy of the target with each element 
+	x replaced by log( 1 + e^x ), a smooth relu. Big elements don't overflow
+	and small ones don't lose their digits.
 
-	It takes 0 args:
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return the new matrix, or the output matrix
 */
-void WrappedArray::Sqrt( const v8::FunctionCallbackInfo<v8::Value>& args )
+void WrappedArray::Softplus( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
+  UnaryHelper( args, SoftplusOp(), false ) ;
+}
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ; ;
+/** 
+	In place version of softplus - the target is overwritten.
 
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+	@see Softplus
+	@return the target
+*/
+void WrappedArray::Softplusi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  UnaryHelper( args, SoftplusOp(), true ) ;
+}
 
-  scope.Escape( instance );
 
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  int sz = self->m_ * self->n_  ;
-  for( int i=0 ; i<sz ; i++ ) {
-	result->data_[i] = ::sqrt( self->data_[i] ) ;
+/*
+	Read the dimension arg of softmax, logsumexp & crossEntropy. A vector
+	is always taken as a whole, ignoring the arg.
+	@return 0 for columns, 1 for rows or -1 ( with an exception thrown ) if it's neither
+*/
+static int ReadDimension( const FunctionCallbackInfo<Value>& args, Local<Value> arg, bool isVector, int m )
+{
+  if( isVector ) return m == 1 ? 1 : 0 ;
+  if( arg->IsUndefined() ) return 0 ;
+  int dimension = arg->IsNumber() ? arg->NumberValue() : -1 ;
+  if( dimension != 0 && dimension != 1 ) {
+    Isolate* isolate = args.GetIsolate();
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Dimension must be 0 ( columns ) or 1 ( rows )")));
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return -1 ;
   }
+  return dimension ;
 }
 
+
 /** 
-	Log a matrix
+	Softmax of the rows or columns of a matrix
 
-	Returns a new matrix which is an copy of the target with each element being the 
-	natural log of the target. Since we're not doing complex values (yet:o), negative
-	and zero values will result in NaN
+	Each column ( or row ) of the result is e^x divided by the sum of the
+	e^x in that column ( or row ), so it's all positive and adds up to 1. 
+	The biggest element is taken off first, so big values don't overflow.
+	A vector is done as a whole.
+
+	\code{.js}
 
-	It takes 0 args:
+	var P = Z.softmax() ;		// each column of Z holds the scores for one sample
+	Z.softmax( 1, Z ) ;		// each row, in place
+
+	\endcode
+
+	@param [in,default=0] the dimension to normalize - 0 = columns, 1 = rows
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix. It may be the target.
+	@return the new matrix, or the output matrix
 */
-void WrappedArray::Log( const v8::FunctionCallbackInfo<v8::Value>& args )
+void WrappedArray::Softmax( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  int dimension = ReadDimension( args, args[0], self->isVector, self->m_ ) ;
+  if( dimension < 0 ) return ;
+  WrappedArray* result = MakeResult( args, 1, self->m_, self->n_ ) ;
+  if( result == NULL ) return ;
+
+  std::vector<float> lse( dimension == 0 ? self->n_ : self->m_ ) ;
+  LogSumExpOf( self, dimension, lse.data(), result->data_, result->ld_ ) ;
+}
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ;
 
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+/** 
+	Log of the sum of the exps of the rows or columns of a matrix
 
-  scope.Escape( instance );
+	log( sum( e^x ) ) of each column or row, worked out without overflow. 
+	If the target is a vector this returns a number.
 
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  int sz = self->m_ * self->n_  ;
-  for( int i=0 ; i<sz ; i++ ) {
-	result->data_[i] = ::log( self->data_[i] ) ;
+	@param [in,default=0] the dimension to reduce - 0 = columns, 1 = rows.
+	@return a 1xN vector ( columns ), Mx1 vector ( rows ) or a number if the target is a vector.
+*/
+void WrappedArray::LogSumExp( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  int dimension = ReadDimension( args, args[0], self->isVector, self->m_ ) ;
+  if( dimension < 0 ) return ;
+
+  if( self->isVector ) {
+    float rc ;
+    LogSumExpOf( self, dimension, &rc, NULL, 0 ) ;
+    args.GetReturnValue().Set( rc );
+  } else {
+    WrappedArray* result = MakeResult( args, -1, dimension == 0 ? 1 : self->m_, dimension == 0 ? self->n_ : 1 ) ;
+    LogSumExpOf( self, dimension, result->data_, NULL, 0 ) ;
   }
 }
 
 
 /** 
-	Absolute value of matrix
+	Cross entropy loss and its gradient
 
-	Returns a new matrix which is an copy of the target with each element set to positive
+	The target holds the scores ( logits ) for some samples, each column is
+	a sample ( dimension 0 ) or each row is ( dimension 1 ). Y is the same
+	shape, the true class probabilities - usually one hot. The loss is the
+	mean over the samples of -sum( y log( softmax( z ) ) ), the gradient
+	is ( softmax( Z ) - Y ) / samples. Both come from one pass over the 
+	data with the softmax never stored.
 
-	It takes 0 args:
-*/
-void WrappedArray::Abs( const v8::FunctionCallbackInfo<v8::Value>& args )
-{
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
+	When a sample is a single score ( e.g. an Mx1 matrix and dimension 1 )
+	it's the logistic loss: -y log( sigmoid( z ) ) - ( 1 - y ) log( 1 - sigmoid( z ) ),
+	the gradient is ( sigmoid( Z ) - Y ) / samples.
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ; ;
+	\code{.js}
 
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+	// logistic regression: X is samples x features, y is samples x 1 of 0 or 1
+	function objective( X, y ) {
+		this.value = function( w ) { return X.mul( w ).crossEntropy( y, 1 ).loss ; } ;
+		this.gradient = function( w ) { return X.t().mul( X.mul( w ).crossEntropy( y, 1 ).gradient ) ; } ;
+	}
 
-  scope.Escape( instance );
+	\endcode
 
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  int sz = self->m_ * self->n_  ;
-  for( int i=0 ; i<sz ; i++ ) {
-	result->data_[i] = ::abs( self->data_[i] ) ;
+	@param [in] the MxN matrix of targets
+	@param [in,default=0] which way the samples run - 0 = a column per sample, 1 = a row per sample
+	@return an object { loss: Number, gradient: lalg.Array } 
+*/
+void WrappedArray::CrossEntropy( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  if( !IsMatrix( isolate, args[0] ) ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "crossEntropy needs a matrix of targets")));
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+  WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() ) ;
+  if( other->disposed_ ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Matrix has been disposed")));
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+  if( other->m_ != self->m_ || other->n_ != self->n_ ) {
+    char *msg = new char[ 1000 ] ;
+    snprintf( msg, 1000, "Incompatible args: |%d x %d| crossEntropy |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    delete [] msg ;
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+  int dimension = ReadDimension( args, args[1], false, self->m_ ) ;
+  if( dimension < 0 ) return ;
+
+  Local<Object> gradient ;
+  WrappedArray* result = MakeResult( args, -1, self->m_, self->n_, &gradient ) ;
+
+  const SimdKernels &k = Simd::Kernels() ;
+  const int m = self->m_ ;
+  const int classes = dimension == 0 ? self->m_ : self->n_ ;
+  const int samples = dimension == 0 ? self->n_ : self->m_ ;
+  const float scale = 1.f / samples ;
+
+  ThreadPool &pool = ThreadPool::Instance() ;
+  std::vector<float> partial( pool.RangeCount( self->n_, m ), 0.f ) ;
+  if( classes == 1 ) {		// logistic: softplus( z ) - y z
+    pool.Ranges( self->n_, m, [&]( size_t piece, size_t begin, size_t end ) {
+      float sp[ 256 ] ;
+      for( size_t c=begin ; c<end ; c++ ) {
+        const float *z = self->data_ + c*self->ld_ ;
+        const float *y = other->data_ + c*other->ld_ ;
+        float *g = result->data_ + c*result->ld_ ;
+        for( int i=0 ; i<m ; i+=256 ) {
+          int len = std::min( 256, m-i ) ;
+          k.softplus( z+i, sp, len ) ;
+          for( int r=0 ; r<len ; r++ ) partial[piece] += sp[r] - y[i+r] * z[i+r] ;
+          k.sigmoid( z+i, g+i, len ) ;
+        }
+        k.sub( g, y, g, m ) ;
+        k.mulScalar( g, scale, g, m ) ;
+      }
+    } ) ;
+  } else {			// softmax: sum of y ( lse - z ) for each sample
+    std::vector<float> lse( samples ) ;
+    LogSumExpOf( self, dimension, lse.data(), result->data_, result->ld_ ) ;
+    pool.Ranges( self->n_, m, [&]( size_t piece, size_t begin, size_t end ) {
+      for( size_t c=begin ; c<end ; c++ ) {
+        const float *z = self->data_ + c*self->ld_ ;
+        const float *y = other->data_ + c*other->ld_ ;
+        float *g = result->data_ + c*result->ld_ ;
+        for( int r=0 ; r<m ; r++ ) {
+          if( y[r] != 0 ) partial[piece] += y[r] * ( ( dimension == 0 ? lse[c] : lse[r] ) - z[r] ) ;
+        }
+        k.sub( g, y, g, m ) ;
+        k.mulScalar( g, scale, g, m ) ;
+      }
+    } ) ;
   }
+  float loss = 0 ;
+  for( size_t i=0 ; i<partial.size() ; i++ ) loss += partial[i] ;
+
+  Local<Object> rc = Object::New(isolate);
+  rc->Set(String::NewFromUtf8(isolate, "loss"), Number::New( isolate, loss * scale ) );
+  rc->Set(String::NewFromUtf8(isolate, "gradient"), gradient );
+  args.GetReturnValue().Set( rc );
 }
 
 
@@ -726,39 +4630,21 @@ void WrappedArray::Abs( const v8::FunctionCallbackInfo<v8::Value>& args )
 	@param [in] the number to find ( default 1 )
 	@param [in] the value to pop into the matching elements
 	@param [in] the accuracy to find a match default 0.000001
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
 */
 void WrappedArray::Find( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
-
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ; ;
-
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-
-  scope.Escape( instance );
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  WrappedArray* result = MakeResult( args, 3, self->m_, self->n_ ) ;
+  if( result == NULL ) return ;
 
   float x = args[0]->IsUndefined() ? 1 : args[0]->NumberValue() ;
   float epsilon = (args[1]->IsUndefined() || args[1]->IsNull() ) ? 0.000001 : args[1]->NumberValue() ;
 	
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  int sz = self->m_ * self->n_  ;
-
-  if( args[2]->IsUndefined() ) {
-    for( int i=0 ; i<sz ; i++ ) {
-      result->data_[i] = ::abs( self->data_[i] - x ) < epsilon ? self->data_[i] : 0.0 ;
-    }
-  }  else {
-    float v = args[2]->IsUndefined() ? 0 : args[2]->NumberValue() ;
-    for( int i=0 ; i<sz ; i++ ) {
-      result->data_[i] = ::abs( self->data_[i] - x ) < epsilon ? v : 0.0 ;
-    }
-  }
+  bool keep = args[2]->IsUndefined() ;
+  FindNearOp op = { x, epsilon, keep ? 0.f : (float)args[2]->NumberValue(), keep } ;
+  ApplyUnary( self, result, op ) ;
 }
 
 
@@ -772,40 +4658,20 @@ void WrappedArray::Find( const v8::FunctionCallbackInfo<v8::Value>& args )
 
 	@param [in] the number to find ( default 1 )
 	@param [in] the value to pop into the matching elements
-
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
 */
 void WrappedArray::FindLessEqual( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
-
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ; ;
-
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-
-  scope.Escape( instance );
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  WrappedArray* result = MakeResult( args, 2, self->m_, self->n_ ) ;
+  if( result == NULL ) return ;
 
   float x = args[0]->IsUndefined() ? 1 : args[0]->NumberValue() ;
 
-
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  int sz = self->m_ * self->n_  ;
-
-  if( args[1]->IsUndefined() ) {
-    for( int i=0 ; i<sz ; i++ ) {
-      result->data_[i] = self->data_[i] <= x ? self->data_[i] : 0.0 ;
-    }
-  }  else {
-    float v = args[1]->IsUndefined() ? 0 : args[1]->NumberValue() ;
-    for( int i=0 ; i<sz ; i++ ) {
-      result->data_[i] = self->data_[i] <= x ? v : 0.0 ;
-    }
-  }
+  bool keep = args[1]->IsUndefined() ;
+  FindLessEqualOp op = { x, keep ? 0.f : (float)args[1]->NumberValue(), keep } ;
+  ApplyUnary( self, result, op ) ;
 }
 
 
@@ -819,53 +4685,53 @@ void WrappedArray::FindLessEqual( const v8::FunctionCallbackInfo<v8::Value>& arg
 
 	@param [in] the number to find ( default 1 )
 	@param [in] the value to pop into the matching elements
-
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
 */
 void WrappedArray::FindGreater( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
-
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  EscapableHandleScope scope(isolate) ; ;
-
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-
-  scope.Escape( instance );
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  WrappedArray* result = MakeResult( args, 2, self->m_, self->n_ ) ;
+  if( result == NULL ) return ;
 
   float x = args[0]->IsUndefined() ? 1 : args[0]->NumberValue() ;
 
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
-  int sz = self->m_ * self->n_  ;
-  if( args[1]->IsUndefined() ) {
-    for( int i=0 ; i<sz ; i++ ) {
-      result->data_[i] = self->data_[i] > x ? self->data_[i] : 0.0 ;
-    }
-  }  else {
-    float v = args[1]->IsUndefined() ? 0 : args[1]->NumberValue() ;
-    for( int i=0 ; i<sz ; i++ ) {
-      result->data_[i] = self->data_[i] > x ? v : 0.0 ;
-    }
-  }
+  bool keep = args[1]->IsUndefined() ;
+  FindGreaterOp op = { x, keep ? 0.f : (float)args[1]->NumberValue(), keep } ;
+  ApplyUnary( self, result, op ) ;
 }
 
 /** 
 	Transpose a matrix
 
-	Returns a new matrix which is an transpose of the target.
+	Returns a new matrix which is an transpose of the target. The copy is
+	done in cache sized tiles, spread over the thread pool.
 
-	It takes 0 args:
+	Pass true to get a transposed view instead - nothing is copied. 
+	mul & mulp read a view straight from the matrix ( sgemm's transpose 
+	flags ), anything else is done on a transposed copy. @see T
+
+	\code{.js}
+
+	var G = X.transpose( true ).mul( X ) ;	// X'X, no copy of X
+
+	\endcode
+
+	@param [in,optional] true for a transposed view
+	@return a new matrix, or a lalg.TransposedArray view
 */
 void WrappedArray::Transpose( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  if( args[0]->IsTrue() ) {
+    args.GetReturnValue().Set( TransposedMatrix::FromArray( isolate, args.Holder() ) ) ;
+    return ;
+  }
 
   EscapableHandleScope scope(isolate) ; ;
 
@@ -878,20 +4744,12 @@ void WrappedArray::Transpose( const v8::FunctionCallbackInfo<v8::Value>& args )
   scope.Escape( instance );
   WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
 
-// Now do the transpose. It's easy since we have a new memory buffer
-// in palce transposition is difficult and slow
+// Now do the transpose, tile by tile into the new memory buffer
   if( !result->isVector ) {	// no need to transpose a vector's data
-    float *data = result->data_ ;
-    int ixa = 0 ;
-    for( int r=0 ; r<self->m_ ; r++ ) {
-      int ixb = r ;
-      for( int c=0 ; c<self->n_ ; c++ ) {
-        data[ixa++] = self->data_[ixb+(c*self->m_)] ;
-      }
-    }
+    Transposer::Copy( self->data_, self->ld_, self->m_, self->n_, result->data_, result->ld_ ) ;
   }
   else {
-    memcpy( result->data_, self->data_, self->m_ * self->n_ * sizeof(float) ) ;
+    self->CopyTo( result->data_ ) ;
   }
 
 // Set the resturn to be the new copy of ourself
@@ -899,6 +4757,66 @@ void WrappedArray::Transpose( const v8::FunctionCallbackInfo<v8::Value>& args )
 }
 
 
+/** 
+	A transposed view of a matrix, the same as transpose( true )
+
+	\code{.js}
+
+	var C = A.t().mul( B.t() ) ;	// A'B'
+
+	\endcode
+
+	@return a lalg.TransposedArray sharing the target's data
+*/
+void WrappedArray::T( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  args.GetReturnValue().Set( TransposedMatrix::FromArray( isolate, args.Holder() ) ) ;
+}
+
+
+/** 
+	Transpose a matrix in place
+
+	The target becomes its own transpose, without a second copy of the 
+	data. A square matrix ( or view ) swaps tiles across the diagonal, 
+	which is as quick as transpose(). Any other shape follows the cycles 
+	of the permutation - that jumps all over memory and is much slower, 
+	use it when there isn't room for transpose()'s copy. A view of a
+	non square block gets its own data first.
+
+	\code{.js}
+
+	var A = lalg.rand( 20000, 20000 ) ;
+	A.transposei() ;
+
+	\endcode
+
+	@return the target
+*/
+void WrappedArray::Transposei( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  args.GetReturnValue().Set( args.Holder() );
+
+  self->MakeWritable() ;
+  if( self->m_ == self->n_ ) {
+    Transposer::Square( self->data_, self->n_, self->ld_ ) ;
+    return ;
+  }
+  self->Unshare() ;		// the shape changes, so it needs its own packed data
+  Transposer::InPlace( self->data_, self->m_, self->n_ ) ;
+  int tmp = self->m_ ;
+  self->m_ = self->n_ ;
+  self->n_ = tmp ;
+  self->ld_ = self->m_ ;
+}
+
+
 
 /**
 	Mul - multiply a matrix
@@ -908,9 +4826,26 @@ void WrappedArray::Transpose( const v8::FunctionCallbackInfo<v8::Value>& args )
 	are to be multiplied, consider Mulp. If a scalar is passed in all elements in the
 	array are multiplied by it.
 	
+	The result can be written into an existing MxN matrix, which must not share
+	data with the target or other. An optional beta adds the product to the output 
+	( out = A*B + beta*out ), like the beta & C arguments of sgemm.
+
+	\code{.js}
+
+	A.mul( B, C ) ;		// C = A*B
+	A.mul( B, C, 1 ) ;	// C += A*B
+	
+	\endcode
+
+	The other matrix may be a QuantizedArray ( @see Quantize ), it's widened to
+	float a few columns at a time as it's multiplied. Or it may be a SparseArray,
+	then only the columns of A picked out by its non zeros are read.
+
 	@see Mulp for a version which returns a promise
 	@param the other matrix or a number
-	@return a new matrix 
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@param [in,optional] beta, the multiple of out to add to the product, default 0
+	@return a new matrix, or the output matrix
 */
 void WrappedArray::Mul( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
@@ -933,6 +4868,8 @@ void WrappedArray::Mul( const v8::FunctionCallbackInfo<v8::Value>& args )
 	
 	@see Mul for a version which is blocking
 	@param [in] the other matrix
+	@param [in,optional] an MxN matrix to write the result into @see Mul
+	@param [in,optional] beta, the multiple of out to add to the product ( only after out )
 	@param [in] a callback of prototype function(err,MATRIX){ }
 	@return a promise which will resolve to a new Matrix
 
@@ -949,29 +4886,119 @@ void WrappedArray::Mulp( const v8::FunctionCallbackInfo<v8::Value>& args ) {
 void WrappedArray::MulHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex ) {
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
-
-  EscapableHandleScope scope(isolate) ;
   
 // Get the 2 matrices to multiply
-  WrappedArray *self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+// An output matrix may follow the other matrix, and a beta may follow that. Or
+// there's an object of options. Either pushes the callback along.
+// The transpose flags go to the work in xtraInt: 1 = transA, 2 = transB
+  Local<Value> out = Undefined( isolate ) ;
+  float alpha = 1.f ;
+  float beta = 0.f ;
+  int trans = 0 ;
+  if( IsMatrix( isolate, args[1] ) ) {
+    out = args[1] ;
+    callbackIndex++ ;
+    if( args[2]->IsNumber() ) {
+      beta = args[2]->NumberValue() ;
+      callbackIndex++ ;
+    }
+  } else if( args[1]->IsObject() && !args[1]->IsFunction() ) {
+    Local<Object> options = args[1]->ToObject() ;
+    if( options->Get( context, String::NewFromUtf8(isolate, "transA") ).ToLocalChecked()->BooleanValue() ) trans |= 1 ;
+    if( options->Get( context, String::NewFromUtf8(isolate, "transB") ).ToLocalChecked()->BooleanValue() ) trans |= 2 ;
+    Local<Value> a = options->Get( context, String::NewFromUtf8(isolate, "alpha") ).ToLocalChecked() ;
+    if( a->IsNumber() ) {
+      alpha = a->NumberValue() ;
+    }
+    Local<Value> b = options->Get( context, String::NewFromUtf8(isolate, "beta") ).ToLocalChecked() ;
+    if( b->IsNumber() ) {
+      beta = b->NumberValue() ;
+    }
+    out = options->Get( context, String::NewFromUtf8(isolate, "out") ).ToLocalChecked() ;
+    callbackIndex++ ;
+  }
+
 // 2 choices - multiply by a scalar ( args[0] is a scalar)
 // The matrix results may be different sizes depending on scalar or matrix multiply mode
+// A sparse or quantized other matrix has its own multiply, the matrix
+// goes along with the work as xtraObj ( to keep it alive ) & xtraPtr
+  WrappedArray *result = NULL ;
+  Local<Object> instance ;
+  uv_work_cb work_cb = WrappedArray::MulpWorkAsync ;
+  Local<Object> xtraObj ;
+  void *xtraPtr = NULL ;
+  int otherRows = 0 ;
+  int otherCols = 0 ;
+  if( QuantizedMatrix::IsMatrix( isolate, args[0] ) ) {
+    QuantizedMatrix *other = ObjectWrap::Unwrap<QuantizedMatrix>( args[0]->ToObject() ) ;
+    otherRows = other->m_ ;
+    otherCols = other->n_ ;
+    xtraPtr = other ;
+    work_cb = QuantizedMatrix::MulLeftWorkAsync ;
+  } else if( SparseMatrix::IsMatrix( isolate, args[0] ) ) {
+    SparseMatrix *other = ObjectWrap::Unwrap<SparseMatrix>( args[0]->ToObject() ) ;
+    otherRows = other->csc_.m ;
+    otherCols = other->csc_.n ;
+    xtraPtr = other ;
+    work_cb = SparseMatrix::DenseMulWorkAsync ;
+  }
+
+  if( xtraPtr != NULL && ( trans != 0 || alpha != 1.f ) ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "transA, transB and alpha need a lalg.Array to multiply by") ) );
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+
+// A transposed view is its matrix with transB flipped. The view goes along 
+// as xtraObj to keep the matrix alive.
+  WrappedArray *other = NULL ;
+  if( TransposedMatrix::IsMatrix( isolate, args[0] ) ) {
+    other = TransposedMatrix::Base( isolate, args[0]->ToObject() ) ;
+    if( other == NULL ) return ;
+    xtraObj = args[0]->ToObject() ;
+    trans ^= 2 ;
+  } else if( IsMatrix( isolate, args[0] ) ) {
+    other = ObjectWrap::Unwrap<WrappedArray>(args[0]->ToObject());
+  }
+
   if( args[0]->IsNumber() ) { 
-    const unsigned argc = 2;
-    Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-    Local<Function> cons = Local<Function>::New(isolate, constructor);
-    Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-    scope.Escape( instance ) ;
-    WrappedArray::PrepareWork( args, block, callbackIndex, WrappedArray::MulpWorkAsync, instance ) ;
-  } else {   // not a number other item is a matrix
-    WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>(args[0]->ToObject());    
-    const unsigned argc = 2;
-    Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,other->n_ ) };
-    Local<Function> cons = Local<Function>::New(isolate, constructor);
-    Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-    scope.Escape( instance ) ;
-    WrappedArray::PrepareWork( args, block, callbackIndex, WrappedArray::MulpWorkAsync, instance ) ;
+    result = MakeResult( args, out, self->m_, self->n_, &instance ) ;
+  } else if( xtraPtr != NULL ) {
+    if( self->n_ != otherRows ) {
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "Incompatible args: |%d x %d| x |%d x %d|", self->m_, self->n_, otherRows, otherCols ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      args.GetReturnValue().Set( Undefined(isolate) );
+      return ;
+    }
+    xtraObj = args[0]->ToObject() ;
+    result = MakeResult( args, out, self->m_, otherCols, &instance ) ;
+    if( result != NULL && result->storage_ == self->storage_ ) {
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Output matrix must not share data with the matrices being multiplied") ) );
+      args.GetReturnValue().Set( Undefined(isolate) );
+      result = NULL ;
+    }
+  } else if( other != NULL ) {
+    int m = ( trans & 1 ) ? self->n_ : self->m_ ;
+    int n = ( trans & 2 ) ? other->m_ : other->n_ ;
+    result = MakeResult( args, out, m, n, &instance ) ;
+    // sgemm can't write over its own inputs
+    if( result != NULL && ( result->storage_ == self->storage_ || result->storage_ == other->storage_ ) ) {
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Output matrix must not share data with the matrices being multiplied") ) );
+      args.GetReturnValue().Set( Undefined(isolate) );
+      result = NULL ;
+    }
+  } else {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected a number or a matrix to multiply by") ) );
+    args.GetReturnValue().Set( Undefined(isolate) );
   }
+  if( result == NULL ) return ;
+
+  WrappedArray::PrepareWork( args, block, callbackIndex, work_cb, instance, xtraObj, trans, beta, NULL, xtraPtr, other, alpha ) ;
 }
 
 
@@ -980,6 +5007,9 @@ void WrappedArray::MulHelper( const v8::FunctionCallbackInfo<v8::Value>& args, b
 	the Work structure, do the multiply and return.
 	This may, or may not, be called in a different thread that the caller's context
 	Be aware of Local<...> and Persistent<...> data elements.
+
+	xtraInt holds the transpose flags ( 1 = A', 2 = B' ), the matrices 
+	themselves are never moved - sgemm reads them transposed.
 */
 void WrappedArray::MulpWorkAsync(uv_work_t *req) {
   Work *work = static_cast<Work *>(req->data);   
@@ -988,34 +5018,34 @@ void WrappedArray::MulpWorkAsync(uv_work_t *req) {
   WrappedArray* result = work->result ;
 
   if( work->other == NULL ) {	// no other matrix? Then we'll use a scalar multiply
-    float x = work->otherNumber ;
-    int sz = self->m_ * self->n_ ;
-    float *data = result->data_ ;
-    float *a = self->data_ ;
-    for( int i=0 ; i<sz ; i++ ) {
-	*data++ = *a++ * x ;
-    }	
+    ApplyScalar( self, work->otherNumber, result, MulOp() ) ;
   } else {
     WrappedArray* other = work->other ;
-    if( self->n_ != other->m_ ) {
+    bool transA = ( work->xtraInt & 1 ) != 0 ;
+    bool transB = ( work->xtraInt & 2 ) != 0 ;
+    int m = transA ? self->n_ : self->m_ ;
+    int k = transA ? self->m_ : self->n_ ;
+    int kb = transB ? other->n_ : other->m_ ;
+    int n = transB ? other->m_ : other->n_ ;
+    if( k != kb ) {
       work->err = new char[ 1000 ] ;	// set the error flag and abort
-      snprintf( work->err, 1000, "Incompatible args: |%d x %d| x |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+      snprintf( work->err, 1000, "Incompatible args: |%d x %d|%s x |%d x %d|%s", 
+		self->m_, self->n_, transA ? "'" : "", other->m_, other->n_, transB ? "'" : "" ) ;
     } else {
-      cblas_sgemm(
-          CblasColMajor,
-          CblasNoTrans,
-          CblasNoTrans,
-          self->m_,
-          other->n_,
-          self->n_,
-          1.f,
+      Blas<float>::gemm(
+          transA ? CblasTrans : CblasNoTrans,
+          transB ? CblasTrans : CblasNoTrans,
+          m,
+          n,
+          k,
+          work->alpha,
           self->data_,
-          self->m_,
+          std::max( 1, self->ld_ ),
           other->data_,
-          other->m_,
-          0.f,
+          std::max( 1, other->ld_ ),
+          work->xtraFloat,	// beta - non zero to add to the output matrix
           result->data_,
-          result->m_ );
+          std::max( 1, result->ld_ ) );
     }
   }
 }
@@ -1027,11 +5057,9 @@ void WrappedArray::MulpWorkAsync(uv_work_t *req) {
 */
 void WrappedArray::Asum( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  float rc = cblas_sasum(
-    self->m_ * self->n_ ,
-    self->data_,
-    1 ) ;
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  float rc = ReduceAll( self, []( const float *a, int len, int stride ) { return Blas<float>::asum( len, a, stride ) ; } ) ;
   args.GetReturnValue().Set( rc );
 }
 
@@ -1050,15 +5078,12 @@ void WrappedArray::Sum( const v8::FunctionCallbackInfo<v8::Value>& args )
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
 // If target is a vector ignore the dimensions
   if( self->isVector ) {
-    float rc = 0 ;
-    int l = self->m_ * self->n_ ;
-    for( int i=0 ; i<l ; i++ ) {
-      rc += self->data_[i] ;
-    }
+    double rc = ReduceAll( self, []( const float *a, int len, int stride ) { return SumRun( a, len, stride, false ) ; } ) ;
     args.GetReturnValue().Set( rc );
   }
   else {
@@ -1078,24 +5103,11 @@ void WrappedArray::Sum( const v8::FunctionCallbackInfo<v8::Value>& args )
     args.GetReturnValue().Set( instance );
 
     if( dimension == 0 ) {       // sum columns to 1xn vector
-      int ix = 0 ;
-      for( int c=0 ; c<self->n_ ; c++ ) {
-        result->data_[c] = 0 ;
-        for( int r=0 ; r<self->n_ ; r++ ) {
-          result->data_[c] += self->data_[ix++] ;
-        }
-      }
+      SumColumns( self, result->data_, false ) ;
     }
 
     if( dimension == 1 ) {       // sum rows to mx1 vector
-      for( int r=0 ; r<self->m_ ; r++ ) {
-        result->data_[r] = 0 ;
-        int ix = r ;
-        for( int c=0 ; c<self->n_ ; c++ ) {
-          result->data_[r] += self->data_[ix] ;
-          ix+=m ;
-        }
-      }
+      SumRows( self, result->data_, false ) ;
     }
   }
 }
@@ -1115,15 +5127,12 @@ void WrappedArray::Norm( const v8::FunctionCallbackInfo<v8::Value>& args )
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
 // If target is a vector ignore the dimensions
   if( self->isVector ) {
-    float rc = 0 ;
-    int l = self->m_ * self->n_ ;
-    for( int i=0 ; i<l ; i++ ) {
-      rc += self->data_[i] * self->data_[i] ;
-    }
+    double rc = ReduceAll( self, []( const float *a, int len, int stride ) { return SumRun( a, len, stride, true ) ; } ) ;
     args.GetReturnValue().Set( ::sqrt( rc ) );
   }
   else {
@@ -1143,27 +5152,13 @@ void WrappedArray::Norm( const v8::FunctionCallbackInfo<v8::Value>& args )
     args.GetReturnValue().Set( instance );
 
     if( dimension == 0 ) {       // sum columns to 1xn vector
-      int ix = 0 ;
-      for( int c=0 ; c<self->n_ ; c++ ) {
-        result->data_[c] = 0 ;
-        for( int r=0 ; r<self->n_ ; r++ ) {
-          result->data_[c] += self->data_[ix] * self->data_[ix] ;
-	  ix++ ;
-        }
-	result->data_[c] = ::sqrt( result->data_[c] ) ;
-      }
+      SumColumns( self, result->data_, true ) ;
+      SqrtOp().Span( result->data_, result->data_, self->n_ ) ;
     }
 
     if( dimension == 1 ) {       // sum rows to mx1 vector
-      for( int r=0 ; r<self->m_ ; r++ ) {
-        result->data_[r] = 0 ;
-        int ix = r ;
-        for( int c=0 ; c<self->n_ ; c++ ) {
-          result->data_[r] += self->data_[ix] * self->data_[ix] ;
-          ix+=m ;
-        }
-	result->data_[r] = ::sqrt( result->data_[r] ) ;
-      }
+      SumRows( self, result->data_, true ) ;
+      SqrtOp().Span( result->data_, result->data_, self->m_ ) ;
     }
   }
 }
@@ -1185,15 +5180,12 @@ void WrappedArray::Mean( const v8::FunctionCallbackInfo<v8::Value>& args )
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   if( self->isVector ) {
-    float rc = 0 ;
-    int l = self->m_ * self->n_ ;
-    for( int i=0 ; i<l ; i++ ) {
-      rc += self->data_[i] ;
-    }
-    rc /= l ;
+    double rc = ReduceAll( self, []( const float *a, int len, int stride ) { return SumRun( a, len, stride, false ) ; } ) ;
+    rc /= self->m_ * self->n_ ;
     args.GetReturnValue().Set( rc );
   }
   else {
@@ -1213,28 +5205,91 @@ void WrappedArray::Mean( const v8::FunctionCallbackInfo<v8::Value>& args )
     args.GetReturnValue().Set( instance );
 
     if( dimension == 0 ) {       // sum columns to 1xn vector
-      int ix = 0 ;
-      for( int c=0 ; c<self->n_ ; c++ ) {
-        result->data_[c] = 0 ;
-        for( int r=0 ; r<self->m_ ; r++ ) {
-          result->data_[c] += self->data_[ix++] ;
-        }
-        result->data_[c] /= self->m_ ;
-      }
+      SumColumns( self, result->data_, false ) ;
+      for( int c=0 ; c<self->n_ ; c++ ) result->data_[c] /= self->m_ ;
     }
 
     if( dimension == 1 ) {       // sum rows to mx1 vector
-      for( int r=0 ; r<self->m_ ; r++ ) {
-        result->data_[r] = 0 ;
-        int ix = r ;
-        for( int c=0 ; c<self->n_ ; c++ ) {
-          result->data_[r] += self->data_[ix] ;
-          ix+=m ;
-        }
-        result->data_[r] /= self->n_ ;
-      }
+      SumRows( self, result->data_, false ) ;
+      for( int r=0 ; r<self->m_ ; r++ ) result->data_[r] /= self->n_ ;
+    }
+  }
+}
+
+
+/**
+	Summary statistics of each column, in one pass
+
+	Works out the count, mean, variance, min & max of each column - and the 
+	rows where the min & max are - reading each element once. The variance
+	is the sample variance ( divided by count-1 ), 0 for a single row. A 
+	vector is described as a whole and the results are numbers.
+
+	\code{.js}
+
+	var d = X.describe() ;
+	var Z = lalg.map( '( a - b ) / sqrt( c )', X, d.mean, d.var ) ;	// standardize
+	var s = lalg.rand( 1000, 1 ).describe() ;	// { count: 1000, mean: 0.49.., min: 0.0003.., argmin: 417 ... }
+
+	\endcode
+
+	@return an object { count, mean, var, min, max, argmin, argmax }, each a 1xN row vector except count
+*/
+void WrappedArray::Describe( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  Local<Object> rc = Object::New(isolate);
+  if( self->isVector ) {
+    const int count = self->m_ * self->n_ ;
+    std::vector<float> copy ;
+    const float *a = self->data_ ;
+    if( self->VectorStride() != 1 ) {	// a row of a matrix
+      copy.resize( count ) ;
+      self->CopyTo( copy.data() ) ;
+      a = copy.data() ;
     }
+    ColumnStats stats = DescribeColumn( a, count ) ;
+    rc->Set(String::NewFromUtf8(isolate, "count"), Number::New( isolate, count ) );
+    rc->Set(String::NewFromUtf8(isolate, "mean"), Number::New( isolate, stats.mean ) );
+    rc->Set(String::NewFromUtf8(isolate, "var"), Number::New( isolate, count > 1 ? stats.m2 / ( count-1 ) : 0. ) );
+    rc->Set(String::NewFromUtf8(isolate, "min"), Number::New( isolate, stats.min ) );
+    rc->Set(String::NewFromUtf8(isolate, "max"), Number::New( isolate, stats.max ) );
+    rc->Set(String::NewFromUtf8(isolate, "argmin"), Number::New( isolate, stats.argmin ) );
+    rc->Set(String::NewFromUtf8(isolate, "argmax"), Number::New( isolate, stats.argmax ) );
+    args.GetReturnValue().Set( rc );
+    return ;
+  }
+
+  const char *names[] = { "mean", "var", "min", "max", "argmin", "argmax" } ;
+  float *out[6] ;
+  for( int i=0 ; i<6 ; i++ ) {
+    const unsigned argc = 2;
+    Local<Value> argv[argc] = { Integer::New( isolate, 1 ), Integer::New( isolate, self->n_ ) };
+    Local<Function> cons = Local<Function>::New(isolate, constructor);
+    Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+    out[i] = ObjectWrap::Unwrap<WrappedArray>( instance )->data_ ;
+    rc->Set(String::NewFromUtf8(isolate, names[i]), instance );
   }
+  rc->Set(String::NewFromUtf8(isolate, "count"), Number::New( isolate, self->m_ ) );
+
+  const int m = self->m_ ;
+  ThreadPool::Instance().Ranges( self->n_, m, [&]( size_t, size_t begin, size_t end ) {
+    for( size_t c=begin ; c<end ; c++ ) {
+      ColumnStats stats = DescribeColumn( self->data_ + c*self->ld_, m ) ;
+      out[0][c] = stats.mean ;
+      out[1][c] = m > 1 ? stats.m2 / ( m-1 ) : 0. ;
+      out[2][c] = stats.min ;
+      out[3][c] = stats.max ;
+      out[4][c] = stats.argmin ;
+      out[5][c] = stats.argmax ;
+    }
+  } ) ;
+  args.GetReturnValue().Set( rc );
 }
 
 
@@ -1258,6 +5313,7 @@ void WrappedArray::Mean( const v8::FunctionCallbackInfo<v8::Value>& args )
 	\endcode
 
 	@param [in,default=0] the rows to copy from the matrix, may be a number or an array of numbers
+	@see ViewRows to get a block of rows without copying
 	@return a new matrix containing the copies of the requested rows.
 */
 void WrappedArray::GetRows( const v8::FunctionCallbackInfo<v8::Value>& args )
@@ -1265,7 +5321,8 @@ void WrappedArray::GetRows( const v8::FunctionCallbackInfo<v8::Value>& args )
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   int numRows = 1 ;  
   int *m = new int[0] ;
@@ -1302,11 +5359,11 @@ void WrappedArray::GetRows( const v8::FunctionCallbackInfo<v8::Value>& args )
       int ixb = r+offsetResult ; 
       result->data_[ixb] = self->data_[ixa] ;
     }
-    offsetSelf += self->m_ ;
+    offsetSelf += self->ld_ ;
     offsetResult += result->m_ ;
   }
 
-  delete m ;
+  delete [] m ;
 }
 
 
@@ -1331,10 +5388,15 @@ void WrappedArray::RemoveRow( const v8::FunctionCallbackInfo<v8::Value>& args )
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   int m = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
 
+  // A view gets its own data first, we mustn't reshape someone else's data
+  self->Unshare() ;
+  self->MakeWritable() ;
+
   EscapableHandleScope scope(isolate) ; ;
 
   // make a row vector: 1xn 
@@ -1355,6 +5417,7 @@ void WrappedArray::RemoveRow( const v8::FunctionCallbackInfo<v8::Value>& args )
     ix += self->m_ - 1 ;
   }
   self->m_-- ;
+  self->ld_ = self->m_ ;
 }
 
 
@@ -1373,6 +5436,7 @@ void WrappedArray::RemoveRow( const v8::FunctionCallbackInfo<v8::Value>& args )
 	\endcode
 
 	@param [in,default=0] the column indices to copy from the array , may be a number or an array of numbers
+	@see ViewColumns to get a block of columns without copying
 	@return a new matrix containing the copies of the requested columns.
 */
 void WrappedArray::GetColumns( const v8::FunctionCallbackInfo<v8::Value>& args )
@@ -1380,7 +5444,8 @@ void WrappedArray::GetColumns( const v8::FunctionCallbackInfo<v8::Value>& args )
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   int numCols = 1 ;  
   int *n = new int[0] ;
@@ -1411,13 +5476,146 @@ void WrappedArray::GetColumns( const v8::FunctionCallbackInfo<v8::Value>& args )
 
 
   for( int c=0 ; c<numCols ; c++ ) {
-    int ixa = n[c] * self->m_ ;
+    int ixa = n[c] * self->ld_ ;
     int ixb = c * self->m_ ;
     for( int r=0 ; r<self->m_ ; r++ ) {
       result->data_[ixb+r] = self->data_[ixa+r] ;
     }
   }
-  delete n ;
+  delete [] n ;
+}
+
+/**
+	Make a view on a block of a matrix
+
+	The view shares the data of the target, no values are copied. Changes made
+	through the view are seen in the target and vice versa. A block of columns is a 
+	single contiguous piece of memory, a block of rows is read column by column 
+	with a stride of the target's row count - which BLAS handles directly.
+	The view keeps the target's data alive, even if the target is collected.
+
+	Anything that changes the shape of a view ( reshape, removeRow, removeColumn ... )
+	gives the view its own copy of the data first.
+
+	\code{.js}
+
+	var V = MATRIX.view( 10, 0, 32, 5 ) ;  // rows 10..41 of the first 5 columns
+	
+	\endcode
+
+	@param [in] the first row of the block
+	@param [in] the first column of the block
+	@param [in,default=remaining rows] the number of rows in the block
+	@param [in,default=remaining cols] the number of columns in the block
+	@return a new matrix sharing the target's data.
+*/
+void WrappedArray::View( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  int r0 = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
+  int c0 = args[1]->IsUndefined() ? 0 : args[1]->NumberValue() ;
+  int rows = args[2]->IsUndefined() ? self->m_ - r0 : args[2]->NumberValue() ;
+  int cols = args[3]->IsUndefined() ? self->n_ - c0 : args[3]->NumberValue() ;
+
+  MakeView( args, self, r0, c0, rows, cols ) ;
+}
+
+/**
+	Make a view on a contiguous block of columns. 
+
+	\code{.js}
+
+	var batch = X.viewColumns( 256, 64 ) ;  // columns 256..319
+	
+	\endcode
+
+	@see View
+	@param [in,default=0] the first column of the block
+	@param [in,default=remaining cols] the number of columns in the block
+	@return a new matrix sharing the target's data.
+*/
+void WrappedArray::ViewColumns( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  int c0 = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
+  int cols = args[1]->IsUndefined() ? self->n_ - c0 : args[1]->NumberValue() ;
+
+  MakeView( args, self, 0, c0, self->m_, cols ) ;
+}
+
+/**
+	Make a view on a block of rows. 
+
+	\code{.js}
+
+	var batch = X.viewRows( 256, 64 ) ;  // rows 256..319
+	
+	\endcode
+
+	@see View
+	@param [in,default=0] the first row of the block
+	@param [in,default=remaining rows] the number of rows in the block
+	@return a new matrix sharing the target's data.
+*/
+void WrappedArray::ViewRows( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  int r0 = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
+  int rows = args[1]->IsUndefined() ? self->m_ - r0 : args[1]->NumberValue() ;
+
+  MakeView( args, self, r0, 0, rows, self->n_ ) ;
+}
+
+/*
+	Build the view for View, ViewRows & ViewColumns. The new matrix drops 
+	its own (empty) storage and takes a reference on the target's.
+*/
+void WrappedArray::MakeView( const v8::FunctionCallbackInfo<v8::Value>& args, WrappedArray *self, int r0, int c0, int rows, int cols )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  if( r0<0 || c0<0 || rows<0 || cols<0 || (r0+rows)>self->m_ || (c0+cols)>self->n_ ) {
+    char *msg = new char[ 1000 ] ;
+    snprintf( msg, 1000, "View |%d x %d| at (%d,%d) is outside |%d x %d|", rows, cols, r0, c0, self->m_, self->n_ ) ;
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    delete [] msg ;
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+
+  // A dup() can't share storage with views, so the target gets its own first
+  self->CopyOnWrite() ;
+
+  EscapableHandleScope scope(isolate) ; ;
+
+  const unsigned argc = 2;
+  Local<Value> argv[argc] = { Integer::New( isolate,0 ), Integer::New( isolate,0 ) };
+  Local<Function> cons = Local<Function>::New(isolate, constructor);
+  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+
+  scope.Escape(instance);
+  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+  args.GetReturnValue().Set( instance );
+
+  result->ReleaseData() ;
+  result->storage_ = self->storage_ ;
+  result->storage_->Ref() ;
+  result->storage_->views++ ;
+  if( result->storage_->scope != NULL ) result->storage_->scope->Track( result ) ;
+  result->data_ = self->data_ + r0 + c0*self->ld_ ;
+  result->dataSize_ = 0 ;	// nothing of our own to grow into
+  result->m_ = rows ;
+  result->n_ = cols ;
+  result->ld_ = self->ld_ ;
+  result->isView_ = true ;
+  result->isVector = ( rows==1 || cols==1 ) ;
 }
 
 /**
@@ -1440,10 +5638,15 @@ void WrappedArray::RemoveColumn( const v8::FunctionCallbackInfo<v8::Value>& args
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   int n = args[0]->IsUndefined() ? 0 : args[0]->NumberValue() ;
 
+  // A view gets its own data first, we mustn't reshape someone else's data
+  self->Unshare() ;
+  self->MakeWritable() ;
+
   EscapableHandleScope scope(isolate) ; ;
 
   // make a row vector: mx1
@@ -1479,6 +5682,7 @@ void WrappedArray::RemoveColumn( const v8::FunctionCallbackInfo<v8::Value>& args
 	
 	\endcode
 
+	@see AppendColumnsi to grow the target in place
 	@param [in] the column(s) to append to the matrix
 	@return a new matrix containing the additional column.
 */
@@ -1487,7 +5691,8 @@ void WrappedArray::AppendColumns( const v8::FunctionCallbackInfo<v8::Value>& arg
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
   WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>(args[0]->ToObject());    
 
   EscapableHandleScope scope(isolate) ; ;
@@ -1497,8 +5702,9 @@ void WrappedArray::AppendColumns( const v8::FunctionCallbackInfo<v8::Value>& arg
       char *msg = new char[ 1000 ] ;
       snprintf( msg, 1000, "Incompatible args: |%d x %d| append |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
       isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-      delete msg ;
+      delete [] msg ;
       args.GetReturnValue().Set( Undefined(isolate) );
+      return ;
   }
 
   // make a new matrix M x N+K  ( K = other cols )
@@ -1512,12 +5718,230 @@ void WrappedArray::AppendColumns( const v8::FunctionCallbackInfo<v8::Value>& arg
   args.GetReturnValue().Set( instance );
 
   // copy the original data 
-  memcpy( result->data_, self->data_, self->n_ * self->m_*sizeof(float) ) ;
+  self->CopyTo( result->data_ ) ;
   // then append the vectors !
-  memcpy( result->data_+(self->n_ * self->m_), other->data_, other->n_*other->m_*sizeof(float) ) ;
+  other->CopyTo( result->data_+(self->n_ * self->m_) ) ;
+}
+
+
+
+
+/**
+	Append columns to a matrix in place
+
+	Just like appendColumns, but the target itself grows to N+K columns. Room 
+	to grow is kept after the data, so appending in a loop doesn't copy the 
+	whole matrix every time.
+
+	\code{.js}
+
+	var X = lalg.zeros( 10, 0 ) ;
+	for( var i=0 ; i<1000 ; i++ ) {
+	  X.appendColumnsi( lalg.rand( 10, 1 ) ) ;
+	}
+	
+	\endcode
+
+	@param [in] the column(s) to append to the matrix
+	@return the target
+*/
+void WrappedArray::AppendColumnsi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>(args[0]->ToObject());    
+
+  if( other->m_!= self->m_ ) {
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "Incompatible args: |%d x %d| append |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      args.GetReturnValue().Set( Undefined(isolate) );
+      return ;
+  }
+  args.GetReturnValue().Set( args.Holder() );
+
+  // appending to ourself - take a copy first, we're about to move
+  WrappedArray *copy = NULL ;
+  if( other->storage_ == self->storage_ ) {
+    copy = new WrappedArray( other->m_, other->n_ ) ;
+    other->CopyTo( copy->data_ ) ;
+    other = copy ;
+  }
+
+  self->Grow( self->m_, self->n_ + other->n_ ) ;
+  for( int c=0 ; c<other->n_ ; c++ ) {
+    memcpy( self->data_ + (size_t)(self->n_+c)*self->ld_, other->data_ + (size_t)c*other->ld_, self->m_*sizeof(float) ) ;
+  }
+  self->n_ += other->n_ ;
+  self->isVector = self->m_==1 || self->n_==1 ;
+  delete copy ;
+}
+
+
+/**
+	Append rows to a matrix
+
+	Append row vectors. The result has M+K rows, the other matrix should have the same 
+	number of columns as the target. K is the height of the added matrix.
+
+	\code{.js}
+
+        var MATRIX = lalg.rand(10,6) ;
+        var V = lalg.rand(3,6) ;
+	var R = MATRIX.appendRows(V) ;	// 13 x 6
+	
+	\endcode
+
+	@param [in] the row(s) to append to the matrix
+	@return a new matrix containing the additional rows.
+*/
+void WrappedArray::AppendRows( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>(args[0]->ToObject());    
+
+  EscapableHandleScope scope(isolate) ; ;
+
+  if( other->n_!= self->n_ ) {
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "Incompatible args: |%d x %d| append rows |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      args.GetReturnValue().Set( Undefined(isolate) );
+      return ;
+  }
+
+  // make a new matrix M+K x N  ( K = other rows )
+  const unsigned argc = 2;
+  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ + other->m_ ), Integer::New( isolate,self->n_ ) };
+  Local<Function> cons = Local<Function>::New(isolate, constructor) ;
+  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+
+  scope.Escape(instance);
+  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+  args.GetReturnValue().Set( instance );
+
+  // each column of the result is a column of the target then a column of other
+  for( int c=0 ; c<self->n_ ; c++ ) {
+    float *data = result->data_ + (size_t)c*result->m_ ;
+    memcpy( data, self->data_ + (size_t)c*self->ld_, self->m_*sizeof(float) ) ;
+    memcpy( data + self->m_, other->data_ + (size_t)c*other->ld_, other->m_*sizeof(float) ) ;
+  }
+}
+
+
+/**
+	Append rows to a matrix in place
+
+	Just like appendRows, but the target itself grows to M+K rows. Since the data
+	is stored in columns, spare rows are kept at the end of each column ( the 
+	matrix's leading dimension is bigger than M ), so appending rows in a loop 
+	doesn't move the whole matrix every time. Call shrinkToFit() when done 
+	to pack the data.
+
+	\code{.js}
+
+	var X = lalg.zeros( 0, 5 ) ;
+	stream.on( 'data', function( row ) { X.appendRowsi( new lalg.Array( 1, 5, row ) ) ; } ) ;
+	
+	\endcode
+
+	@param [in] the row(s) to append to the matrix
+	@return the target
+*/
+void WrappedArray::AppendRowsi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>(args[0]->ToObject());    
+
+  if( other->n_!= self->n_ ) {
+      char *msg = new char[ 1000 ] ;
+      snprintf( msg, 1000, "Incompatible args: |%d x %d| append rows |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+      delete [] msg ;
+      args.GetReturnValue().Set( Undefined(isolate) );
+      return ;
+  }
+  args.GetReturnValue().Set( args.Holder() );
+
+  WrappedArray *copy = NULL ;
+  if( other->storage_ == self->storage_ ) {
+    copy = new WrappedArray( other->m_, other->n_ ) ;
+    other->CopyTo( copy->data_ ) ;
+    other = copy ;
+  }
+
+  self->Grow( self->m_ + other->m_, self->n_ ) ;
+  for( int c=0 ; c<self->n_ ; c++ ) {
+    memcpy( self->data_ + (size_t)c*self->ld_ + self->m_, other->data_ + (size_t)c*other->ld_, other->m_*sizeof(float) ) ;
+  }
+  self->m_ += other->m_ ;
+  self->isVector = self->m_==1 || self->n_==1 ;
+  delete copy ;
+}
+
+
+/**
+	Reserve room to grow
+
+	Make sure the matrix can grow to (at least) rows x cols, with appendRowsi and 
+	appendColumnsi, without moving its data. The shape doesn't change.
+
+	@param [in,default=M] the number of rows to make room for
+	@param [in,default=N] the number of columns to make room for
+	@return the target
+*/
+void WrappedArray::Reserve( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  int rows = args[0]->IsUndefined() ? self->m_ : args[0]->NumberValue() ;
+  int cols = args[1]->IsUndefined() ? self->n_ : args[1]->NumberValue() ;
+  rows = std::max( rows, self->m_ ) ;
+  cols = std::max( cols, self->n_ ) ;
+
+  args.GetReturnValue().Set( args.Holder() );
+
+  if( self->isView_ ) self->Unshare() ;
+  self->MakeWritable() ;
+  if( rows > self->ld_ || (size_t)std::max( rows, self->ld_ )*cols > (size_t)self->dataSize_ ) {
+    self->Regrow( std::max( rows, self->ld_ ), cols ) ;
+  }
 }
 
 
+/**
+	Release spare room
+
+	Move the data to a buffer just big enough for M x N, packing any spare rows
+	left by appendRowsi or reserve. Does nothing to a view.
+
+	@return the target
+*/
+void WrappedArray::ShrinkToFit( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  args.GetReturnValue().Set( args.Holder() );
+
+  if( self->isView_ || !self->storage_->backing.IsEmpty() || self->storage_->mapBase != NULL ) return ;
+  // the pool rounds sizes up by as much as 1/4 - a new buffer would be no smaller
+  int sz = self->m_ * self->n_ ;
+  if( self->IsContiguous() && self->dataSize_ <= sz + sz/4 + 16 ) return ;
+  self->Regrow( self->m_, self->n_ ) ;
+}
 
 
 /**
@@ -1559,7 +5983,8 @@ void WrappedArray::RotateColumns( const v8::FunctionCallbackInfo<v8::Value>& arg
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
   int rotationCount = args[0]->IsUndefined() ? 1 : args[0]->NumberValue() ;
 
   EscapableHandleScope scope(isolate) ; ;
@@ -1579,10 +6004,18 @@ void WrappedArray::RotateColumns( const v8::FunctionCallbackInfo<v8::Value>& arg
   }
   rotationCount %= self->n_ ;
 
-  // copy part 1 of the data
-  memcpy( result->data_, self->data_+(self->m_*rotationCount), (self->n_-rotationCount) * self->m_*sizeof(float) ) ;
-  // then append the vectors !
-  memcpy( result->data_+(self->m_*(self->n_-rotationCount)), self->data_, rotationCount * self->m_*sizeof(float) ) ;
+  if( self->IsContiguous() ) {
+    // copy part 1 of the data
+    memcpy( result->data_, self->data_+(self->m_*rotationCount), (self->n_-rotationCount) * self->m_*sizeof(float) ) ;
+    // then append the vectors !
+    memcpy( result->data_+(self->m_*(self->n_-rotationCount)), self->data_, rotationCount * self->m_*sizeof(float) ) ;
+  } else {
+    // a view - copy column by column
+    for( int c=0 ; c<self->n_ ; c++ ) {
+      int from = ( c + rotationCount ) % self->n_ ;
+      memcpy( result->data_+(c*self->m_), self->data_+(from*self->ld_), self->m_*sizeof(float) ) ;
+    }
+  }
 }
 
 
@@ -1598,6 +6031,9 @@ void WrappedArray::RotateColumns( const v8::FunctionCallbackInfo<v8::Value>& arg
 	elements are initialized to zero. This operation is done in place - the target is
 	changed. The default is to produce a (M*N)x1 vector is no paramters are given.
 
+	A matrix built on a javascript buffer ( @see FromBuffer ) that grows beyond
+	the buffer is moved to its own memory, and stops sharing data with the buffer.
+
 	@param [in,default=m*n] the number of rows to have in the new shape
 	@param [in,default=1] the number of columns to have in the new shape
 */
@@ -1606,7 +6042,8 @@ void WrappedArray::Reshape( const v8::FunctionCallbackInfo<v8::Value>& args )
 //  Isolate* isolate = args.GetIsolate();
 //  Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   int m = args[0]->IsUndefined() ? (self->m_*self->n_) : args[0]->NumberValue() ;
   int n = args[1]->IsUndefined() ? 1 : args[1]->NumberValue() ;
@@ -1615,16 +6052,20 @@ void WrappedArray::Reshape( const v8::FunctionCallbackInfo<v8::Value>& args )
 
   args.GetReturnValue().Set( args.Holder() );
 
+// A view gets its own data first, we mustn't reshape someone else's data
+  self->Unshare() ;
+// The data isn't written (copies can share), but it does look different
+  self->Touch() ;
+
 // Only if we need to ... allocate new memory
   if( m*n > self->dataSize_ ) {
-    float *tmp = self->data_ ;
-    self->dataSize_ = m*n;
-    self->data_ = new float[self->dataSize_];
-    memcpy( self->data_, tmp, self->m_*self->n_*sizeof(float) ) ; 
-    delete tmp  ;
+    Storage *storage = self->NewStorage( m*n ) ;
+    memcpy( storage->data, self->data_, self->m_*self->n_*sizeof(float) ) ; 
+    self->UseStorage( storage ) ;
   }
   self->m_ = m ;
   self->n_ = n ;
+  self->ld_ = m ;
 }
 
 /**
@@ -1642,61 +6083,25 @@ void WrappedArray::Reshape( const v8::FunctionCallbackInfo<v8::Value>& args )
 	- a matrix 
 	- a vector 
 	- a number
-	@return a new matrix
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return a new matrix, or the output matrix
 
 */
 void WrappedArray::Add( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
-  EscapableHandleScope scope(isolate) ;
-
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-  scope.Escape(instance);
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
+  BinaryHelper( args, AddOp(), "+", false ) ;
+}
 
-  float *data = result->data_ ;
-  float *a = self->data_ ;
-  int sz = self->m_ * self->n_ ;
+/**
+	In place version of add - the result is written over the target.
 
-  if( args[0]->IsNumber() ) { 
-	float x = args[0]->NumberValue() ;
-	for( int i=0 ; i<sz ; i++ ) {
-		*data++ = *a++ + x ;
-	}		
-  } else {
-    WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() );
-    float *b = other->data_ ;
-    if( self->n_ == other->n_  &&  self->m_ == other->m_ ) {
-      for( int i=0 ; i<sz ; i++ ) {
-	*data++ = *a++ + *b++ ;
-      }
-    } else if( self->n_ == other->n_  &&  other->m_ == 1 ) { // add a row vector to each row
-      int j = 0 ;
-      int n = self->m_ ;
-      for( int i=0 ; i<sz ; i++ ) {
-        *data++ = *a++ + b[j] ;
-        if( --n == 0 ) { j++ ; n = self->m_ ; }
-      }
-    } else if( self->m_ == other->m_  &&  other->n_ == 1 ) { // add a col vector to each col
-      int j = 0 ;
-      for( int i=0 ; i<sz ; i++ ) {
-        data[i] = a[i] + b[j++] ;
-        if( j>=self->m_ ) j=0 ;
-      }
-    } else { // incompatible types ...
-      char *msg = new char[ 1000 ] ;
-      snprintf( msg, 1000, "Incompatible args: |%d x %d| + |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
-      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-      delete msg ;
-      args.GetReturnValue().Set( Undefined(isolate) );
-    }
-  }
+	@see Add
+	@param [in] a matrix, vector or number
+	@return the target
+*/
+void WrappedArray::Addi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  BinaryHelper( args, AddOp(), "+", true ) ;
 }
 
 
@@ -1716,63 +6121,25 @@ void WrappedArray::Add( const v8::FunctionCallbackInfo<v8::Value>& args )
 	- a matrix 
 	- a vector 
 	- a number
-	@return a new matrix
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return a new matrix, or the output matrix
 
 */
 void WrappedArray::Sub( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
-  EscapableHandleScope scope(isolate) ;
-
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-  scope.Escape(instance);
-  args.GetReturnValue().Set( instance );
-
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+  BinaryHelper( args, SubOp(), "-", false ) ;
+}
 
-  float *data = result->data_ ;
-  float *a = self->data_ ;
-  int sz = self->m_ * self->n_ ;
+/**
+	In place version of sub - the result is written over the target.
 
-  if( args[0]->IsNumber() ) { 
-	float x = args[0]->NumberValue() ;
-	for( int i=0 ; i<sz ; i++ ) {
-		*data++ = *a++ - x ;
-	}		
-  } else {
-    WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() );
-    float *b = other->data_ ;
-    if( self->n_ == other->n_  &&  self->m_ == other->m_ ) {
-      for( int i=0 ; i<sz ; i++ ) {
-	*data++ = *a++ - *b++ ;
-      }
-    } else if( self->n_ == other->n_  &&  other->m_ == 1 ) { // add a row vector to each row
-      int j = 0 ;
-      int n = self->m_ ;
-      for( int i=0 ; i<sz ; i++ ) {
-        *data++ = *a++ - b[j] ;
-        if( --n == 0 ) { j++ ; n = self->m_ ; }
-      }
-    } else if( self->m_ == other->m_  &&  other->n_ == 1 ) { // add a col vector to each col
-      int j = 0 ;
-      for( int i=0 ; i<sz ; i++ ) {
-        data[i] = a[i] - b[j++] ;
-        if( j>=self->m_ ) j=0 ;
-      }
-    } else { // incompatible types ...
-      char *msg = new char[ 1000 ] ;
-      snprintf( msg, 1000, "Incompatible args: |%d x %d| + |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
-      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-      delete msg ;
-      args.GetReturnValue().Set( Undefined(isolate) );
-    }
-  }
+	@see Sub
+	@param [in] a matrix, vector or number
+	@return the target
+*/
+void WrappedArray::Subi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  BinaryHelper( args, SubOp(), "-", true ) ;
 }
 
 
@@ -1796,61 +6163,25 @@ void WrappedArray::Sub( const v8::FunctionCallbackInfo<v8::Value>& args )
 	- a matrix 
 	- a vector 
 	- a number
-	@return a new matrix
+	@param [in,optional] an MxN matrix to write the result into, instead of a new matrix
+	@return a new matrix, or the output matrix
 
 */
 void WrappedArray::Hadamard( const v8::FunctionCallbackInfo<v8::Value>& args )
 {
-  Isolate* isolate = args.GetIsolate();
-  Local<Context> context = isolate->GetCurrentContext() ;
-  EscapableHandleScope scope(isolate) ;
-
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
-  const unsigned argc = 2;
-  Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
-  Local<Function> cons = Local<Function>::New(isolate, constructor);
-  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
-  scope.Escape(instance);
-  WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
-  args.GetReturnValue().Set( instance );
+  BinaryHelper( args, MulOp(), ".*", false ) ;
+}
 
-  float *data = result->data_ ;
-  float *a = self->data_ ;
-  int sz = self->m_ * self->n_ ;
+/**
+	In place version of hadamard - the result is written over the target.
 
-  if( args[0]->IsNumber() ) { 
-	float x = args[0]->NumberValue() ;
-	for( int i=0 ; i<sz ; i++ ) {
-		*data++ = *a++ * x ;
-	}		
-  } else {
-    WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() );
-    float *b = other->data_ ;
-    if( self->n_ == other->n_  &&  self->m_ == other->m_ ) {
-      for( int i=0 ; i<sz ; i++ ) {
-	*data++ = *a++ * *b++ ;
-      }
-    } else if( self->n_ == other->n_  &&  other->m_ == 1 ) { // add a row vector to each row
-      int j = 0 ;
-      int n = self->m_ ;
-      for( int i=0 ; i<sz ; i++ ) {
-        *data++ = *a++ * b[j] ;
-        if( --n == 0 ) { j++ ; n = self->m_ ; }
-      }
-    } else if( self->m_ == other->m_  &&  other->n_ == 1 ) { // add a col vector to each col
-      int j = 0 ;
-      for( int i=0 ; i<sz ; i++ ) {
-        data[i] = a[i] * b[j++] ;
-        if( j>=self->m_ ) j=0 ;
-      }
-    } else { // incompatible types ...
-      char *msg = new char[ 1000 ] ;
-      snprintf( msg, 1000, "Incompatible args: |%d x %d| + |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
-      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-      delete msg ;
-      args.GetReturnValue().Set( Undefined(isolate) );
-    }
-  }
+	@see Hadamard
+	@param [in] a matrix, vector or number
+	@return the target
+*/
+void WrappedArray::Hadamardi( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  BinaryHelper( args, MulOp(), ".*", true ) ;
 }
 
 
@@ -1898,7 +6229,8 @@ void WrappedArray::InvHelper( const v8::FunctionCallbackInfo<v8::Value>& args, b
   EscapableHandleScope scope(isolate) ;
   
 // Get the matrix to invert
-  WrappedArray *self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   const unsigned argc = 2;
   Local<Value> argv[argc] = { Integer::New( isolate,self->m_ ), Integer::New( isolate,self->n_ ) };
@@ -1923,14 +6255,10 @@ void WrappedArray::InvpWorkAsync( uv_work_t *req )
   } else {
     WrappedArray* result = work->result ;
 
-    int sz = result->m_ * result->n_ ;
-    for( int i=0 ; i<sz ; i++ ) {
-      result->data_[i] = self->data_[i] ;
-    }
+    self->CopyTo( result->data_ ) ;
 
     int *ipiv = new int[ std::min( self->m_, self->n_) ] ;
-    int rc = LAPACKE_sgetrf(
-        CblasColMajor,
+    int rc = Blas<float>::getrf(
         result->m_,
         result->n_,
         result->data_,
@@ -1944,8 +6272,7 @@ void WrappedArray::InvpWorkAsync( uv_work_t *req )
         snprintf( work->err, 1000, "Internal failure - sgetrf() failed with %d", rc ) ;
       }
     } else {
-      rc = LAPACKE_sgetri(
-          CblasColMajor,
+      rc = Blas<float>::getri(
           result->n_,
           result->data_,
           result->n_,
@@ -1955,7 +6282,7 @@ void WrappedArray::InvpWorkAsync( uv_work_t *req )
         snprintf( work->err, 1000, "Internal failure - sgetri() failed with %d", rc ) ;
       }
     }
-    delete ipiv ;
+    delete [] ipiv ;
   }
 }
 
@@ -1971,191 +6298,475 @@ void WrappedArray::InvpWorkAsync( uv_work_t *req )
 	pseudo inverse is an identity matrix. A newly created inverse is 
 	returned, the original remains intact.
 
-        This seems to have a problem with vectors - don't invert a vector
-        until we know what it may mean.
+	It's worked out from the economy SVD, A = U S V', as V inv(S) U'. 
+	Singular values at or below the tolerance are taken as 0, so the 
+	columns of a matrix that's not of full rank ( e.g. one hot features
+	that always add up to 1 ) don't blow up. The default tolerance is 
+	max(M,N) x float epsilon x the largest singular value.
+
+	\code{.js}
+
+	var W = X.pinv().mul( y ) ;
+	var W2 = X.pinv( 1e-3 ).mul( y ) ;	// ignore singular values below 0.001
+
+	\endcode
 
-	@return the new matrix pseudo inverse of the target
+	@param [in,optional] tolerance, the smallest singular value to keep
+	@return the new NxM pseudo inverse of the target
 */
 void WrappedArray::Pinv( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::PinvHelper( args, false, 1 ) ;
+}
+
+/**
+	Get the pseudo inverse of a matrix in non-blocking mode
+
+	The same as pinv, in a background thread. There are two ways to use 
+	this, pass in an optional callback or accept a returned promise.
+
+	\code{.js}
+
+	X.pinvp().then( function( PI ) { var W = PI.mul( y ) ; } ) ;
+
+	\endcode
+
+	@see Pinv
+	@param [in,optional] tolerance, the smallest singular value to keep
+	@param [in,optional] a callback of prototype function(err,PI){ }
+	@return a promise which will resolve to the pseudo inverse ( if there's no callback )
+*/
+void WrappedArray::Pinvp( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::PinvHelper( args, true, 0 ) ;
+}
+
+/*
+	Set up the work for PinvWorkAsync. The tolerance goes in xtraFloat, it's
+	negative if not given. The callback follows the tolerance if there is one.
+*/
+void WrappedArray::PinvHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex )
+{
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  float tol = -1.f ;
+  if( args[0]->IsNumber() ) {
+    tol = std::max( 0., args[0]->NumberValue() ) ;
+    if( block ) callbackIndex++ ;
+  }
+
+  Local<Object> instance ;
+  if( MakeResult( args, -1, self->n_, self->m_, &instance ) == NULL ) return ;
+  WrappedArray::PrepareWork( args, block, callbackIndex, WrappedArray::PinvWorkAsync, instance, Local<Object>(), 0, tol ) ;
+}
+
+/*
+	The body of pinv, maybe in a background thread. sgesdd destroys its 
+	input so it works on a copy. The kept rows of V' are scaled by 1/s,
+	then the result is ( inv(S) V' )' x U' using just the kept singular 
+	values - a rank r matrix costs r/min(M,N) of the full multiply.
+*/
+void WrappedArray::PinvWorkAsync( uv_work_t *req )
+{
+  Work *work = static_cast<Work *>(req->data);
+
+  WrappedArray* self = work->self ;
+  WrappedArray* result = work->result ;
+  const int m = self->m_ ;
+  const int n = self->n_ ;
+  const int k = std::min( m, n ) ;
+  const int ldu = std::max( 1, m ) ;
+  const int ldvt = std::max( 1, k ) ;
+
+  if( k == 0 ) return ;
+
+  std::vector<float> a( (size_t)m * n ) ;
+  std::vector<float> s( k ) ;
+  std::vector<float> u( (size_t)ldu * k ) ;
+  std::vector<float> vt( (size_t)ldvt * n ) ;
+  self->CopyTo( a.data() ) ;
+
+  int rc = LAPACKE_sgesdd( CblasColMajor, 'S', m, n, a.data(), ldu, s.data(), u.data(), ldu, vt.data(), ldvt ) ;
+  if( rc != 0 ) {
+    work->err = new char[ 1000 ] ;
+    if( rc > 0 ) {
+      snprintf( work->err, 1000, "The SVD did not converge" ) ;
+    } else {
+      snprintf( work->err, 1000, "Internal failure - sgesdd() failed with %d", rc ) ;
+    }
+    return ;
+  }
+
+  const float tol = work->xtraFloat >= 0 ? work->xtraFloat : 
+		std::max( m, n ) * std::numeric_limits<float>::epsilon() * s[0] ;
+  int r = 0 ;		// singular values are in descending order
+  while( r < k && s[r] > tol ) r++ ;
+
+  for( int j=0 ; j<n ; j++ ) {
+    float *col = vt.data() + (size_t)j*ldvt ;
+    for( int i=0 ; i<r ; i++ ) col[i] /= s[i] ;
+  }
+
+  if( r == 0 ) {	// everything is below the tolerance
+    for( int j=0 ; j<m ; j++ ) memset( result->data_ + (size_t)j*result->ld_, 0, n*sizeof(float) ) ;
+    return ;
+  }
+  Blas<float>::gemm(
+      CblasTrans,	// ( inv(S) V' )' = V inv(S), NxR
+      CblasTrans,	// U', RxM
+      n,
+      m,
+      r,
+      1.f,
+      vt.data(),
+      ldvt,
+      u.data(),
+      ldu,
+      0.f,
+      result->data_,
+      std::max( 1, result->ld_ ) ) ;
+}
+
+
+
+
+/**
+	Solve a set of linear equations
+
+	Finds X where A x X = B, for the MxN target A and an MxK B - each column
+	of B is a right hand side. The matrix is factored and solved, which is
+	quicker and more accurate than inv( A ) x B. The factorization depends
+	on the shape of A:
+
+	- symmetric positive definite ( e.g. from gram or cov ) - Cholesky, sposv
+	- any other square matrix - LU, sgesv
+	- not square - the least squares solution, QR with sgels. If A isn't of
+	  full rank it's done again with the SVD, sgelsd
+
+	A symmetric matrix is spotted by its symmetric flag or by checking the
+	elements. If it's not positive definite after all, LU is used. The 
+	options can say what A is, { spd:true } uses Cholesky without the
+	check ( or fails ), { spd:false } never tries Cholesky. An rcond goes
+	straight to sgelsd, which gives the minimum norm solution for any
+	shape of A. Singular values below rcond x the largest are treated as 0.
+
+	\code{.js}
+
+	var theta = X.solveLinear( y ) ;	// least squares, not inv( X'X ) X'y
+	var W = X.cov().solveLinear( B ) ;	// Cholesky
+	var Z = A.solveLinear( B, { rcond:1e-6 } ) ;
+
+	\endcode
+
+	@see solveLinearp for a version which returns a promise
+	@param [in] B, an MxK matrix of right hand sides
+	@param [in,optional] options { spd:true|false, rcond:the smallest relative singular value to keep }
+	@return the NxK solution X
+*/
+void WrappedArray::SolveLinear( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+/* The actual work is in SolveLinearWorkAsync */
+  WrappedArray::SolveLinearHelper( args, false, 1 ) ;
+}
+
+/**
+	Solve a set of linear equations in non-blocking mode
+
+	The same as solveLinear, in a background thread. There are two ways to
+	use this, pass in an optional callback or accept a returned promise.
+
+	\code{.js}
+
+	X.solveLinearp( y ).then( function( theta ) { ... } ) ;
+
+	\endcode
+
+	@see SolveLinear
+	@param [in] B, an MxK matrix of right hand sides
+	@param [in,optional] options { spd:true|false, rcond:the smallest relative singular value to keep }
+	@param [in,optional] a callback of prototype function(err,X){ }
+	@return a promise which will resolve to the solution ( if there's no callback )
+*/
+void WrappedArray::SolveLinearp( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::SolveLinearHelper( args, true, 1 ) ;
+}
+
+/*
+	Check the args & set up the work for SolveLinearWorkAsync. The Cholesky
+	choice goes in xtraInt - 0 if the matrix is symmetric, 1 always, 2 never.
+	rcond goes in xtraFloat, it's negative if not given.
+*/
+void WrappedArray::SolveLinearHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex )
 {
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
-    EscapableHandleScope scope(isolate) ;
+  if( !IsMatrix( isolate, args[0] ) ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Expected a lalg.Array of right hand sides") ) );
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+  WrappedArray* other = ObjectWrap::Unwrap<WrappedArray>( args[0]->ToObject() ) ;
+  if( other->m_ != self->m_ ) {
+    char *msg = new char[ 1000 ] ;
+    snprintf( msg, 1000, "Incompatible args: |%d x %d| X = |%d x %d|", self->m_, self->n_, other->m_, other->n_ ) ;
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    delete [] msg ;
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
 
-    const unsigned argc = 2;
-// inverse matrix is NxM
-    Local<Value> argv[argc] = { Integer::New( isolate,self->n_ ), Integer::New( isolate,self->m_ ) };
-    Local<Function> cons = Local<Function>::New(isolate, constructor);
-    Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+  int spd = 0 ;
+  float rcond = -1.f ;
+  if( args[1]->IsObject() && !args[1]->IsFunction() ) {
+    Local<Object> options = args[1]->ToObject() ;
+    Local<Value> s = options->Get( context, String::NewFromUtf8(isolate, "spd") ).ToLocalChecked() ;
+    if( !s->IsUndefined() ) {
+      spd = s->BooleanValue() ? 1 : 2 ;
+    }
+    Local<Value> r = options->Get( context, String::NewFromUtf8(isolate, "rcond") ).ToLocalChecked() ;
+    if( r->IsNumber() ) {
+      rcond = std::max( 0., r->NumberValue() ) ;
+    }
+    callbackIndex++ ;
+  }
 
-    scope.Escape( instance );
+  Local<Object> instance ;
+  if( MakeResult( args, -1, self->n_, other->n_, &instance ) == NULL ) return ;
+  WrappedArray::PrepareWork( args, block, callbackIndex, WrappedArray::SolveLinearWorkAsync, instance, Local<Object>(), spd, rcond, NULL, NULL, other ) ;
+}
 
-    args.GetReturnValue().Set( instance );
-    WrappedArray* result = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+/* are the elements of the NxN matrix a ( leading dimension lda ) symmetric */
+bool WrappedArray::IsSymmetricData( const float *a, int n, int lda ) 
+{
+  for( int j=0 ; j<n ; j++ ) {
+    for( int i=j+1 ; i<n ; i++ ) {
+      if( a[i + (size_t)j*lda] != a[j + (size_t)i*lda] ) return false ;
+    }
+  }
+  return true ;
+}
 
-    int n = self->n_ ;
-    int m = self->m_ ;
+/**
+	Factor a square matrix as PA = LU, for solving again and again.
 
-/*******************************
-*  T A L L  inv(A' x A) x A'   *
-*******************************/
-if( m > n ) {	
-// multiply A'A to get NxN covariance
-  float *cov = new float[ n * n ] ;
-	
-  cblas_sgemm(
-      CblasColMajor,	// always
-      CblasTrans,	// A x A'
-      CblasNoTrans,     
-      n,		// A' rows ( N )
-      n,		// B cols ( N )
-      n,		// A cols		
-      1.f,		// mpy by 1.0 
-      self->data_,	// A data
-      m,		// A rows  
-      self->data_,	// B data
-      m,		// B rows
-      0.f,		// don't do anything with input cov
-      cov,		// output
-      n );		// output rows
-
-// then invert cov
-    int *ipiv = new int[ n ] ;  // cov matrix is n x n
-    int rc = LAPACKE_sgetrf(
-      CblasColMajor,
-      n,
-      n,
-      cov,
-      n,
-      ipiv ) ;
-    if( rc != 0 ) {
-      char *msg = new char[ 1000 ] ;
-      if( rc>0 ) {
-        snprintf( msg, 1000, "This matrix is singular and cannot be inverted" ) ;
-      } else {
-        snprintf( msg, 1000, "Internal failure - sgetrf() failed with %d", rc ) ;
+	\code{.js}
+
+	var F = A.lu() ;
+	var X = F.solve( B ) ;
+	var d = F.det() ;
+
+	\endcode
+
+	@see Factorization
+	@return a new factorization, which has solve(B), det(), logdet() and inv()
+*/
+void WrappedArray::Lu( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::FactorHelper( args, false, 0, Factorization::Lu ) ;
+}
+
+/**
+	Factor a square matrix as PA = LU, in non-blocking mode
+
+	@see Lu
+	@param [in,optional] a callback of prototype function(err,F){ }
+	@return a promise which will resolve to the factorization ( if there's no callback )
+*/
+void WrappedArray::Lup( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::FactorHelper( args, true, 0, Factorization::Lu ) ;
+}
+
+/**
+	Factor a symmetric positive definite matrix as A = U'U. Only the upper
+	triangle is read. It throws if the matrix is not positive definite, so
+	this is also a cheap test for that.
+
+	@see Factorization
+	@return a new factorization, which has solve(B), det(), logdet() and inv()
+*/
+void WrappedArray::Chol( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::FactorHelper( args, false, 0, Factorization::Cholesky ) ;
+}
+
+/**
+	Factor a symmetric positive definite matrix as A = U'U, in non-blocking mode
+
+	@see Chol
+	@param [in,optional] a callback of prototype function(err,F){ }
+	@return a promise which will resolve to the factorization ( if there's no callback )
+*/
+void WrappedArray::Cholp( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::FactorHelper( args, true, 0, Factorization::Cholesky ) ;
+}
+
+/**
+	Factor an MxN matrix, M >= N, as A = QR. The factorization's solve(B) 
+	gives the least squares solution, and inv() the pseudo inverse.
+
+	\code{.js}
+
+	var F = X.qr() ;
+	var theta = F.solve( y ) ;
+
+	\endcode
+
+	@see Factorization
+	@return a new factorization, which has solve(B), det(), logdet() and inv()
+*/
+void WrappedArray::Qr( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::FactorHelper( args, false, 0, Factorization::Qr ) ;
+}
+
+/**
+	Factor an MxN matrix as A = QR, in non-blocking mode
+
+	@see Qr
+	@param [in,optional] a callback of prototype function(err,F){ }
+	@return a promise which will resolve to the factorization ( if there's no callback )
+*/
+void WrappedArray::Qrp( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray::FactorHelper( args, true, 0, Factorization::Qr ) ;
+}
+
+/*
+	Check the shape & set up the work for Factorization::FactorWorkAsync. The 
+	result of the work is the ( hidden ) matrix of factors, the factorization
+	object is what's returned.
+*/
+void WrappedArray::FactorHelper( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, int kind )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+
+  const char *problem = NULL ;
+  if( kind == Factorization::Qr ) {
+    if( self->m_ < self->n_ ) problem = "should have at least as many rows as columns for a QR" ;
+  } else if( self->m_ != self->n_ ) {
+    problem = "should be a square matrix" ;
+  }
+  if( problem != NULL ) {
+    char *msg = new char[ 1000 ] ;
+    snprintf( msg, 1000, "Incompatible args: |%d x %d| %s", self->m_, self->n_, problem ) ;
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    delete [] msg ;
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+
+  Local<Object> factors ;
+  Local<Object> factorization = Factorization::Create( isolate, (Factorization::Kind)kind, self->m_, self->n_, &factors ) ;
+  WrappedArray::PrepareWork( args, block, callbackIndex, Factorization::FactorWorkAsync, factors, factorization, kind, 0.f, NULL,
+		ObjectWrap::Unwrap<Factorization>( factorization ), NULL, 1.f, factorization ) ;
+}
+
+/*
+	The body of solveLinear, maybe in a background thread. A is copied as
+	LAPACK writes its factors over it. Square systems are solved in the 
+	result's data, the others in a buffer big enough for B & X.
+*/
+void WrappedArray::SolveLinearWorkAsync( uv_work_t *req )
+{
+  Work *work = static_cast<Work *>(req->data);
+
+  WrappedArray* self = work->self ;
+  WrappedArray* other = work->other ;
+  WrappedArray* result = work->result ;
+  const int m = self->m_ ;
+  const int n = self->n_ ;
+  const int k = other->n_ ;
+  const int spd = work->xtraInt ;
+  float rcond = work->xtraFloat ;
+
+  std::vector<float> a( (size_t)m * n ) ;
+  self->CopyTo( a.data() ) ;
+  const int lda = std::max( 1, m ) ;
+
+  if( m == n && rcond < 0 ) {
+    const int ldx = std::max( 1, result->ld_ ) ;
+    other->CopyTo( result->data_ ) ;
+    bool chol = spd == 1 || ( spd == 0 && ( self->IsSymmetric() || IsSymmetricData( a.data(), n, lda ) ) ) ;
+    int rc = 0 ;
+    if( chol ) {
+      rc = LAPACKE_sposv( CblasColMajor, 'U', n, k, a.data(), lda, result->data_, ldx ) ;
+      if( rc > 0 && spd == 0 ) {	// symmetric, but not positive definite - start again with LU
+        self->CopyTo( a.data() ) ;
+        other->CopyTo( result->data_ ) ;
+        chol = false ;
       }
-      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-      delete msg  ;
-      args.GetReturnValue().Set( Undefined(isolate) );
     }
-    else {
-      rc = LAPACKE_sgetri(
-        CblasColMajor,
-        n,
-        cov,
-        n,
-        ipiv ) ;
-      if( rc != 0 ) {
-        char *msg = new char[ 1000 ] ;
-        snprintf( msg, 1000, "Internal failure - sgetri() failed with %d", rc ) ;
-        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-        delete msg ;
-        args.GetReturnValue().Set( Undefined(isolate) );
-      }
+    if( !chol ) {
+      std::vector<int> ipiv( std::max( 1, n ) ) ;
+      rc = LAPACKE_sgesv( CblasColMajor, n, k, a.data(), lda, ipiv.data(), result->data_, ldx ) ;
     }
-    delete ipiv ;
-
-// finally multiply the above inverse by A'
-   cblas_sgemm(
-      CblasColMajor,
-      CblasNoTrans,	// COV x A'
-      CblasTrans,
-      n,		// COV rows
-      n,		// A' cols = n
-      n,		// COV cols
-      1.f,		// no scaling of COV
-      cov,		// COV
-      n,		// COV rows
-      self->data_,	// A
-      m,		// A rows
-      0.f,		// leave result alone
-      result->data_,	// result
-      m );	  	// rows in result
-   delete cov ;
-
-  } else {  	
-/*******************************
-*  S H O R T  A' x inv(A x A') *
-*******************************/
-
-// multiply AA' to get MxM covariance
-  float *cov = new float[ m * m ] ;
-	
-  cblas_sgemm(
-      CblasColMajor,	// always
-      CblasNoTrans,	// A x A'
-      CblasTrans,     
-      m,		// A rows ( m )
-      m,		// B cols ( A' cols = m )
-      n,		// A cols ( n ) 
-      1.f,		// mpy by 1.0 
-      self->data_,	// A data
-      m,		// A rows  
-      self->data_,	// B data
-      m,		// B rows
-      0.f,		// don't do anything with input cov
-      cov,		// output
-      m );		// output rows
-
-// then invert cov
-
-    int *ipiv = new int[ n ] ;  // cov matrix is m x m
-    int rc = LAPACKE_sgetrf(
-      CblasColMajor,
-      m,
-      m,
-      cov,
-      m,
-      ipiv ) ;
-    if( rc != 0 ) {
-      char *msg = new char[ 1000 ] ;
-      if( rc>0 ) {
-        snprintf( msg, 1000, "This matrix is singular and cannot be inverted" ) ;
-      } else {
-        snprintf( msg, 1000, "Internal failure - sgetrf() failed with %d", rc ) ;
-      }
-      isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-      delete msg  ;
-      args.GetReturnValue().Set( Undefined(isolate) );
-    } else {
-      rc = LAPACKE_sgetri(
-        CblasColMajor,
-        m,
-        cov,
-        m,
-        ipiv ) ;
-      if( rc != 0 ) {
-        char *msg = new char[ 1000 ] ;
-        snprintf( msg, 1000, "Internal failure - sgetri() failed with %d", rc ) ;
-        isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-        delete msg ;
-        args.GetReturnValue().Set( Undefined(isolate) );
+    if( rc != 0 ) {
+      work->err = new char[ 1000 ] ;
+      if( rc > 0 ) {
+        snprintf( work->err, 1000, chol ? "This matrix is not positive definite" : "This matrix is singular, try an rcond" ) ;
+      } else {
+        snprintf( work->err, 1000, "Internal failure - %s() failed with %d", chol ? "sposv" : "sgesv", rc ) ;
       }
     }
-    delete ipiv ;
-
-// finally multiply A' by the above inverse
-   cblas_sgemm(
-      CblasColMajor,
-      CblasTrans,	// A' x COV 
-      CblasNoTrans,
-      n,		// A' rows
-      m,		// A' cols 
-      m,		// COV cols
-      1.f,		// no scaling of COV
-      self->data_,	// A'
-      m,		// A rows
-      cov,		// COV
-      m,		// COV rows
-      0.f,		// leave result alone
-      result->data_,	// result
-      n );		// rows in result
+    return ;
+  }
 
-   delete cov ;
+// B goes in the top of an max(M,N) x K buffer, sgels & sgelsd leave X in its first N rows
+  const int ldb = std::max( 1, std::max( m, n ) ) ;
+  std::vector<float> b( (size_t)ldb * k ) ;
+  auto copyB = [&]() {
+    for( int c=0 ; c<k ; c++ ) {
+      memcpy( b.data() + (size_t)c*ldb, other->data_ + (size_t)c*other->ld_, m*sizeof(float) ) ;
+    }
+  } ;
+  copyB() ;
+
+  int rc = 0 ;
+  const char *routine = "sgels" ;
+  if( rcond < 0 ) {
+    rc = LAPACKE_sgels( CblasColMajor, 'N', m, n, k, a.data(), lda, b.data(), ldb ) ;
+  // sgels only fails on an exact 0 in R. Rounding hides most rank deficiency, so a
+  // tiny diagonal element, relative to the biggest, counts as 0 too.
+    const float tiny = std::max( m, n ) * std::numeric_limits<float>::epsilon() ;
+    if( rc == 0 ) {
+      float rmin = INFINITY, rmax = 0 ;
+      for( int i=0 ; i<std::min( m, n ) ; i++ ) {
+        const float r = ::fabs( a[ i + (size_t)i*lda ] ) ;
+        rmin = std::min( rmin, r ) ;
+        rmax = std::max( rmax, r ) ;
+      }
+      if( rmin <= tiny * rmax ) rc = 1 ;
+    }
+    if( rc > 0 ) {		// not of full rank, go again with the SVD
+      self->CopyTo( a.data() ) ;
+      copyB() ;
+      rcond = tiny ;
+    }
+  }
+  if( rcond >= 0 ) {
+    routine = "sgelsd" ;
+    std::vector<float> s( std::max( 1, std::min( m, n ) ) ) ;
+    int rank = 0 ;
+    rc = LAPACKE_sgelsd( CblasColMajor, m, n, k, a.data(), lda, b.data(), ldb, s.data(), rcond, &rank ) ;
+  }
+  if( rc != 0 ) {
+    work->err = new char[ 1000 ] ;
+    snprintf( work->err, 1000, "Internal failure - %s() failed with %d", routine, rc ) ;
+    return ;
+  }
+  for( int c=0 ; c<k ; c++ ) {
+    memcpy( result->data_ + (size_t)c*result->ld_, b.data() + (size_t)c*ldb, n*sizeof(float) ) ;
   }
 }
 
@@ -2194,7 +6805,8 @@ void WrappedArray::Svd( const v8::FunctionCallbackInfo<v8::Value>& args )
   Isolate* isolate = args.GetIsolate();
   Local<Context> context = isolate->GetCurrentContext() ;
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   EscapableHandleScope scope(isolate) ;
 
@@ -2221,11 +6833,10 @@ void WrappedArray::Svd( const v8::FunctionCallbackInfo<v8::Value>& args )
   WrappedArray* s = ObjectWrap::Unwrap<WrappedArray>(S);
 
   float *data = new float[ self->m_ * self->n_ ] ;
-  memcpy( data, self->data_, sizeof(float) * self->m_ * self->n_ ) ; 
+  self->CopyTo( data ) ; 
 
   float *superb = new float[ ::min(self->m_,self->n_) ] ;
-  int rc = LAPACKE_sgesvd(
-    CblasColMajor,
+  int rc = Blas<float>::gesvd(
     'A', 'A',
     self->m_,
     self->n_,
@@ -2238,14 +6849,14 @@ void WrappedArray::Svd( const v8::FunctionCallbackInfo<v8::Value>& args )
     self->n_,
     superb ) ;
 
-  delete superb ;
-  delete data ;
+  delete [] superb ;
+  delete [] data ;
 
   if( rc != 0 ) {
     char *msg = new char[ 1000 ] ;
     snprintf( msg, 1000, "Internal failure - sgesvd() failed with %d", rc ) ;
     isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-    delete msg ;
+    delete [] msg ;
     args.GetReturnValue().Set( Undefined(isolate) );
   }
   else {
@@ -2299,26 +6910,32 @@ void WrappedArray::Pca( const v8::FunctionCallbackInfo<v8::Value>& args )
 
   float variance = args[0]->IsUndefined() ? 0.97f : args[0]->NumberValue();
 
-  WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
 
   int ls = std::min(self->n_,self->m_) ;
   float *vt = new float[ self->n_ * self->n_ ] ;
   float *s  = new float[ ls ] ;
   float *superb = new float[ self->m_ * self->n_ ] ;
 
-  int rc = LAPACKE_sgesvd(
-    CblasColMajor,
+// sgesvd destroys its input - work on a packed copy, never on the storage
+// ( which may be shared by a dup, a view's parent or a read only mapping )
+  float *data = new float[ self->m_ * self->n_ ] ;
+  self->CopyTo( data ) ;
+
+  int rc = Blas<float>::gesvd(
     'N', 'A',
     self->m_,
     self->n_,
-    self->data_,
-    self->m_,
+    data,
+    std::max( 1, self->m_ ),
     s,
     NULL,
-    self->m_,
+    std::max( 1, self->m_ ),
     vt,
-    self->n_,
+    std::max( 1, self->n_ ),
     superb ) ;
+  delete [] data ;
 
   float sum = 0 ;
   for( int i=0 ; i<ls ; i++ ) {
@@ -2335,7 +6952,7 @@ void WrappedArray::Pca( const v8::FunctionCallbackInfo<v8::Value>& args )
     char *msg = new char[ 1000 ] ;
     snprintf( msg, 1000, "Internal failure - sgesvd() failed with %d", rc ) ;
     isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
-    delete msg ;
+    delete [] msg ;
     args.GetReturnValue().Set( Undefined(isolate) );
   }
   else {
@@ -2358,9 +6975,146 @@ void WrappedArray::Pca( const v8::FunctionCallbackInfo<v8::Value>& args )
     }
     args.GetReturnValue().Set( instance );
   }
-  delete superb ;
-  delete vt ;
-  delete s ;
+  delete [] superb ;
+  delete [] vt ;
+  delete [] s ;
+}
+
+
+
+/**
+	The Gram matrix X'X
+
+	Makes the NxN product X'X with ssyrk, which does half the work of 
+	X.t().mul( X ) - only one triangle is worked out, then copied over the
+	other. The result is marked symmetric ( @see symmetric ).
+
+	An output matrix & beta add the product in, G = X'X + beta x G. That
+	accumulates a Gram matrix over blocks of rows, without the whole X in
+	memory at once. Only the upper triangle of the output is read.
+
+	\code{.js}
+
+	var G = X.gram() ;
+	var G = lalg.zeros( X.n, X.n ) ;
+	for( var r=0 ; r<X.m ; r+=1000 ) X.viewRows( r, Math.min( 1000, X.m-r ) ).gram( G, 1 ) ;
+
+	\endcode
+
+	@param [in,optional] an NxN matrix to write the result into, instead of a new matrix
+	@param [in,optional] beta, the multiple of out to add to the product, default 0
+	@return a new NxN matrix, or the output matrix
+*/
+void WrappedArray::Gram( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
+  WrappedArray* result = MakeResult( args, 0, self->n_, self->n_ ) ;
+  if( result == NULL ) return ;
+  if( result->storage_ == self->storage_ ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Output matrix must not share data with the target") ) );
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return ;
+  }
+  float beta = args[1]->IsNumber() ? args[1]->NumberValue() : 0.f ;
+
+  SymmetricProduct( self->data_, self->ld_, self->m_, self->n_, false, 1.f, beta, result->data_, result->ld_ ) ;
+  result->MarkSymmetric() ;
+}
+
+/*
+	The body of cov & corr. Reads the options, makes the covariance matrix
+	and returns it - NULL if there's an exception.
+*/
+WrappedArray *WrappedArray::CovarianceHelper( const v8::FunctionCallbackInfo<v8::Value>& args ) 
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return NULL ;
+
+  bool center = true ;
+  Local<Value> out = Undefined( isolate ) ;
+  if( args[0]->IsObject() ) {
+    Local<Object> options = args[0]->ToObject() ;
+    Local<Value> c = options->Get( context, String::NewFromUtf8(isolate, "center") ).ToLocalChecked() ;
+    if( !c->IsUndefined() ) {
+      center = c->BooleanValue() ;
+    }
+    out = options->Get( context, String::NewFromUtf8(isolate, "out") ).ToLocalChecked() ;
+  }
+
+  WrappedArray* result = MakeResult( args, out, self->n_, self->n_ ) ;
+  if( result == NULL ) return NULL ;
+  if( result->storage_ == self->storage_ ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "Output matrix must not share data with the target") ) );
+    args.GetReturnValue().Set( Undefined(isolate) );
+    return NULL ;
+  }
+  Covariance( self, center, result->data_, result->ld_ ) ;
+  return result ;
+}
+
+/**
+	The covariance of the columns
+
+	Each row is an observation, each column a variable. The NxN result is
+	the sample covariance, ( X-mean )'( X-mean ) / ( M-1 ). Centered rows go
+	through ssyrk a block at a time, so there's no centered copy of X. With
+	center false the data is used as is, X'X / M. The result is marked
+	symmetric ( @see symmetric ).
+
+	\code{.js}
+
+	var C = X.cov() ;
+	var S = X.cov( { center:false } ) ;	// second moments
+
+	\endcode
+
+	@param [in,optional] options { center:true|false, out:an NxN matrix to write the result into }
+	@return a new NxN matrix, or the output matrix
+*/
+void WrappedArray::Cov( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* result = CovarianceHelper( args ) ;
+  if( result == NULL ) return ;
+  result->MarkSymmetric() ;
+}
+
+/**
+	The correlation of the columns
+
+	The covariance ( @see Cov ) scaled so each diagonal element is 1, 
+	C( i,j ) / sqrt( C( i,i ) x C( j,j ) ). A constant column has no
+	correlation ( NaN ). With center false it's the cosine similarity of 
+	the columns.
+
+	\code{.js}
+
+	var R = X.corr() ;
+
+	\endcode
+
+	@param [in,optional] options { center:true|false, out:an NxN matrix to write the result into }
+	@return a new NxN matrix, or the output matrix
+*/
+void WrappedArray::Corr( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  WrappedArray* result = CovarianceHelper( args ) ;
+  if( result == NULL ) return ;
+
+  const int n = result->n_ ;
+  std::vector<float> scale( n ) ;
+  for( int j=0 ; j<n ; j++ ) scale[j] = 1.f / ::sqrtf( result->data_[ j + (size_t)j*result->ld_ ] ) ;
+  for( int j=0 ; j<n ; j++ ) {
+    float *c = result->data_ + (size_t)j*result->ld_ ;
+    for( int i=0 ; i<n ; i++ ) c[i] *= scale[i] * scale[j] ;
+    if( !std::isnan( c[j] ) ) c[j] = 1.f ;
+  }
+  result->MarkSymmetric() ;
 }
 
 
@@ -2393,8 +7147,9 @@ void WrappedArray::Diag( const v8::FunctionCallbackInfo<v8::Value>& args )
   for( int i=0 ; i<sz ; i++ ) {
     rc->data_[i] = 0 ;
   }
+  int stride = self->VectorStride() ;
   for( int i=0 ; i<self->m_ ; i++ ) {
-    rc->data_[i*rc->m_+i] = self->data_[i] ;
+    rc->data_[i*rc->m_+i] = self->data_[i*stride] ;
   }
   args.GetReturnValue().Set( instance );
 }
@@ -2534,6 +7289,110 @@ void WrappedArray::Rand( const v8::FunctionCallbackInfo<v8::Value>& args )
 
 
 
+/** 
+	Returns the statistics of the matrix buffer pool
+
+	All matrix data is allocated from a pool of aligned buffers. Freed
+	buffers are kept for reuse, up to a limit. This reports how well
+	the pool is working.
+
+	\code{.js}
+
+	var lalg = require('lalg');
+	var stats = lalg.poolStats() ;
+	console.log( stats.hits, stats.misses ) ;
+
+	\endcode
+
+	@return an object with
+	- hits the number of allocations reusing a pooled buffer
+	- misses the number of allocations which needed new memory
+	- cached the number of bytes held in the pool
+	- buffers the number of buffers held in the pool
+	- limit the max number of bytes the pool will hold
+*/
+void WrappedArray::PoolStats( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  BufferPool::Stats stats = BufferPool::Instance().GetStats() ;
+
+  Local<Object> result = Object::New(isolate);
+  result->Set(String::NewFromUtf8(isolate, "hits"), Number::New( isolate, stats.hits ) );
+  result->Set(String::NewFromUtf8(isolate, "misses"), Number::New( isolate, stats.misses ) );
+  result->Set(String::NewFromUtf8(isolate, "cached"), Number::New( isolate, stats.cached ) );
+  result->Set(String::NewFromUtf8(isolate, "buffers"), Number::New( isolate, stats.buffers ) );
+  result->Set(String::NewFromUtf8(isolate, "limit"), Number::New( isolate, stats.limit ) );
+  args.GetReturnValue().Set( result );
+}
+
+
+/** 
+	Set the max size of the matrix buffer pool
+
+	Freed matrix buffers are kept for reuse until the pool holds this 
+	many bytes, after that they're returned to the system. Lowering the
+	limit releases the excess immediately. Set to 0 to disable pooling.
+
+	@param [in] the max number of bytes to keep in the pool
+	@return the previous limit
+*/
+void WrappedArray::SetPoolLimit( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  if( !args[0]->IsNumber() || args[0]->NumberValue() < 0 ) {
+    Local<String> err = String::NewFromUtf8(isolate, "Pool limit must be a positive number of bytes");
+    isolate->ThrowException(Exception::TypeError( err ) );
+    return ;
+  }
+  size_t old = BufferPool::Instance().SetLimit( (size_t)args[0]->NumberValue() ) ;
+  args.GetReturnValue().Set( Number::New( isolate, old ) );
+}
+
+
+/** 
+	Set the number of threads used by element wise functions & reductions
+
+	Big element wise functions ( add, sub, hadamard, mul by a number, neg,
+	log, abs, sqrt, find ... ) and the reductions ( sum, mean, norm and
+	asum ) are split across a pool of threads. It starts with one thread
+	per core. Matrices smaller than minElements are done on the calling
+	thread, waking the pool costs more than it saves.
+
+	\code{.js}
+
+	var lalg = require('lalg');
+	lalg.setThreads( 8 ) ;			// 8 threads
+	lalg.setThreads( 1 ) ;			// no threading
+	var n = lalg.setThreads() ;		// just read the thread count
+	lalg.setThreads( 4, 100000 ) ;		// only split matrices with 100000+ elements
+
+	\endcode
+
+	@param [in,optional] the number of threads, 1 turns threading off. Leave it out to keep the current count
+	@param [in,optional] the smallest number of elements worth splitting, default 65536
+	@return the number of threads in use before the call
+*/
+void WrappedArray::SetThreads( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+
+  if( ( !args[0]->IsUndefined() && ( !args[0]->IsNumber() || args[0]->NumberValue() < 1 ) ) ||
+      ( !args[1]->IsUndefined() && ( !args[1]->IsNumber() || args[1]->NumberValue() < 1 ) ) ) {
+    Local<String> err = String::NewFromUtf8(isolate, "Thread count and min elements must be positive numbers");
+    isolate->ThrowException(Exception::TypeError( err ) );
+    return ;
+  }
+  ThreadPool &pool = ThreadPool::Instance() ;
+  int old = pool.Threads() ;
+  if( !args[0]->IsUndefined() ) pool.SetThreads( (int)args[0]->NumberValue() ) ;
+  if( !args[1]->IsUndefined() ) pool.SetMinElements( (size_t)args[1]->NumberValue() ) ;
+  args.GetReturnValue().Set( Integer::New( isolate, old ) );
+}
+
+
+
 /** 
 	Solves a function for its minimum
 	
@@ -2622,6 +7481,8 @@ void WrappedArray::SolveHelper( const v8::FunctionCallbackInfo<v8::Value>& args,
 
   scope.Escape(args.Holder());
 
+  WrappedArray* self = Self( args ) ;
+  if( self == NULL ) return ;
   if( args[0]->IsObject() ) {
       int solverIndex = args[1]->IsUndefined() ? 0 : args[1]->NumberValue() ;
       if( !args[1]->IsUndefined() && args[1]->IsString() ) {
@@ -2634,11 +7495,12 @@ void WrappedArray::SolveHelper( const v8::FunctionCallbackInfo<v8::Value>& args,
 	else if( !::strcasecmp( "NELDERMEAD", c ) ) solverIndex = 3 ;
 	else if( !::strcasecmp( "LBFGS", c ) ) solverIndex = 4 ;
 	else if( !::strcasecmp( "CMAES", c ) ) solverIndex = 5 ;
-	delete c ;
+	delete [] c ;
       }
 
 	Local<Object> ufg = args[0]->ToObject() ;
-      
+
+      self->MakeWritable() ;	// the solver writes its answer into the target
       WrappedArray::PrepareWork( args, block, callbackIndex, WrappedArray::SolveWorkAsync, 
 				 args.Holder(), ufg, solverIndex ) ;
   }
@@ -2662,7 +7524,7 @@ void WrappedArray::SolveWorkAsync( uv_work_t *req )
   UserGradientFunction f( isolate, self, selfObj, userFunctionHolder ) ;
 
   // choose a starting point
-  UserGradientFunction::TVector x(2); x << self->data_[0], self->data_[1] ;
+  UserGradientFunction::TVector x(2); x << self->Elem(0), self->Elem(1) ;
 
   int solverIndex = work->xtraInt ;
 
@@ -2740,7 +7602,7 @@ void WrappedArray::NextCallback( const v8::FunctionCallbackInfo<v8::Value>& args
     result->Set(String::NewFromUtf8(isolate, "value"), Undefined(isolate) ) ;
     result->Set(String::NewFromUtf8(isolate, "done"),  Boolean::New( isolate, true ) ) ;
   } else {
-    result->Set(String::NewFromUtf8(isolate, "value"), Number::New( isolate,self->data_[index] ) ) ;
+    result->Set(String::NewFromUtf8(isolate, "value"), Number::New( isolate,self->Elem(index) ) ) ;
     result->Set(String::NewFromUtf8(isolate, "done"),  Boolean::New( isolate, false ) ) ;
   }
 
@@ -2818,6 +7680,267 @@ void WrappedArray::Read( const v8::FunctionCallbackInfo<v8::Value>& args )
 
 
 
+/**
+	Create a matrix on top of a javascript buffer
+
+	The matrix uses the buffer's memory directly, nothing is copied. The buffer
+	and the matrix share their data - changes to one are seen in the other. The
+	matrix keeps the buffer alive for as long as it needs it.
+
+	The buffer may be a Float32Array, an ArrayBuffer, a SharedArrayBuffer or
+	any other typed array (e.g. a nodejs Buffer), which is read as raw 
+	floats. The data is in column major order.
+
+	\code{.js}
+
+	var lalg = require('lalg');
+	var f = new Float32Array( 50000000 ) ;
+	var X = lalg.fromBuffer( f, 10000, 5000 ) ;
+
+	\endcode
+
+	@param [in] the buffer holding the data
+	@param [in,default=buffer length] the number of rows (m) 
+	@param [in,default=buffer length/m] the number of columns (n)
+	@return a new matrix sharing the buffer's memory
+*/
+void WrappedArray::FromBuffer( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  size_t count = 0 ;
+  if( args[0]->IsArrayBufferView() ) {
+    count = Local<ArrayBufferView>::Cast( args[0] )->ByteLength() / sizeof(float) ;
+  } else if( args[0]->IsArrayBuffer() ) {
+    count = Local<ArrayBuffer>::Cast( args[0] )->ByteLength() / sizeof(float) ;
+  } else if( args[0]->IsSharedArrayBuffer() ) {
+    count = Local<SharedArrayBuffer>::Cast( args[0] )->ByteLength() / sizeof(float) ;
+  } else {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "fromBuffer() needs a typed array or an ArrayBuffer")));
+    return ;
+  }
+  if( args[0]->IsFloat64Array() ) {
+    count = Local<Float64Array>::Cast( args[0] )->Length() ;
+  }
+
+  int m = args[1]->IsUndefined() ? count : args[1]->NumberValue() ;
+  int n = args[2]->IsUndefined() ? ( m==0 ? 0 : count/m ) : args[2]->NumberValue() ;
+
+  EscapableHandleScope scope(isolate) ;
+
+  const unsigned argc = 2;
+  Local<Value> argv[argc] = { Integer::New( isolate, 0 ), Integer::New( isolate, 0 ) };
+  Local<Function> cons = Local<Function>::New(isolate, constructor);
+  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+
+  scope.Escape(instance);
+  WrappedArray* self = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+  if( self->Adopt( isolate, args[0], m, n ) ) {
+    args.GetReturnValue().Set( instance );
+  }
+}
+
+
+
+/**
+	Create a matrix on a memory mapped file
+
+	The file holds raw floats in column major order ( e.g. written from a
+	Float32Array ). Only the pages that are used are read in, so the file can be 
+	bigger than memory. The mapping is released when the matrix ( and any dup or 
+	view of it ) is collected.
+
+	The mode is one of
+	- 'r' read only (default). The matrix takes a private copy of its data 
+	the first time it's changed ( e.g. set, addi ).
+	- 'c' copy on write. Changed pages are private to this process, the file is
+	never written.
+
+	The advice tells the kernel how the data will be read, 'sequential' (default) 
+	suits column scans ( mul, sum, getColumns ...), 'random' suits picking rows.
+
+	\code{.js}
+
+	var lalg = require('lalg');
+	var X = lalg.mmap( 'train.f32', 784, undefined, { mode:'r' } ) ;
+	var batch = X.viewColumns( 0, 256 ) ;
+
+	\endcode
+
+	@param [in] the file name
+	@param [in,default=file length] the number of rows (m) 
+	@param [in,default=file length/m] the number of columns (n)
+	@param [in,optional] options { mode:'r'|'c', offset:bytes to skip, advice:'sequential'|'random'|'normal' }
+	@return a new matrix using the file's data
+*/
+void WrappedArray::MMap( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  if( !args[0]->IsString() ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "mmap() needs a file name")));
+    return ;
+  }
+  String::Utf8Value path( args[0] ) ;
+
+  bool writable = false ;
+  size_t offset = 0 ;
+  int advice = MADV_SEQUENTIAL ;
+  if( args[3]->IsObject() ) {
+    Local<Object> options = args[3]->ToObject() ;
+    Local<Value> mode = options->Get( context, String::NewFromUtf8(isolate, "mode") ).ToLocalChecked() ;
+    if( mode->IsString() ) {
+      String::Utf8Value s( mode ) ;
+      writable = !::strcmp( "c", *s ) ;
+    }
+    Local<Value> off = options->Get( context, String::NewFromUtf8(isolate, "offset") ).ToLocalChecked() ;
+    if( off->IsNumber() ) {
+      offset = off->NumberValue() ;
+    }
+    Local<Value> adv = options->Get( context, String::NewFromUtf8(isolate, "advice") ).ToLocalChecked() ;
+    if( adv->IsString() ) {
+      String::Utf8Value s( adv ) ;
+      if( !::strcmp( "random", *s ) ) advice = MADV_RANDOM ;
+      else if( !::strcmp( "normal", *s ) ) advice = MADV_NORMAL ;
+    }
+  }
+  if( ( offset % sizeof(float) ) != 0 ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "mmap() offset must be a multiple of 4 bytes")));
+    return ;
+  }
+
+  Storage *storage = Storage::Map( *path, offset, writable, advice ) ;
+  if( storage == NULL ) {
+    char *msg = new char[ 1000 ] ;
+    snprintf( msg, 1000, "Can't map %s - %s", *path, strerror( errno ) ) ;
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    delete [] msg ;
+    return ;
+  }
+
+  int count = storage->capacity ;
+  int m = args[1]->IsUndefined() ? count : args[1]->NumberValue() ;
+  int n = args[2]->IsUndefined() ? ( m==0 ? 0 : count/m ) : args[2]->NumberValue() ;
+  if( m<0 || n<0 || (size_t)m*n > (size_t)count ) {
+    storage->Release() ;
+    char *msg = new char[ 1000 ] ;
+    snprintf( msg, 1000, "File of %d floats is too small for |%d x %d|", count, m, n ) ;
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, msg)));
+    delete [] msg ;
+    return ;
+  }
+
+  EscapableHandleScope scope(isolate) ;
+
+  const unsigned argc = 2;
+  Local<Value> argv[argc] = { Integer::New( isolate, 0 ), Integer::New( isolate, 0 ) };
+  Local<Function> cons = Local<Function>::New(isolate, constructor);
+  Local<Object> instance = cons->NewInstance(context, argc, argv).ToLocalChecked() ;
+
+  scope.Escape(instance);
+  WrappedArray* self = node::ObjectWrap::Unwrap<WrappedArray>( instance ) ;
+  self->UseStorage( storage ) ;
+  self->m_ = m ;
+  self->n_ = n ;
+  self->ld_ = m ;
+  self->isVector = m==1 || n==1 ;
+  args.GetReturnValue().Set( instance );
+}
+
+
+
+/**
+	Run a function in a memory scope
+
+	Every matrix created while the function runs gets its data from a scope
+	arena - one big block of memory, not lots of small ones. When the function
+	returns, the matrices it returns ( either the return value or the matrices
+	in a returned array or object ) are copied out of the arena, the other
+	matrices made in the scope are emptied ( they become 0x0 ) and the arena is 
+	freed. So the memory used by temporaries is freed straight away, not when 
+	V8 gets round to collecting them.
+
+	Don't keep matrices made in a scope, other than by returning them. A matrix
+	still being used by a background job (mulp, invp ...) is left alone, it 
+	keeps the arena alive until it is collected. Scopes may be nested.
+
+	\code{.js}
+
+	var W = lalg.scope( function() {
+	  var XT = X.transpose() ;
+	  return XT.mul( X ).inv().mul( XT ).mul( y ) ;
+	} ) ;
+
+	\endcode
+
+	@param [in] a function, it's called with no arguments
+	@return whatever the function returned
+*/
+void WrappedArray::RunInScope( const v8::FunctionCallbackInfo<v8::Value>& args )
+{
+  Isolate* isolate = args.GetIsolate();
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  if( !args[0]->IsFunction() ) {
+    isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, "scope() needs a function to run")));
+    return ;
+  }
+  Local<Function> fn = Local<Function>::Cast( args[0] ) ;
+
+  Scope *scope = new Scope( Scope::Current() ) ;
+  Scope::Current() = scope ;
+  MaybeLocal<Value> rc = fn->Call( context, context->Global(), 0, NULL ) ;
+  Scope::Current() = scope->outer ;
+
+  // on an exception keep nothing - the exception is passed on to the caller
+  Local<Value> keep = rc.IsEmpty() ? Local<Value>( Undefined(isolate) ) : rc.ToLocalChecked() ;
+  EndScope( isolate, scope, keep ) ;
+  if( !rc.IsEmpty() ) {
+    args.GetReturnValue().Set( keep ) ;
+  }
+}
+
+/*
+	Finish a scope: promote the matrices in keep (a matrix, or an array or
+	object holding matrices), empty the rest. The scope is deleted once the 
+	last storage in its arena is released.
+*/
+void WrappedArray::EndScope( Isolate *isolate, Scope *scope, Local<Value> keep )
+{
+  Local<Context> context = isolate->GetCurrentContext() ;
+
+  std::vector<WrappedArray*> kept ;
+  if( IsMatrix( isolate, keep ) ) {
+    kept.push_back( ObjectWrap::Unwrap<WrappedArray>( keep->ToObject() ) ) ;
+  } else if( keep->IsObject() ) {
+    Local<Object> obj = keep->ToObject() ;
+    Local<Array> keys = obj->GetOwnPropertyNames( context ).ToLocalChecked() ;
+    for( uint32_t i=0 ; i<keys->Length() ; i++ ) {
+      Local<Value> v = obj->Get( context, keys->Get( context, i ).ToLocalChecked() ).ToLocalChecked() ;
+      if( IsMatrix( isolate, v ) ) {
+        kept.push_back( ObjectWrap::Unwrap<WrappedArray>( v->ToObject() ) ) ;
+      }
+    }
+  }
+
+  // Promote & Empty change the list - so work on a copy
+  std::vector<WrappedArray*> matrices = scope->matrices ;
+  for( size_t i=0 ; i<matrices.size() ; i++ ) {
+    WrappedArray *m = matrices[i] ;
+    if( m->busy_ > 0 ) continue ;
+    if( std::find( kept.begin(), kept.end(), m ) != kept.end() ) {
+      m->Promote() ;
+    } else {
+      m->Empty() ;
+    }
+  }
+  scope->Release() ;
+}
+
+
+
 /*
 	This is the callback function that is called when reading
 	a new array from a stream.
@@ -2853,13 +7976,13 @@ void WrappedArray::DataCallback(const FunctionCallbackInfo<Value>& args) {
     int numColsToRead = ::min( (uint32_t)self->m_, cols->Length() ) ;  // #items to read
 
 // If we've overflowed the current buffer - let's expand it
-    if( self->dataSize_ <= (self->n_*self->m_) ) {
-      float *tmp = self->data_ ;
-      size_t oldDataSize = self->dataSize_ ;
-      self->dataSize_ = ::max( (self->n_*2), self->n_+16 )*self->m_  ;
-      self->data_ = new float[ self->dataSize_ ] ; 
-      memcpy( self->data_, tmp, oldDataSize*sizeof(float) ) ;
-      delete tmp ;
+    if( self->dataSize_ < ((self->n_+1)*self->m_) ) {
+      Storage *storage = self->NewStorage( ::max( (self->n_*2), self->n_+16 )*self->m_ ) ;
+      if( self->n_*self->m_ > 0 ) {	// the first row has nothing to copy ( & data_ may be NULL )
+        memcpy( storage->data, self->data_, self->n_*self->m_*sizeof(float) ) ;
+      }
+      self->UseStorage( storage ) ;
+      self->ld_ = self->m_ ;
     }
 // Then copy the array data to our local buffer
     int p = (self->n_*self->m_) ;
@@ -2887,23 +8010,16 @@ void WrappedArray::DataEndCallback(const FunctionCallbackInfo<Value>& args ) {
   WrappedArray* self = ObjectWrap::Unwrap<WrappedArray>( obj );
 
   if( !self->isVector ) { // don't transpose a vector - just switch m & n later
-    self->dataSize_ = self->m_ * self->n_ ;
-    float *data = new float[ self->dataSize_] ;
-    int ixa = 0 ;
-    for( int r=0 ; r<self->m_ ; r++ ) {
-      int ixb = r ;
-      for( int c=0 ; c<self->n_ ; c++ ) {
-        data[ixa++] = self->data_[ixb+(c*self->m_)] ;
-      }
-    }
-    delete self->data_ ;
-    self->data_ = data ;
+    Storage *storage = self->NewStorage( self->m_ * self->n_ ) ;
+    Transposer::Copy( self->data_, self->m_, self->m_, self->n_, storage->data, self->n_ ) ;
+    self->UseStorage( storage ) ;
   }
 
 // Swap rows & cols
   int tmp = self->m_ ;
   self->m_ = self->n_ ;
   self->n_ = tmp ;
+  self->ld_ = self->m_ ;
 
 // Then get the promise from the work data and resolve it
   Local<Value> promise = xtra->Get( context, String::NewFromUtf8(isolate, "promise") ).ToLocalChecked() ;
@@ -2942,12 +8058,13 @@ void WrappedArray::PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args,
   WrappedArray::PrepareWork( args, block, callbackIndex, work_cb, instance, Local<Object>(), 0 ) ;
 }
 
-void WrappedArray::PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, uv_work_cb work_cb, Local<Object> instance, Local<Object> xtraObj, int xtraInt ) {
+void WrappedArray::PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args, bool block, int callbackIndex, uv_work_cb work_cb, Local<Object> instance, Local<Object> xtraObj, int xtraInt, float xtraFloat, WrappedArray *target, void *xtraPtr, WrappedArray *other, float alpha, Local<Object> returned ) {
   Isolate* isolate = args.GetIsolate();
 
   EscapableHandleScope scope(isolate) ;
 
-  WrappedArray *self = ObjectWrap::Unwrap<WrappedArray>(args.Holder());
+// self is the target of the call, unless the call is on something else ( e.g. a sparse matrix )
+  WrappedArray *self = target != NULL ? target : ObjectWrap::Unwrap<WrappedArray>(args.Holder());
 // Work is used to pass info into our execution threda
   Work *work = new Work();
   work->request.data = work;   // 1st is to set the work so the thread can see our Work struct
@@ -2966,20 +8083,26 @@ void WrappedArray::PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args,
 	    WrappedArray *other = ObjectWrap::Unwrap<WrappedArray>( possibleOther ) ;
 	    work->other = other ;
     }
-    delete c ;
+    delete [] c ;
+  }
+  if( other != NULL ) {		// e.g. the matrix behind a transposed view
+    work->other = other ;
   }
 
   work->self = self ;
   work->result = ObjectWrap::Unwrap<WrappedArray>( instance )  ;
 // It seems to be best that we create the result in the caller's context
 // So we do it here
-  work->resultLocal.Reset( isolate, instance ) ;
+  work->resultLocal.Reset( isolate, returned.IsEmpty() ? instance : returned ) ;
   work->selfObj.Reset( isolate, instance ) ;
 
   if( !xtraObj.IsEmpty() ) {
     work->xtraObj.Reset( isolate, xtraObj ) ;
   }
   work->xtraInt = xtraInt ;
+  work->xtraFloat = xtraFloat ;
+  work->xtraPtr = xtraPtr ;
+  work->alpha = alpha ;
 
 // If we have a second arg - it should be a callback
 // So setup the Work struct in Promise or callback mode
@@ -3001,10 +8124,17 @@ void WrappedArray::PrepareWork( const v8::FunctionCallbackInfo<v8::Value>& args,
   if( work->resolver.IsEmpty() && work->callback.IsEmpty() ) {
     work_cb( &work->request ) ;
     WrappedArray::WorkAsyncComplete( &work->request, -1 ) ;
-    args.GetReturnValue().Set( instance ) ;
+    args.GetReturnValue().Set( returned.IsEmpty() ? instance : returned ) ;
   } else {
 // Otherwise create a new thread to do the work & return
 // The proper return value (undefined for callback mode or a promise is already set)
+// The matrices are marked busy, so a scope ending meanwhile leaves their data alone
+// and held, so the GC can't collect them while a thread is using them
+    work->holderObj.Reset( isolate, work->self->handle( isolate ) ) ;
+    if( work->other != NULL ) work->otherObj.Reset( isolate, work->other->handle( isolate ) ) ;
+    work->self->busy_++ ;
+    work->result->busy_++ ;
+    if( work->other != NULL ) work->other->busy_++ ;
     uv_queue_work(uv_default_loop(),&work->request, work_cb, WrappedArray::WorkAsyncComplete ) ;
   }
 }
@@ -3023,6 +8153,16 @@ void WrappedArray::WorkAsyncComplete(uv_work_t *req,int status)
     Isolate *isolate = work->isolate  ;
     HandleScope scope(isolate) ;
 
+    if( work->self->storage_ != NULL ) work->self->storage_->ReportPending() ;
+    if( work->result->storage_ != NULL ) work->result->storage_->ReportPending() ;
+    if( status != -1 ) {	// -1 is a direct (blocking) call, nothing was marked busy
+      work->self->busy_-- ;
+      work->result->busy_-- ;
+      if( work->other != NULL ) work->other->busy_-- ;
+      work->holderObj.Reset() ;
+      work->otherObj.Reset() ;
+    }
+
     if( work->err != NULL ) {
       if( !work->resolver.IsEmpty() ) {
         Local<Promise::Resolver> resolver = Local<Promise::Resolver>::New(isolate,work->resolver) ;
@@ -3035,7 +8175,7 @@ void WrappedArray::WorkAsyncComplete(uv_work_t *req,int status)
       } else {
         isolate->ThrowException(Exception::TypeError( String::NewFromUtf8(isolate, work->err) ) );
       }
-      delete work->err ;
+      delete [] work->err ;
     } else {
     // convert the persistent storage to Local - suitable for a return
       Local<Object> rc = Local<Object>::New(isolate,work->resultLocal) ;
@@ -3069,6 +8209,11 @@ void WrappedArray::WorkAsyncComplete(uv_work_t *req,int status)
 	- m count of rows
 	- n count of columns
 	- length total size of the array MxN
+	- isView true if the array shares data with another
+	- version a number that changes whenever the data (or shape) changes. It
+	  identifies the storage, so a dup() or a view has the same version as its
+	  original until one of them is written
+	- disposed true once dispose() has been called
 */
 void WrappedArray::GetCoeff(Local<String> property, const PropertyCallbackInfo<Value>& info)
 {
@@ -3085,6 +8230,14 @@ void WrappedArray::GetCoeff(Local<String> property, const PropertyCallbackInfo<V
     info.GetReturnValue().Set(Number::New(isolate, self->n_));
   } else if (str == "length") {
     info.GetReturnValue().Set(Number::New(isolate, self->n_*self->m_ ));
+  } else if (str == "disposed") {
+    info.GetReturnValue().Set(Boolean::New(isolate, self->disposed_ ));
+  } else if (str == "version") {
+    info.GetReturnValue().Set(Number::New(isolate, self->storage_ == NULL ? 0 : (double)self->storage_->version ));
+  } else if (str == "isView") {
+    info.GetReturnValue().Set(Boolean::New(isolate, self->isView_ ));
+  } else if (str == "symmetric") {
+    info.GetReturnValue().Set(Boolean::New(isolate, self->IsSymmetric() ));
   } else if (str == "maxPrint") {
     info.GetReturnValue().Set(Number::New(isolate, self->maxPrint_ ));
   } else if (str == "name" && self->name_ != NULL ) {
@@ -3112,7 +8265,7 @@ void WrappedArray::SetCoeff(Local<String> property, Local<Value> value, const Pr
   } else if (str == "name" ) {
     char *c = new char[value->ToString()->Utf8Length()] ;
     value->ToString()->WriteUtf8( c, 32 ) ;
-    delete obj->name_ ;
+    delete [] obj->name_ ;
     obj->name_ = c;
   }
 
@@ -3136,6 +8289,12 @@ void CreateObject(const FunctionCallbackInfo<Value>& info)
 void InitArray(Local<Object> exports, Local<Object> module)
 {
   WrappedArray::Init(exports, module);
+  TypedMatrix<double>::Init(exports, "Array64");
+  QuantizedMatrix::Init(exports);
+  SparseMatrix::Init(exports);
+  LazyMatrix::Init(exports);
+  TransposedMatrix::Init(exports);
+  Factorization::Init(exports);
 }
 
 
@@ -0,0 +1,65 @@
+#ifndef LALG_BLAS_H
+#define LALG_BLAS_H
+
+#include <cblas.h>
+#include <lapacke.h>
+
+/**
+ The BLAS & LAPACK routines used by the matrices, chosen by element type.
+
+ Blas<float> calls the s* routines, Blas<double> the d* ones, so code written
+ against Blas<T> works for either precision. Everything is column major,
+ the same as the matrices. The LAPACK wrappers return the LAPACKE info code:
+ 0 is success, < 0 a bad argument, > 0 a numerical failure (e.g. singular).
+*/
+template<class T> struct Blas ;
+
+template<> struct Blas<float> {
+  static const char Prefix = 's' ;	/**< the letter LAPACK uses for this type - for error messages */
+
+  static void gemm( CBLAS_TRANSPOSE transA, CBLAS_TRANSPOSE transB, int m, int n, int k,
+		float alpha, const float *a, int lda, const float *b, int ldb,
+		float beta, float *c, int ldc ) {
+    cblas_sgemm( CblasColMajor, transA, transB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc ) ;
+  }
+
+  static float asum( int n, const float *x, int incx ) { return cblas_sasum( n, x, incx ) ; }
+  static float nrm2( int n, const float *x, int incx ) { return cblas_snrm2( n, x, incx ) ; }
+
+  static int getrf( int m, int n, float *a, int lda, int *ipiv ) {
+    return LAPACKE_sgetrf( CblasColMajor, m, n, a, lda, ipiv ) ;
+  }
+  static int getri( int n, float *a, int lda, const int *ipiv ) {
+    return LAPACKE_sgetri( CblasColMajor, n, a, lda, ipiv ) ;
+  }
+  static int gesvd( char jobu, char jobvt, int m, int n, float *a, int lda, float *s,
+		float *u, int ldu, float *vt, int ldvt, float *superb ) {
+    return LAPACKE_sgesvd( CblasColMajor, jobu, jobvt, m, n, a, lda, s, u, ldu, vt, ldvt, superb ) ;
+  }
+} ;
+
+template<> struct Blas<double> {
+  static const char Prefix = 'd' ;
+
+  static void gemm( CBLAS_TRANSPOSE transA, CBLAS_TRANSPOSE transB, int m, int n, int k,
+		double alpha, const double *a, int lda, const double *b, int ldb,
+		double beta, double *c, int ldc ) {
+    cblas_dgemm( CblasColMajor, transA, transB, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc ) ;
+  }
+
+  static double asum( int n, const double *x, int incx ) { return cblas_dasum( n, x, incx ) ; }
+  static double nrm2( int n, const double *x, int incx ) { return cblas_dnrm2( n, x, incx ) ; }
+
+  static int getrf( int m, int n, double *a, int lda, int *ipiv ) {
+    return LAPACKE_dgetrf( CblasColMajor, m, n, a, lda, ipiv ) ;
+  }
+  static int getri( int n, double *a, int lda, const int *ipiv ) {
+    return LAPACKE_dgetri( CblasColMajor, n, a, lda, ipiv ) ;
+  }
+  static int gesvd( char jobu, char jobvt, int m, int n, double *a, int lda, double *s,
+		double *u, int ldu, double *vt, int ldvt, double *superb ) {
+    return LAPACKE_dgesvd( CblasColMajor, jobu, jobvt, m, n, a, lda, s, u, ldu, vt, ldvt, superb ) ;
+  }
+} ;
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef LALG_BUFFER_POOL_H
+#define LALG_BUFFER_POOL_H
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/**
+ A pool of 64 byte aligned float buffers, used for the data of every matrix.
+
+ Requests are rounded up to a size class and freed buffers are kept on a
+ free list for that class, so a loop that keeps creating and dropping the
+ same shaped temporaries reuses memory instead of going to the allocator.
+ Size classes are powers of two, each split into 4 steps, which caps the
+ wasted space at 25%.
+
+ The pool is shared by the main thread and the uv worker threads, all
+ access to the free lists is guarded by a single mutex. The total number of
+ bytes sitting on the free lists is limited, anything freed over that
+ limit goes straight back to the system.
+*/
+class BufferPool
+{
+  public:
+    static const size_t Alignment = 64 ;	/**< byte alignment of every buffer - a cache line, good for AVX-512 */
+
+    /**
+	The pool statistics, as reported to javascript
+    */
+    struct Stats {
+      size_t hits ;	/**< allocations satisfied from a free list */
+      size_t misses ;	/**< allocations that went to the system */
+      size_t cached ;	/**< bytes currently held on the free lists */
+      size_t buffers ;	/**< number of buffers currently held on the free lists */
+      size_t limit ;	/**< the max bytes allowed on the free lists */
+    } ;
+
+    static BufferPool &Instance() {
+      static BufferPool pool ;
+      return pool ;
+    }
+
+    /**
+	Allocate a buffer big enough for count floats. The actual number
+	of floats available is returned in capacity - it's always >= count.
+	A zero count returns NULL.
+    */
+    float *Alloc( size_t count, size_t &capacity ) {
+      capacity = 0 ;
+      if( count == 0 ) return NULL ;
+
+      int sc = SizeClass( count * sizeof(float) ) ;
+      size_t bytes = ClassBytes( sc ) ;
+      capacity = bytes / sizeof(float) ;
+
+      {
+        std::lock_guard<std::mutex> guard( lock_ ) ;
+        std::vector<void*> &list = free_[sc] ;
+        if( !list.empty() ) {
+          void *p = list.back() ;
+          list.pop_back() ;
+          cached_ -= bytes ;
+          hits_++ ;
+          return (float*)p ;
+        }
+        misses_++ ;
+      }
+
+      void *p = NULL ;
+      if( posix_memalign( &p, Alignment, bytes ) != 0 ) {
+        throw std::bad_alloc() ;
+      }
+      return (float*)p ;
+    }
+
+    /**
+	Return a buffer to the pool. The capacity must be the one
+	returned from Alloc.
+    */
+    void Free( float *data, size_t capacity ) {
+      if( data == NULL ) return ;
+
+      int sc = SizeClass( capacity * sizeof(float) ) ;
+      size_t bytes = ClassBytes( sc ) ;
+      {
+        std::lock_guard<std::mutex> guard( lock_ ) ;
+        if( cached_ + bytes <= limit_ ) {
+          free_[sc].push_back( data ) ;
+          cached_ += bytes ;
+          return ;
+        }
+      }
+      ::free( data ) ;
+    }
+
+    /**
+	Set the max number of bytes kept on the free lists. Any excess
+	is released immediately, largest buffers first.
+	@return the previous limit
+    */
+    size_t SetLimit( size_t bytes ) {
+      std::vector<void*> toFree ;
+      size_t old ;
+      {
+        std::lock_guard<std::mutex> guard( lock_ ) ;
+        old = limit_ ;
+        limit_ = bytes ;
+        for( int sc=NumClasses-1 ; sc>=0 && cached_>limit_ ; sc-- ) {
+          std::vector<void*> &list = free_[sc] ;
+          while( !list.empty() && cached_>limit_ ) {
+            toFree.push_back( list.back() ) ;
+            list.pop_back() ;
+            cached_ -= ClassBytes( sc ) ;
+          }
+        }
+      }
+      for( size_t i=0 ; i<toFree.size() ; i++ ) {
+        ::free( toFree[i] ) ;
+      }
+      return old ;
+    }
+
+    Stats GetStats() {
+      std::lock_guard<std::mutex> guard( lock_ ) ;
+      Stats rc ;
+      rc.hits = hits_ ;
+      rc.misses = misses_ ;
+      rc.cached = cached_ ;
+      rc.limit = limit_ ;
+      rc.buffers = 0 ;
+      for( int sc=0 ; sc<NumClasses ; sc++ ) {
+        rc.buffers += free_[sc].size() ;
+      }
+      return rc ;
+    }
+
+  private:
+    static const int NumClasses = 1 + 4 * 42 ;	/**< 64 bytes up to 2^48 bytes */
+
+    BufferPool() : cached_(0), limit_(128*1024*1024), hits_(0), misses_(0) {}
+
+    ~BufferPool() {
+      for( int sc=0 ; sc<NumClasses ; sc++ ) {
+        for( size_t i=0 ; i<free_[sc].size() ; i++ ) {
+          ::free( free_[sc][i] ) ;
+        }
+      }
+    }
+
+    BufferPool( const BufferPool & ) ;
+    BufferPool &operator=( const BufferPool & ) ;
+
+    /*
+	Class 0 is 64 bytes, after that each power of two 2^p (p>=6)
+	is split into 4 steps: 2^p * 5/4, 6/4, 7/4 and 8/4
+    */
+    static int SizeClass( size_t bytes ) {
+      if( bytes <= 64 ) return 0 ;
+      int p = 6 ;
+      while( p<47 && ((size_t)1<<(p+1)) < bytes ) p++ ;
+      size_t base = (size_t)1 << p ;
+      size_t step = base >> 2 ;
+      int k = (int)( ( bytes - base + step - 1 ) / step ) ;	// 1..4
+      return 1 + 4*(p-6) + (k-1) ;
+    }
+
+    static size_t ClassBytes( int sc ) {
+      if( sc == 0 ) return 64 ;
+      int p = 6 + (sc-1) / 4 ;
+      int k = 1 + (sc-1) % 4 ;
+      size_t base = (size_t)1 << p ;
+      return base + k * (base>>2) ;
+    }
+
+    std::mutex lock_ ;
+    std::vector<void*> free_[NumClasses] ;
+    size_t cached_ ;
+    size_t limit_ ;
+    size_t hits_ ;
+    size_t misses_ ;
+} ;
+
+#endif
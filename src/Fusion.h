@@ -0,0 +1,452 @@
+#ifndef LALG_FUSION_H
+#define LALG_FUSION_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <cmath>
+#include <stdlib.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Simd.h"
+#include "ThreadPool.h"
+
+/**
+ A chain of element wise operations compiled into one pass over memory.
+
+ The program is postfix ( reverse polish ) code for a little stack
+ machine: Input & Constant push a value, the operators pop their operands
+ and push the answer. e.g. log( A - b ) .* C + 1 is
+
+   Input 0, Input 1, Sub, Log, Input 2, Mul, Constant 1, Add
+
+ Run() doesn't work out each operator over the whole matrix in turn - that's
+ a full pass through memory, and a new matrix, per operator. It runs the
+ whole program over a tile of a few hundred rows at a time, so each input
+ element is read once, the answer is written once and everything in
+ between stays in L1. The operators on a tile are the SIMD kernels, and
+ the tiles are spread over the thread pool.
+
+ Inputs can be the same shape as the result, a row vector ( 1xN, one value
+ per column - applied to each row ) or a column vector ( Mx1, applied to
+ each column ), the same broadcasts as add & co.
+
+ Parse() compiles a text expression into a program, e.g. "log( a*b + 1 )".
+
+ This is plain C++, it's safe to Run() off the main thread.
+*/
+class FusedProgram
+{
+  public:
+    enum Code {
+      Input,		/**< push input arg */
+      Constant,		/**< push value */
+      Add, Sub, Mul, Div, Pow, Min, Max,	/**< pop b, pop a, push a op b */
+      Neg, Abs, Sqrt, Log, Exp, Square, Tanh, Sigmoid, Relu, Softplus	/**< pop a, push f( a ) */
+    } ;
+
+    struct Instr {
+      Code code ;
+      int arg ;		/**< the input number, for Input */
+      float value ;	/**< the number, for Constant */
+    } ;
+
+    /** how an input lines up with the MxN result - Scalar is one number for everything */
+    enum Shape { Full, Row, Column, Scalar } ;
+
+    /** an input's data, at the time of a Run() */
+    struct Source {
+      const float *data ;
+      int ld ;
+      Shape shape ;
+    } ;
+
+    static const int Tile = 512 ;	/**< the rows in a tile - 2K per stack slot */
+
+    FusedProgram() : inputs_(0) {}
+
+    /** the number of inputs used, one more than the biggest Input arg */
+    int Inputs() const { return inputs_ ; }
+    const std::vector<Instr> &Instructions() const { return code_ ; }
+
+    void PushInput( int arg ) {
+      Instr i = { Input, arg, 0.f } ;
+      code_.push_back( i ) ;
+      inputs_ = std::max( inputs_, arg+1 ) ;
+    }
+
+    void PushConstant( float value ) {
+      Instr i = { Constant, 0, value } ;
+      code_.push_back( i ) ;
+    }
+
+    /** push an operator */
+    void Push( enum Code code ) {
+      Instr i = { code, 0, 0.f } ;
+      code_.push_back( i ) ;
+    }
+
+    /**
+	Append another program's code, its input i becomes input
+	inputMap[i] here. Used to build a op b from a's & b's programs.
+    */
+    void Append( const FusedProgram &other, const std::vector<int> &inputMap ) {
+      for( size_t i=0 ; i<other.code_.size() ; i++ ) {
+        Instr instr = other.code_[i] ;
+        if( instr.code == Input ) {
+          instr.arg = inputMap[ instr.arg ] ;
+          inputs_ = std::max( inputs_, instr.arg+1 ) ;
+        }
+        code_.push_back( instr ) ;
+      }
+    }
+
+    static bool IsBinary( enum Code code ) { return code >= Add && code <= Max ; }
+
+    /**
+	The most values on the stack at once
+	@return the depth, or -1 if the code pops an empty stack or doesn't
+	finish with exactly one value
+    */
+    int Depth() const {
+      int depth = 0 ;
+      int most = 0 ;
+      for( size_t i=0 ; i<code_.size() ; i++ ) {
+        enum Code code = code_[i].code ;
+        if( code == Input || code == Constant ) {
+          depth++ ;
+        } else if( IsBinary( code ) ) {
+          if( depth < 2 ) return -1 ;
+          depth-- ;
+        } else if( depth < 1 ) {
+          return -1 ;
+        }
+        most = std::max( most, depth ) ;
+      }
+      return depth == 1 ? most : -1 ;
+    }
+
+    /**
+	Run the program, writing the MxN answer into out ( leading
+	dimension ldo ). sources has an entry for each input. out may be
+	one of the inputs. The program must be valid - Depth() > 0.
+    */
+    void Run( const std::vector<Source> &sources, int m, int n, float *out, int ldo ) const {
+      if( m <= 0 || n <= 0 ) return ;
+
+      // if everything is packed the columns run on from each other, so treat it as one long column
+      bool packed = ldo == m || n == 1 ;
+      for( size_t i=0 ; i<sources.size() && packed ; i++ ) {
+        packed = sources[i].shape == Scalar || ( sources[i].shape == Full && ( sources[i].ld == m || n == 1 ) ) ;
+      }
+      if( packed ) {
+        m = m * n ;
+        n = 1 ;
+      }
+
+      const int depth = Depth() ;
+      const size_t tiles = ( m + Tile - 1 ) / Tile ;
+      ThreadPool::Instance().Ranges( tiles * n, std::min( m, (int)Tile ), [&]( size_t, size_t begin, size_t end ) {
+        std::vector<float> scratch( (size_t)depth * Tile ) ;
+        std::vector<Slot> stack( depth ) ;
+        for( int s=0 ; s<depth ; s++ ) stack[s].buf = &scratch[ (size_t)s * Tile ] ;
+        for( size_t u=begin ; u<end ; u++ ) {
+          int c = (int)( u / tiles ) ;
+          int r0 = (int)( u % tiles ) * Tile ;
+          RunTile( sources, c, r0, std::min( (int)Tile, m - r0 ), stack, out + (size_t)c*ldo + r0 ) ;
+        }
+      } ) ;
+    }
+
+    /**
+	Compile an expression into program. The variables a, b, c ... are
+	inputs 0, 1, 2 ... 
+
+	- numbers: 2, 0.5, 1e-3
+	- operators: + - * / and ^ ( power ), with the usual precedence,
+	  ^ binds tightest and to the right, -a^2 is -(a^2)
+	- functions: exp log sqrt abs tanh sigmoid relu softplus, pow(x,y)
+	  min(x,y) max(x,y) and clip(x,lo,hi)
+
+	@return an empty string if all is well, otherwise what's wrong and where
+    */
+    static std::string Parse( const char *text, FusedProgram &program ) {
+      Parser parser( text, program ) ;
+      parser.Expr() ;
+      parser.Skip() ;
+      if( parser.error.empty() && *parser.p != 0 ) parser.Fail( "unexpected character" ) ;
+      if( parser.error.empty() && program.Depth() < 1 ) parser.Fail( "incomplete expression" ) ;
+      return parser.error ;
+    }
+
+  private:
+    /* a recursive descent parser, each rule appends its code to the program */
+    struct Parser {
+      const char *text ;
+      const char *p ;
+      FusedProgram &program ;
+      std::string error ;
+
+      Parser( const char *t, FusedProgram &prog ) : text( t ), p( t ), program( prog ) {}
+
+      void Fail( const char *what ) {
+        if( !error.empty() ) return ;
+        char buf[ 200 ] ;
+        snprintf( buf, sizeof(buf), "%s at position %d of '%s'", what, (int)( p - text ), text ) ;
+        error = buf ;
+      }
+
+      void Skip() { while( isspace( (unsigned char)*p ) ) p++ ; }
+
+      bool Accept( char c ) {
+        Skip() ;
+        if( *p != c ) return false ;
+        p++ ;
+        return true ;
+      }
+
+      void Expect( char c ) {
+        if( !Accept( c ) ) {
+          char what[ 30 ] ;
+          snprintf( what, sizeof(what), "expected '%c'", c ) ;
+          Fail( what ) ;
+        }
+      }
+
+      // expr := term { ( + | - ) term }
+      void Expr() {
+        Term() ;
+        while( error.empty() ) {
+          if( Accept( '+' ) ) { Term() ; program.Push( Add ) ; }
+          else if( Accept( '-' ) ) { Term() ; program.Push( Sub ) ; }
+          else break ;
+        }
+      }
+
+      // term := unary { ( * | / ) unary }
+      void Term() {
+        Unary() ;
+        while( error.empty() ) {
+          if( Accept( '*' ) ) { Unary() ; program.Push( Mul ) ; }
+          else if( Accept( '/' ) ) { Unary() ; program.Push( Div ) ; }
+          else break ;
+        }
+      }
+
+      // unary := - unary | power
+      void Unary() {
+        if( Accept( '-' ) ) {
+          Unary() ;
+          program.Push( Neg ) ;
+        } else {
+          Power() ;
+        }
+      }
+
+      // power := primary [ ^ unary ] - x^2 is done as x*x, x^0.5 as sqrt
+      void Power() {
+        Primary() ;
+        if( !Accept( '^' ) ) return ;
+        Unary() ;
+        PowerOf() ;
+      }
+
+      /* the power has been pushed, a constant 2 or 0.5 has a quicker way */
+      void PowerOf() {
+        std::vector<Instr> &code = program.code_ ;
+        if( !code.empty() && code.back().code == Constant && ( code.back().value == 2.f || code.back().value == 0.5f ) ) {
+          float y = code.back().value ;
+          code.pop_back() ;
+          program.Push( y == 2.f ? Square : Sqrt ) ;
+        } else {
+          program.Push( Pow ) ;
+        }
+      }
+
+      // primary := number | variable | function ( args ) | ( expr )
+      void Primary() {
+        Skip() ;
+        if( !error.empty() ) return ;
+        if( isdigit( (unsigned char)*p ) || *p == '.' ) {
+          char *end ;
+          float value = strtof( p, &end ) ;
+          if( end == p ) { Fail( "bad number" ) ; return ; }
+          p = end ;
+          program.PushConstant( value ) ;
+        } else if( isalpha( (unsigned char)*p ) ) {
+          const char *start = p ;
+          while( isalnum( (unsigned char)*p ) ) p++ ;
+          std::string name( start, p - start ) ;
+          if( name.size() == 1 && islower( (unsigned char)name[0] ) ) {
+            program.PushInput( name[0] - 'a' ) ;
+          } else {
+            Function( name, start ) ;
+          }
+        } else if( Accept( '(' ) ) {
+          Expr() ;
+          Expect( ')' ) ;
+        } else {
+          Fail( *p == 0 ? "unexpected end" : "unexpected character" ) ;
+        }
+      }
+
+      void Function( const std::string &name, const char *start ) {
+        static const struct { const char *name ; Code code ; } unary[] = {
+          { "exp", Exp }, { "log", Log }, { "sqrt", Sqrt }, { "abs", Abs }, { "tanh", Tanh }, { "sigmoid", Sigmoid },
+          { "relu", Relu }, { "softplus", Softplus }
+        } ;
+        for( size_t i=0 ; i<sizeof(unary)/sizeof(unary[0]) ; i++ ) {
+          if( name == unary[i].name ) {
+            Expect( '(' ) ; Expr() ; Expect( ')' ) ;
+            program.Push( unary[i].code ) ;
+            return ;
+          }
+        }
+        if( name == "pow" || name == "min" || name == "max" ) {
+          Expect( '(' ) ; Expr() ; Expect( ',' ) ; Expr() ; Expect( ')' ) ;
+          if( name == "pow" ) PowerOf() ;
+          else program.Push( name == "min" ? Min : Max ) ;
+        } else if( name == "clip" ) {	// clip( x, lo, hi ) = min( max( x, lo ), hi )
+          Expect( '(' ) ; Expr() ; Expect( ',' ) ; Expr() ;
+          program.Push( Max ) ;
+          Expect( ',' ) ; Expr() ; Expect( ')' ) ;
+          program.Push( Min ) ;
+        } else {
+          p = start ;
+          Fail( ( "unknown function '" + name + "'" ).c_str() ) ;
+        }
+      }
+    } ;
+
+    /*
+	A stack value for one tile: either len numbers at p ( which is an
+	input's own data or buf ) or a single number - from a Constant or a
+	row vector - that applies to the whole tile.
+    */
+    struct Slot {
+      const float *p ;
+      float x ;
+      bool scalar ;
+      float *buf ;	/**< this slot's own Tile floats */
+    } ;
+
+    void RunTile( const std::vector<Source> &sources, int c, int r0, int len, std::vector<Slot> &stack, float *out ) const {
+      const SimdKernels &k = Simd::Kernels() ;
+      int sp = 0 ;
+      for( size_t i=0 ; i<code_.size() ; i++ ) {
+        const Instr &instr = code_[i] ;
+        switch( instr.code ) {
+          case Input : {
+            const Source &src = sources[instr.arg] ;
+            Slot &s = stack[sp++] ;
+            s.scalar = src.shape == Row || src.shape == Scalar ;
+            if( src.shape == Scalar ) s.x = src.data[0] ;
+            else if( src.shape == Row ) s.x = src.data[ (size_t)c*src.ld ] ;
+            else if( src.shape == Column ) s.p = src.data + r0 ;
+            else s.p = src.data + (size_t)c*src.ld + r0 ;
+            break ;
+          }
+          case Constant : {
+            Slot &s = stack[sp++] ;
+            s.scalar = true ;
+            s.x = instr.value ;
+            break ;
+          }
+          default :
+            if( IsBinary( instr.code ) ) {
+              Binary( k, instr.code, stack[sp-2], stack[sp-1], len ) ;
+              sp-- ;
+            } else {
+              Unary( k, instr.code, stack[sp-1], len ) ;
+            }
+            break ;
+        }
+      }
+      const Slot &top = stack[0] ;
+      if( top.scalar ) std::fill( out, out+len, top.x ) ;
+      else if( top.p != out ) memmove( out, top.p, len * sizeof(float) ) ;
+    }
+
+    /* a = a op b, b's buffer is free to use */
+    static void Binary( const SimdKernels &k, enum Code code, Slot &a, Slot &b, int len ) {
+      if( a.scalar && b.scalar ) {
+        a.x = Apply( code, a.x, b.x ) ;
+        return ;
+      }
+      if( code == Add || code == Sub || code == Mul ) {	// these have kernels for a number
+        if( b.scalar ) {
+          ( code == Add ? k.addScalar : code == Sub ? k.subScalar : k.mulScalar )( a.p, b.x, a.buf, len ) ;
+        } else if( a.scalar && code == Sub ) {	// x - b == -b + x
+          k.neg( b.p, a.buf, len ) ;
+          k.addScalar( a.buf, a.x, a.buf, len ) ;
+        } else if( a.scalar ) {
+          ( code == Add ? k.addScalar : k.mulScalar )( b.p, a.x, a.buf, len ) ;
+        } else {
+          ( code == Add ? k.add : code == Sub ? k.sub : k.mul )( a.p, b.p, a.buf, len ) ;
+        }
+      } else {		// the others spread a number over a tile first
+        if( a.scalar ) {
+          std::fill( a.buf, a.buf+len, a.x ) ;
+          a.p = a.buf ;
+        }
+        if( b.scalar ) {
+          std::fill( b.buf, b.buf+len, b.x ) ;
+          b.p = b.buf ;
+        }
+        ( code == Div ? k.div : code == Pow ? k.pow : code == Min ? k.min : k.max )( a.p, b.p, a.buf, len ) ;
+      }
+      a.p = a.buf ;
+      a.scalar = false ;
+    }
+
+    /* a = f( a ) */
+    static void Unary( const SimdKernels &k, enum Code code, Slot &a, int len ) {
+      if( a.scalar ) {
+        a.x = Apply( code, a.x ) ;
+        return ;
+      }
+      if( code == Square ) {
+        k.mul( a.p, a.p, a.buf, len ) ;
+      } else {
+        ( code == Neg ? k.neg : code == Abs ? k.abs : code == Sqrt ? k.sqrt : code == Log ? k.log :
+          code == Exp ? k.exp : code == Tanh ? k.tanh : code == Sigmoid ? k.sigmoid :
+          code == Relu ? k.relu : k.softplus )( a.p, a.buf, len ) ;
+      }
+      a.p = a.buf ;
+    }
+
+    /* the operators on single numbers, the same as the plain C++ kernels */
+    static float Apply( enum Code code, float x, float y ) {
+      switch( code ) {
+        case Add : return x + y ;
+        case Sub : return x - y ;
+        case Mul : return x * y ;
+        case Div : return x / y ;
+        case Pow : return std::pow( x, y ) ;
+        case Min : return x < y ? x : y ;
+        default : return x > y ? x : y ;
+      }
+    }
+    static float Apply( enum Code code, float x ) {
+      switch( code ) {
+        case Neg : return -x ;
+        case Abs : return std::fabs( x ) ;
+        case Sqrt : return std::sqrt( x ) ;
+        case Log : return std::log( x ) ;
+        case Exp : return std::exp( x ) ;
+        case Square : return x * x ;
+        case Tanh : return std::tanh( x ) ;
+        case Sigmoid : return 1.f / ( 1.f + std::exp( -x ) ) ;
+        case Relu : return x < 0.f ? 0.f : x ;
+        default : return ( x > 0.f ? x : 0.f ) + std::log1p( std::exp( -std::fabs( x ) ) ) ;
+      }
+    }
+
+    std::vector<Instr> code_ ;
+    int inputs_ ;
+} ;
+
+#endif
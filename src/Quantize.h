@@ -0,0 +1,241 @@
+#ifndef LALG_QUANTIZE_H
+#define LALG_QUANTIZE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <cblas.h>
+
+/**
+ Compact storage for matrices that are read far more than they're written,
+ e.g. the weights of a model being served. Multiplying by a big weight
+ matrix is limited by how fast it can be read from memory, so storing
+ each element in 2 bytes ( bf16 or fp16 ) or 1 byte ( int8 ) instead of
+ 4 makes the multiply faster.
+
+ - bf16 is the top half of a float, same range, 8 bits of precision
+ - fp16 is IEEE half precision, range +/- 65504, 11 bits of precision
+ - int8 is a signed byte per element and a float scale per column, the
+   largest value in each column maps to +/- 127
+
+ Data is column major and packed. The multiplies never widen the whole
+ matrix, they convert a panel of columns at a time to floats ( sized to
+ stay in cache ) and hand that to sgemm, so the sums are done in float.
+*/
+class Quantizer
+{
+  public:
+    enum Type { Bf16, Fp16, Int8 } ;
+
+    static const size_t PanelFloats = 64 * 1024 ;	/**< the size of a widened panel - 256K, about L2 sized */
+
+    /** bytes used by one element */
+    static size_t ElementBytes( Type type ) {
+      return type == Int8 ? 1 : 2 ;
+    }
+
+    static const char *Name( Type type ) {
+      return type == Bf16 ? "bf16" : type == Fp16 ? "fp16" : "int8" ;
+    }
+
+    /**
+	Parse a type name
+	@return false if the name isn't one of bf16, fp16 or int8
+    */
+    static bool Parse( const char *name, Type &type ) {
+      if( strcmp( name, "bf16" ) == 0 ) type = Bf16 ;
+      else if( strcmp( name, "fp16" ) == 0 ) type = Fp16 ;
+      else if( strcmp( name, "int8" ) == 0 ) type = Int8 ;
+      else return false ;
+      return true ;
+    }
+
+    /* float -> bf16, rounding to nearest even */
+    static uint16_t ToBf16( float f ) {
+      uint32_t x ;
+      memcpy( &x, &f, sizeof(x) ) ;
+      if( ( x & 0x7fffffff ) > 0x7f800000 ) return (uint16_t)( ( x >> 16 ) | 0x40 ) ;	// keep NaN a NaN
+      x += 0x7fff + ( ( x >> 16 ) & 1 ) ;
+      return (uint16_t)( x >> 16 ) ;
+    }
+
+    static float FromBf16( uint16_t h ) {
+      uint32_t x = (uint32_t)h << 16 ;
+      float f ;
+      memcpy( &f, &x, sizeof(f) ) ;
+      return f ;
+    }
+
+    /* float -> IEEE half, rounding to nearest even. Too big becomes infinity */
+    static uint16_t ToFp16( float f ) {
+      uint32_t x ;
+      memcpy( &x, &f, sizeof(x) ) ;
+      uint32_t sign = ( x >> 16 ) & 0x8000 ;
+      uint32_t absx = x & 0x7fffffff ;
+      if( absx >= 0x7f800000 ) return (uint16_t)( sign | ( absx > 0x7f800000 ? 0x7e00 : 0x7c00 ) ) ;
+      if( absx >= 0x477ff000 ) return (uint16_t)( sign | 0x7c00 ) ;	// >= 65520 rounds to infinity
+      if( absx < 0x38800000 ) {	// below 2^-14 - a half subnormal ( or 0 )
+        if( absx < 0x33000000 ) return (uint16_t)sign ;
+        uint32_t mant = ( absx & 0x7fffff ) | 0x800000 ;
+        int shift = 126 - (int)( absx >> 23 ) ;
+        uint32_t h = mant >> shift ;
+        uint32_t rem = mant & ( ( 1u << shift ) - 1 ) ;
+        uint32_t half = 1u << ( shift - 1 ) ;
+        if( rem > half || ( rem == half && ( h & 1 ) ) ) h++ ;
+        return (uint16_t)( sign | h ) ;
+      }
+      uint32_t h = ( absx - 0x38000000 ) >> 13 ;	// rebias the exponent from 127 to 15
+      uint32_t rem = absx & 0x1fff ;
+      if( rem > 0x1000 || ( rem == 0x1000 && ( h & 1 ) ) ) h++ ;
+      return (uint16_t)( sign | h ) ;
+    }
+
+    static float FromFp16( uint16_t h ) {
+      uint32_t sign = (uint32_t)( h & 0x8000 ) << 16 ;
+      uint32_t e = ( h >> 10 ) & 0x1f ;
+      uint32_t mant = h & 0x3ff ;
+      uint32_t x ;
+      if( e == 0 ) {
+        if( mant == 0 ) {
+          x = sign ;
+        } else {	// subnormal - normalize it
+          e = 113 ;
+          while( ( mant & 0x400 ) == 0 ) {
+            mant <<= 1 ;
+            e-- ;
+          }
+          x = sign | ( e << 23 ) | ( ( mant & 0x3ff ) << 13 ) ;
+        }
+      } else if( e == 31 ) {
+        x = sign | 0x7f800000 | ( mant << 13 ) ;
+      } else {
+        x = sign | ( ( e + 112 ) << 23 ) | ( mant << 13 ) ;
+      }
+      float f ;
+      memcpy( &f, &x, sizeof(f) ) ;
+      return f ;
+    }
+
+    /**
+	Convert an m x n float matrix ( leading dimension ld ) to the compact
+	form. dst needs m*n*ElementBytes(type) bytes, scales needs n floats
+	for Int8 ( it isn't used for the other types ). An int8 column is
+	scaled by its largest finite value, infinities saturate to +/- 127
+	and NaN becomes 0 - a byte has no room for them.
+    */
+    static void Encode( Type type, const float *src, int m, int n, int ld, void *dst, float *scales ) {
+      for( int c=0 ; c<n ; c++ ) {
+        const float *a = src + (size_t)c*ld ;
+        if( type == Bf16 ) {
+          uint16_t *d = (uint16_t*)dst + (size_t)c*m ;
+          for( int r=0 ; r<m ; r++ ) d[r] = ToBf16( a[r] ) ;
+        } else if( type == Fp16 ) {
+          uint16_t *d = (uint16_t*)dst + (size_t)c*m ;
+          for( int r=0 ; r<m ; r++ ) d[r] = ToFp16( a[r] ) ;
+        } else {
+          int8_t *d = (int8_t*)dst + (size_t)c*m ;
+          float mx = 0.f ;
+          for( int r=0 ; r<m ; r++ ) {
+            if( std::isfinite( a[r] ) && std::fabs( a[r] ) > mx ) mx = std::fabs( a[r] ) ;
+          }
+          scales[c] = mx / 127.f ;
+          float inv = mx > 0.f ? 127.f / mx : 0.f ;
+          for( int r=0 ; r<m ; r++ ) {
+            if( std::isnan( a[r] ) ) {
+              d[r] = 0 ;
+            } else if( std::isinf( a[r] ) ) {
+              d[r] = a[r] > 0 ? 127 : -127 ;
+            } else {
+              float q = std::nearbyint( a[r] * inv ) ;
+              d[r] = (int8_t)( q > 127.f ? 127 : q < -127.f ? -127 : q ) ;
+            }
+          }
+        }
+      }
+    }
+
+    /**
+	Widen cols columns, starting at column c0, of an m row compact matrix
+	into floats. dst has a leading dimension of ldd.
+    */
+    static void Decode( Type type, const void *src, const float *scales, int m, int c0, int cols, float *dst, int ldd ) {
+      for( int c=c0 ; c<c0+cols ; c++ ) {
+        float *d = dst + (size_t)( c - c0 ) * ldd ;
+        if( type == Bf16 ) {
+          const uint16_t *s = (const uint16_t*)src + (size_t)c*m ;
+          for( int r=0 ; r<m ; r++ ) d[r] = FromBf16( s[r] ) ;
+        } else if( type == Fp16 ) {
+          const uint16_t *s = (const uint16_t*)src + (size_t)c*m ;
+          for( int r=0 ; r<m ; r++ ) d[r] = FromFp16( s[r] ) ;
+        } else {
+          const int8_t *s = (const int8_t*)src + (size_t)c*m ;
+          const float scale = scales[c] ;
+          for( int r=0 ; r<m ; r++ ) d[r] = s[r] * scale ;
+        }
+      }
+    }
+
+    /**
+	C = Q x B + beta C. Q is an m x k compact matrix, B is k x n floats
+	and C is m x n floats. Q is widened a panel of columns at a time, and
+	each panel times the matching rows of B is added into C.
+    */
+    static void MulRight( Type type, const void *q, const float *scales, int m, int k,
+			const float *b, int ldb, int n, float beta, float *c, int ldc ) {
+      if( k == 0 ) {
+        Scale( beta, c, m, n, ldc ) ;
+        return ;
+      }
+      int panelCols = PanelColumns( m ) ;
+      std::vector<float> panel( (size_t)std::max( 1, m ) * panelCols ) ;
+      for( int p0=0 ; p0<k ; p0+=panelCols ) {
+        int pc = std::min( panelCols, k - p0 ) ;
+        Decode( type, q, scales, m, p0, pc, &panel[0], std::max( 1, m ) ) ;
+        cblas_sgemm( CblasColMajor, CblasNoTrans, CblasNoTrans, m, n, pc,
+		1.f, &panel[0], std::max( 1, m ), b + p0, ldb,
+		p0 == 0 ? beta : 1.f, c, ldc ) ;
+      }
+    }
+
+    /**
+	C = A x Q + beta C. A is m x k floats, Q is a k x n compact matrix and
+	C is m x n floats. Q is widened a panel of columns at a time, each
+	panel gives the matching columns of C.
+    */
+    static void MulLeft( Type type, const void *q, const float *scales, int k, int n,
+			const float *a, int lda, int m, float beta, float *c, int ldc ) {
+      if( k == 0 ) {
+        Scale( beta, c, m, n, ldc ) ;
+        return ;
+      }
+      int panelCols = PanelColumns( k ) ;
+      std::vector<float> panel( (size_t)k * panelCols ) ;
+      for( int j0=0 ; j0<n ; j0+=panelCols ) {
+        int jc = std::min( panelCols, n - j0 ) ;
+        Decode( type, q, scales, k, j0, jc, &panel[0], k ) ;
+        cblas_sgemm( CblasColMajor, CblasNoTrans, CblasNoTrans, m, jc, k,
+		1.f, a, lda, &panel[0], k,
+		beta, c + (size_t)j0*ldc, ldc ) ;
+      }
+    }
+
+  private:
+    /* how many columns of rows floats fit in a panel - at least one */
+    static int PanelColumns( int rows ) {
+      return (int)std::max( (size_t)1, PanelFloats / std::max( 1, rows ) ) ;
+    }
+
+    /* C = beta C, for an empty multiply */
+    static void Scale( float beta, float *c, int m, int n, int ldc ) {
+      for( int j=0 ; j<n ; j++ ) {
+        for( int i=0 ; i<m ; i++ ) {
+          c[ i + (size_t)j*ldc ] = beta == 0.f ? 0.f : beta * c[ i + (size_t)j*ldc ] ;
+        }
+      }
+    }
+} ;
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef LALG_SIMD_H
+#define LALG_SIMD_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && defined(__GNUC__)
+#define LALG_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ The element wise kernels - add, sub, hadamard, divide, min, max, pow,
+ neg, abs, sqrt, log, exp, tanh, sigmoid, relu, softplus and the find
+ family - over contiguous runs of floats. Also the tile kernel used by
+ transposes ( @see Transpose.h ) and the sums & moments behind the
+ reductions.
+
+ There's a version of each kernel for SSE2, AVX2 (+FMA) and AVX-512F, as
+ well as plain C++. The best one the CPU supports is picked the first time
+ Kernels() is called. Setting the environment variable LALG_SIMD to
+ scalar, sse2 or avx2 caps the choice, e.g. to compare results.
+
+ log, exp and tanh are vectorized with the Cephes single precision
+ polynomials, they're within a couple of ulp of the C library. pow is
+ exp( y log|x| ) with the sign & special cases fixed up, so its error
+ grows with |y log x|.
+
+ All kernels allow the output to be the same as an input (in place) and
+ are safe to call from any thread.
+*/
+struct SimdKernels {
+  const char *name ;	/**< scalar, sse2, avx2 or avx512 */
+
+  void (*add)( const float *a, const float *b, float *c, size_t n ) ;	/**< c = a + b */
+  void (*sub)( const float *a, const float *b, float *c, size_t n ) ;	/**< c = a - b */
+  void (*mul)( const float *a, const float *b, float *c, size_t n ) ;	/**< c = a .* b */
+
+  void (*addScalar)( const float *a, float x, float *c, size_t n ) ;	/**< c = a + x */
+  void (*subScalar)( const float *a, float x, float *c, size_t n ) ;	/**< c = a - x */
+  void (*mulScalar)( const float *a, float x, float *c, size_t n ) ;	/**< c = a * x */
+
+  void (*neg)( const float *a, float *c, size_t n ) ;
+  void (*abs)( const float *a, float *c, size_t n ) ;
+  void (*sqrt)( const float *a, float *c, size_t n ) ;
+  void (*log)( const float *a, float *c, size_t n ) ;
+  void (*exp)( const float *a, float *c, size_t n ) ;
+
+  /** c = |a-x| < eps ? ( keep ? a : v ) : 0 */
+  void (*findNear)( const float *a, float x, float eps, float v, bool keep, float *c, size_t n ) ;
+  /** c = a > x ? ( keep ? a : v ) : 0 */
+  void (*findGreater)( const float *a, float x, float v, bool keep, float *c, size_t n ) ;
+  /** c = a <= x ? ( keep ? a : v ) : 0 */
+  void (*findLessEqual)( const float *a, float x, float v, bool keep, float *c, size_t n ) ;
+
+  void (*div)( const float *a, const float *b, float *c, size_t n ) ;	/**< c = a ./ b */
+  void (*min)( const float *a, const float *b, float *c, size_t n ) ;	/**< c = a < b ? a : b */
+  void (*max)( const float *a, const float *b, float *c, size_t n ) ;	/**< c = a > b ? a : b */
+  void (*pow)( const float *a, const float *b, float *c, size_t n ) ;	/**< c = a ^ b */
+  void (*tanh)( const float *a, float *c, size_t n ) ;
+  void (*sigmoid)( const float *a, float *c, size_t n ) ;	/**< c = 1 / ( 1 + e^-a ) */
+  void (*relu)( const float *a, float *c, size_t n ) ;	/**< c = a < 0 ? 0 : a */
+  void (*softplus)( const float *a, float *c, size_t n ) ;	/**< c = log( 1 + e^a ), without overflow */
+
+  /** b = a' for an MxN block of a, leading dimension lda, into b, leading dimension ldb */
+  void (*transpose)( const float *a, size_t lda, float *b, size_t ldb, size_t m, size_t n ) ;
+
+  /** the sum of a ( or of a^2 ), compensated so it doesn't lose digits as it grows */
+  double (*sum)( const float *a, size_t n, bool squares ) ;
+  /** sum += a ( or a^2 ) element by element, carry holds what each add lost. The total is sum - carry */
+  void (*accumulate)( const float *a, float *sum, float *carry, size_t n, bool squares ) ;
+  /** stats = { mean, sum of ( a - mean )^2, min, max } of a short run, n > 0 */
+  void (*moments)( const float *a, size_t n, float *stats ) ;
+} ;
+
+/*
+ Plain C++ versions, for other CPUs. The float overloads of the math
+ functions are used throughout, nothing goes via double or int.
+*/
+namespace simd_scalar {
+  static void Add( const float *a, const float *b, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] + b[i] ; }
+  static void Sub( const float *a, const float *b, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] - b[i] ; }
+  static void Mul( const float *a, const float *b, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] * b[i] ; }
+  static void AddScalar( const float *a, float x, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] + x ; }
+  static void SubScalar( const float *a, float x, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] - x ; }
+  static void MulScalar( const float *a, float x, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] * x ; }
+  static void Neg( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = -a[i] ; }
+  static void Abs( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = std::fabs( a[i] ) ; }
+  static void Sqrt( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = std::sqrt( a[i] ) ; }
+  static void Log( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = std::log( a[i] ) ; }
+  static void Exp( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = std::exp( a[i] ) ; }
+  static void FindNear( const float *a, float x, float eps, float v, bool keep, float *c, size_t n ) {
+    for( size_t i=0 ; i<n ; i++ ) c[i] = std::fabs( a[i] - x ) < eps ? ( keep ? a[i] : v ) : 0.f ;
+  }
+  static void FindGreater( const float *a, float x, float v, bool keep, float *c, size_t n ) {
+    for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] > x ? ( keep ? a[i] : v ) : 0.f ;
+  }
+  static void FindLessEqual( const float *a, float x, float v, bool keep, float *c, size_t n ) {
+    for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] <= x ? ( keep ? a[i] : v ) : 0.f ;
+  }
+
+  static void Div( const float *a, const float *b, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] / b[i] ; }
+  static void Min( const float *a, const float *b, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] < b[i] ? a[i] : b[i] ; }
+  static void Max( const float *a, const float *b, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] > b[i] ? a[i] : b[i] ; }
+  static void Pow( const float *a, const float *b, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = std::pow( a[i], b[i] ) ; }
+  static void Tanh( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = std::tanh( a[i] ) ; }
+  static void Sigmoid( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = 1.f / ( 1.f + std::exp( -a[i] ) ) ; }
+  static void Relu( const float *a, float *c, size_t n ) { for( size_t i=0 ; i<n ; i++ ) c[i] = a[i] < 0.f ? 0.f : a[i] ; }
+  static void Softplus( const float *a, float *c, size_t n ) {
+    for( size_t i=0 ; i<n ; i++ ) c[i] = ( a[i] > 0.f ? a[i] : 0.f ) + std::log1p( std::exp( -std::fabs( a[i] ) ) ) ;
+  }
+  static void Transpose( const float *a, size_t lda, float *b, size_t ldb, size_t m, size_t n ) {
+    for( size_t j=0 ; j<n ; j++ ) for( size_t i=0 ; i<m ; i++ ) b[j + i*ldb] = a[i + j*lda] ;
+  }
+  static double Sum( const float *a, size_t n, bool squares ) {
+    float s = 0.f, c = 0.f ;
+    for( size_t i=0 ; i<n ; i++ ) {
+      float y = ( squares ? a[i] * a[i] : a[i] ) - c ;
+      float t = s + y ;
+      c = ( t - s ) - y ;
+      s = t ;
+    }
+    return (double)s - c ;
+  }
+  static void Accumulate( const float *a, float *sum, float *carry, size_t n, bool squares ) {
+    for( size_t i=0 ; i<n ; i++ ) {
+      float y = ( squares ? a[i] * a[i] : a[i] ) - carry[i] ;
+      float t = sum[i] + y ;
+      carry[i] = ( t - sum[i] ) - y ;
+      sum[i] = t ;
+    }
+  }
+  static void Moments( const float *a, size_t n, float *stats ) {
+    float s = 0.f, mn = a[0], mx = a[0] ;
+    for( size_t i=0 ; i<n ; i++ ) {
+      s += a[i] ;
+      mn = a[i] < mn ? a[i] : mn ;
+      mx = a[i] > mx ? a[i] : mx ;
+    }
+    float mean = s / n, d1 = 0.f, d2 = 0.f ;
+    for( size_t i=0 ; i<n ; i++ ) {
+      float d = a[i] - mean ;
+      d1 += d ;
+      d2 += d * d ;
+    }
+    stats[0] = mean ;
+    stats[1] = d2 - d1 * d1 / n ;
+    stats[2] = mn ;
+    stats[3] = mx ;
+  }
+
+  static const SimdKernels Table = {
+    "scalar",
+    Add, Sub, Mul,
+    AddScalar, SubScalar, MulScalar,
+    Neg, Abs, Sqrt, Log, Exp,
+    FindNear, FindGreater, FindLessEqual,
+    Div, Min, Max, Pow, Tanh, Sigmoid,
+    Relu, Softplus,
+    Transpose,
+    Sum, Accumulate, Moments
+  } ;
+}
+
+#ifdef LALG_SIMD_X86
+
+// gcc's AVX-512 headers trip -Wmaybe-uninitialized on their own undefined values
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+/*
+ Each instruction set below defines V - the vector operations used by
+ SimdKernels.h - then includes it. The target pragmas ( GCC and clang spell
+ them differently ) let the compiler use the instructions in that code
+ only, the rest of the module is built for the baseline CPU.
+*/
+
+#ifdef __clang__
+#pragma clang attribute push( __attribute__((target("sse2"))), apply_to=function )
+#else
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+namespace simd_sse2 {
+  struct V {
+    static constexpr const char *Name = "sse2" ;
+    static const size_t W = 4 ;
+    typedef __m128 vf ;
+    typedef __m128 vm ;
+    typedef __m128i vi ;
+
+    static inline vf load( const float *p ) { return _mm_loadu_ps( p ) ; }
+    static inline void store( float *p, vf a ) { _mm_storeu_ps( p, a ) ; }
+    static inline vf set1( float x ) { return _mm_set1_ps( x ) ; }
+    static inline vf zero() { return _mm_setzero_ps() ; }
+    static inline vf add( vf a, vf b ) { return _mm_add_ps( a, b ) ; }
+    static inline vf sub( vf a, vf b ) { return _mm_sub_ps( a, b ) ; }
+    static inline vf mul( vf a, vf b ) { return _mm_mul_ps( a, b ) ; }
+    static inline vf fmadd( vf a, vf b, vf c ) { return _mm_add_ps( _mm_mul_ps( a, b ), c ) ; }
+    static inline vf mn( vf a, vf b ) { return _mm_min_ps( a, b ) ; }
+    static inline vf mx( vf a, vf b ) { return _mm_max_ps( a, b ) ; }
+    static inline vf div( vf a, vf b ) { return _mm_div_ps( a, b ) ; }
+    static inline vf sqrt( vf a ) { return _mm_sqrt_ps( a ) ; }
+    static inline vf neg( vf a ) { return _mm_xor_ps( a, _mm_set1_ps( -0.f ) ) ; }
+    static inline vf abs( vf a ) { return _mm_andnot_ps( _mm_set1_ps( -0.f ), a ) ; }
+    static inline vf band( vf a, vf b ) { return _mm_and_ps( a, b ) ; }
+    static inline vf bor( vf a, vf b ) { return _mm_or_ps( a, b ) ; }
+
+    static inline vm gt( vf a, vf b ) { return _mm_cmpgt_ps( a, b ) ; }
+    static inline vm le( vf a, vf b ) { return _mm_cmple_ps( a, b ) ; }
+    static inline vm lt( vf a, vf b ) { return _mm_cmplt_ps( a, b ) ; }
+    static inline vm eq( vf a, vf b ) { return _mm_cmpeq_ps( a, b ) ; }
+    static inline vm isnan( vf a ) { return _mm_cmpunord_ps( a, a ) ; }
+    static inline vf select( vm m, vf a, vf b ) { return _mm_or_ps( _mm_and_ps( m, a ), _mm_andnot_ps( m, b ) ) ; }
+
+    static inline vf floor( vf a ) {	// SSE2 has no round, fine for |a| < 2^31
+      vf t = _mm_cvtepi32_ps( _mm_cvttps_epi32( a ) ) ;
+      return _mm_sub_ps( t, _mm_and_ps( _mm_cmpgt_ps( t, a ), _mm_set1_ps( 1.f ) ) ) ;
+    }
+    static inline vi cvtt( vf a ) { return _mm_cvttps_epi32( a ) ; }
+    static inline vf cvtf( vi a ) { return _mm_cvtepi32_ps( a ) ; }
+    static inline vi seti( int x ) { return _mm_set1_epi32( x ) ; }
+    static inline vi addi( vi a, vi b ) { return _mm_add_epi32( a, b ) ; }
+    static inline vi subi( vi a, vi b ) { return _mm_sub_epi32( a, b ) ; }
+    static inline vi srai1( vi a ) { return _mm_srai_epi32( a, 1 ) ; }
+    static inline vi slli23( vi a ) { return _mm_slli_epi32( a, 23 ) ; }
+    static inline vi srli23( vi a ) { return _mm_srli_epi32( a, 23 ) ; }
+    static inline vf bitsf( vi a ) { return _mm_castsi128_ps( a ) ; }
+    static inline vi bitsi( vf a ) { return _mm_castps_si128( a ) ; }
+
+    static const size_t T = 4 ;		// the side of a transposeTile
+    static inline void transposeTile( const float *a, size_t lda, float *b, size_t ldb ) {
+      vf r0 = load( a ), r1 = load( a+lda ), r2 = load( a+2*lda ), r3 = load( a+3*lda ) ;
+      _MM_TRANSPOSE4_PS( r0, r1, r2, r3 ) ;
+      store( b, r0 ) ; store( b+ldb, r1 ) ; store( b+2*ldb, r2 ) ; store( b+3*ldb, r3 ) ;
+    }
+  } ;
+#include "SimdKernels.h"
+}
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#ifdef __clang__
+#pragma clang attribute push( __attribute__((target("avx2,fma"))), apply_to=function )
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+namespace simd_avx2 {
+  struct V {
+    static constexpr const char *Name = "avx2" ;
+    static const size_t W = 8 ;
+    typedef __m256 vf ;
+    typedef __m256 vm ;
+    typedef __m256i vi ;
+
+    static inline vf load( const float *p ) { return _mm256_loadu_ps( p ) ; }
+    static inline void store( float *p, vf a ) { _mm256_storeu_ps( p, a ) ; }
+    static inline vf set1( float x ) { return _mm256_set1_ps( x ) ; }
+    static inline vf zero() { return _mm256_setzero_ps() ; }
+    static inline vf add( vf a, vf b ) { return _mm256_add_ps( a, b ) ; }
+    static inline vf sub( vf a, vf b ) { return _mm256_sub_ps( a, b ) ; }
+    static inline vf mul( vf a, vf b ) { return _mm256_mul_ps( a, b ) ; }
+    static inline vf fmadd( vf a, vf b, vf c ) { return _mm256_fmadd_ps( a, b, c ) ; }
+    static inline vf mn( vf a, vf b ) { return _mm256_min_ps( a, b ) ; }
+    static inline vf mx( vf a, vf b ) { return _mm256_max_ps( a, b ) ; }
+    static inline vf div( vf a, vf b ) { return _mm256_div_ps( a, b ) ; }
+    static inline vf sqrt( vf a ) { return _mm256_sqrt_ps( a ) ; }
+    static inline vf neg( vf a ) { return _mm256_xor_ps( a, _mm256_set1_ps( -0.f ) ) ; }
+    static inline vf abs( vf a ) { return _mm256_andnot_ps( _mm256_set1_ps( -0.f ), a ) ; }
+    static inline vf band( vf a, vf b ) { return _mm256_and_ps( a, b ) ; }
+    static inline vf bor( vf a, vf b ) { return _mm256_or_ps( a, b ) ; }
+
+    static inline vm gt( vf a, vf b ) { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ) ; }
+    static inline vm le( vf a, vf b ) { return _mm256_cmp_ps( a, b, _CMP_LE_OQ ) ; }
+    static inline vm lt( vf a, vf b ) { return _mm256_cmp_ps( a, b, _CMP_LT_OQ ) ; }
+    static inline vm eq( vf a, vf b ) { return _mm256_cmp_ps( a, b, _CMP_EQ_OQ ) ; }
+    static inline vm isnan( vf a ) { return _mm256_cmp_ps( a, a, _CMP_UNORD_Q ) ; }
+    static inline vf select( vm m, vf a, vf b ) { return _mm256_blendv_ps( b, a, m ) ; }
+
+    static inline vf floor( vf a ) { return _mm256_floor_ps( a ) ; }
+    static inline vi cvtt( vf a ) { return _mm256_cvttps_epi32( a ) ; }
+    static inline vf cvtf( vi a ) { return _mm256_cvtepi32_ps( a ) ; }
+    static inline vi seti( int x ) { return _mm256_set1_epi32( x ) ; }
+    static inline vi addi( vi a, vi b ) { return _mm256_add_epi32( a, b ) ; }
+    static inline vi subi( vi a, vi b ) { return _mm256_sub_epi32( a, b ) ; }
+    static inline vi srai1( vi a ) { return _mm256_srai_epi32( a, 1 ) ; }
+    static inline vi slli23( vi a ) { return _mm256_slli_epi32( a, 23 ) ; }
+    static inline vi srli23( vi a ) { return _mm256_srli_epi32( a, 23 ) ; }
+    static inline vf bitsf( vi a ) { return _mm256_castsi256_ps( a ) ; }
+    static inline vi bitsi( vf a ) { return _mm256_castps_si256( a ) ; }
+
+    static const size_t T = 8 ;		// the side of a transposeTile
+    static inline void transposeTile( const float *a, size_t lda, float *b, size_t ldb ) {
+      vf r[8], t[8] ;
+      for( int k=0 ; k<8 ; k++ ) r[k] = load( a + k*lda ) ;
+      for( int k=0 ; k<8 ; k+=2 ) {		// pairs of elements
+        t[k] = _mm256_unpacklo_ps( r[k], r[k+1] ) ;
+        t[k+1] = _mm256_unpackhi_ps( r[k], r[k+1] ) ;
+      }
+      for( int k=0 ; k<8 ; k+=4 ) {		// fours, within each 128 bit lane
+        r[k] = _mm256_shuffle_ps( t[k], t[k+2], _MM_SHUFFLE( 1,0,1,0 ) ) ;
+        r[k+1] = _mm256_shuffle_ps( t[k], t[k+2], _MM_SHUFFLE( 3,2,3,2 ) ) ;
+        r[k+2] = _mm256_shuffle_ps( t[k+1], t[k+3], _MM_SHUFFLE( 1,0,1,0 ) ) ;
+        r[k+3] = _mm256_shuffle_ps( t[k+1], t[k+3], _MM_SHUFFLE( 3,2,3,2 ) ) ;
+      }
+      for( int k=0 ; k<4 ; k++ ) {		// then swap the lanes
+        store( b + k*ldb, _mm256_permute2f128_ps( r[k], r[k+4], 0x20 ) ) ;
+        store( b + (k+4)*ldb, _mm256_permute2f128_ps( r[k], r[k+4], 0x31 ) ) ;
+      }
+    }
+  } ;
+#include "SimdKernels.h"
+}
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#ifdef __clang__
+#pragma clang attribute push( __attribute__((target("avx512f,avx2,fma"))), apply_to=function )
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx2,fma")
+#endif
+// AVX-512F CPUs all have AVX2 & FMA, the transpose tiles use them
+namespace simd_avx512 {
+  struct V {
+    static constexpr const char *Name = "avx512" ;
+    static const size_t W = 16 ;
+    typedef __m512 vf ;
+    typedef __mmask16 vm ;
+    typedef __m512i vi ;
+
+    static inline vf load( const float *p ) { return _mm512_loadu_ps( p ) ; }
+    static inline void store( float *p, vf a ) { _mm512_storeu_ps( p, a ) ; }
+    static inline vf set1( float x ) { return _mm512_set1_ps( x ) ; }
+    static inline vf zero() { return _mm512_setzero_ps() ; }
+    static inline vf add( vf a, vf b ) { return _mm512_add_ps( a, b ) ; }
+    static inline vf sub( vf a, vf b ) { return _mm512_sub_ps( a, b ) ; }
+    static inline vf mul( vf a, vf b ) { return _mm512_mul_ps( a, b ) ; }
+    static inline vf fmadd( vf a, vf b, vf c ) { return _mm512_fmadd_ps( a, b, c ) ; }
+    static inline vf mn( vf a, vf b ) { return _mm512_min_ps( a, b ) ; }
+    static inline vf mx( vf a, vf b ) { return _mm512_max_ps( a, b ) ; }
+    static inline vf div( vf a, vf b ) { return _mm512_div_ps( a, b ) ; }
+    static inline vf sqrt( vf a ) { return _mm512_sqrt_ps( a ) ; }
+    // the float bitwise ops are AVX-512DQ, so go via the integer ones
+    static inline vf neg( vf a ) { return bitsf( _mm512_xor_si512( bitsi( a ), _mm512_set1_epi32( (int)0x80000000 ) ) ) ; }
+    static inline vf abs( vf a ) { return bitsf( _mm512_and_si512( bitsi( a ), _mm512_set1_epi32( 0x7fffffff ) ) ) ; }
+    static inline vf band( vf a, vf b ) { return bitsf( _mm512_and_si512( bitsi( a ), bitsi( b ) ) ) ; }
+    static inline vf bor( vf a, vf b ) { return bitsf( _mm512_or_si512( bitsi( a ), bitsi( b ) ) ) ; }
+
+    static inline vm gt( vf a, vf b ) { return _mm512_cmp_ps_mask( a, b, _CMP_GT_OQ ) ; }
+    static inline vm le( vf a, vf b ) { return _mm512_cmp_ps_mask( a, b, _CMP_LE_OQ ) ; }
+    static inline vm lt( vf a, vf b ) { return _mm512_cmp_ps_mask( a, b, _CMP_LT_OQ ) ; }
+    static inline vm eq( vf a, vf b ) { return _mm512_cmp_ps_mask( a, b, _CMP_EQ_OQ ) ; }
+    static inline vm isnan( vf a ) { return _mm512_cmp_ps_mask( a, a, _CMP_UNORD_Q ) ; }
+    static inline vf select( vm m, vf a, vf b ) { return _mm512_mask_blend_ps( m, b, a ) ; }
+
+    static inline vf floor( vf a ) { return _mm512_roundscale_ps( a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC ) ; }
+    static inline vi cvtt( vf a ) { return _mm512_cvttps_epi32( a ) ; }
+    static inline vf cvtf( vi a ) { return _mm512_cvtepi32_ps( a ) ; }
+    static inline vi seti( int x ) { return _mm512_set1_epi32( x ) ; }
+    static inline vi addi( vi a, vi b ) { return _mm512_add_epi32( a, b ) ; }
+    static inline vi subi( vi a, vi b ) { return _mm512_sub_epi32( a, b ) ; }
+    static inline vi srai1( vi a ) { return _mm512_srai_epi32( a, 1 ) ; }
+    static inline vi slli23( vi a ) { return _mm512_slli_epi32( a, 23 ) ; }
+    static inline vi srli23( vi a ) { return _mm512_srli_epi32( a, 23 ) ; }
+    static inline vf bitsf( vi a ) { return _mm512_castsi512_ps( a ) ; }
+    static inline vi bitsi( vf a ) { return _mm512_castps_si512( a ) ; }
+
+    // 8x8 AVX tiles, a 16x16 tile needs twice the shuffles for no more bandwidth
+    static const size_t T = simd_avx2::V::T ;
+    static inline void transposeTile( const float *a, size_t lda, float *b, size_t ldb ) {
+      simd_avx2::V::transposeTile( a, lda, b, ldb ) ;
+    }
+  } ;
+#include "SimdKernels.h"
+}
+#ifdef __clang__
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+struct Simd {
+  /** the kernels for this CPU */
+  static const SimdKernels &Kernels() {
+    static const SimdKernels *kernels = Select() ;
+    return *kernels ;
+  }
+
+  private:
+    static const SimdKernels *Select() {
+      const SimdKernels *rc = &simd_scalar::Table ;
+      const char *cap = getenv( "LALG_SIMD" ) ;
+      if( cap != NULL && strcmp( cap, "scalar" ) == 0 ) return rc ;
+#ifdef LALG_SIMD_X86
+      __builtin_cpu_init() ;
+      if( __builtin_cpu_supports( "sse2" ) ) rc = &simd_sse2::Table ;
+      if( cap != NULL && strcmp( cap, "sse2" ) == 0 ) return rc ;
+      if( __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" ) ) rc = &simd_avx2::Table ;
+      if( cap != NULL && strcmp( cap, "avx2" ) == 0 ) return rc ;
+      if( rc == &simd_avx2::Table && __builtin_cpu_supports( "avx512f" ) ) rc = &simd_avx512::Table ;
+#endif
+      return rc ;
+    }
+} ;
+
+#endif
@@ -0,0 +1,394 @@
+/*
+ The element wise kernels, written once against a small vector API and
+ compiled for each instruction set. There's no include guard on purpose:
+ Simd.h includes this file several times, each time inside a namespace
+ that defines V - the vector type & operations for one instruction set -
+ and with the compiler targeting that instruction set.
+
+ Nothing may be #included here, Simd.h includes everything first.
+*/
+
+/*
+	The loops. Whole vectors are done in place, a partial vector at the end
+	is copied to a padded buffer and done the same way, so every element gets
+	exactly the same arithmetic wherever it is in the array.
+*/
+template<class F> static void BinaryLoop( const float *a, const float *b, float *c, size_t n, F f ) {
+  size_t i = 0 ;
+  for( ; i+V::W<=n ; i+=V::W ) {
+    V::store( c+i, f( V::load( a+i ), V::load( b+i ) ) ) ;
+  }
+  if( i < n ) {
+    float ta[V::W], tb[V::W], tc[V::W] ;
+    memset( ta, 0, sizeof(ta) ) ;
+    memset( tb, 0, sizeof(tb) ) ;
+    memcpy( ta, a+i, (n-i)*sizeof(float) ) ;
+    memcpy( tb, b+i, (n-i)*sizeof(float) ) ;
+    V::store( tc, f( V::load( ta ), V::load( tb ) ) ) ;
+    memcpy( c+i, tc, (n-i)*sizeof(float) ) ;
+  }
+}
+
+template<class F> static void UnaryLoop( const float *a, float *c, size_t n, F f ) {
+  size_t i = 0 ;
+  for( ; i+V::W<=n ; i+=V::W ) {
+    V::store( c+i, f( V::load( a+i ) ) ) ;
+  }
+  if( i < n ) {
+    float ta[V::W], tc[V::W] ;
+    memset( ta, 0, sizeof(ta) ) ;
+    memcpy( ta, a+i, (n-i)*sizeof(float) ) ;
+    V::store( tc, f( V::load( ta ) ) ) ;
+    memcpy( c+i, tc, (n-i)*sizeof(float) ) ;
+  }
+}
+
+/*
+	Natural log, the Cephes single precision algorithm: split x into
+	2^e * m with m in [sqrt(1/2),sqrt(2)) then a polynomial in m-1.
+	Denormals are scaled up first. log(0) = -inf, log(<0) = NaN.
+*/
+static inline V::vf Log( V::vf in ) {
+  const V::vf one = V::set1( 1.f ) ;
+  const V::vf zero = V::zero() ;
+
+  V::vm denormal = V::lt( in, V::set1( 1.17549435e-38f ) ) ;
+  V::vf x = V::select( denormal, V::mul( in, V::set1( 8388608.f ) ), in ) ;	// * 2^23
+  V::vf e = V::sub( V::cvtf( V::srli23( V::bitsi( x ) ) ), V::set1( 126.f ) ) ;
+  e = V::sub( e, V::select( denormal, V::set1( 23.f ), zero ) ) ;
+  x = V::bor( V::band( x, V::bitsf( V::seti( ~0x7f800000 ) ) ), V::set1( 0.5f ) ) ;	// m in [0.5,1)
+
+  V::vm small = V::lt( x, V::set1( 0.707106781186547524f ) ) ;
+  V::vf tmp = V::select( small, x, zero ) ;
+  x = V::sub( x, one ) ;
+  e = V::sub( e, V::select( small, one, zero ) ) ;
+  x = V::add( x, tmp ) ;
+
+  V::vf z = V::mul( x, x ) ;
+  V::vf y = V::set1( 7.0376836292E-2f ) ;
+  y = V::fmadd( y, x, V::set1( -1.1514610310E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( 1.1676998740E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( -1.2420140846E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( 1.4249322787E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( -1.6668057665E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( 2.0000714765E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( -2.4999993993E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( 3.3333331174E-1f ) ) ;
+  y = V::mul( V::mul( y, x ), z ) ;
+  y = V::fmadd( e, V::set1( -2.12194440e-4f ), y ) ;
+  y = V::fmadd( z, V::set1( -0.5f ), y ) ;
+  x = V::add( x, y ) ;
+  x = V::fmadd( e, V::set1( 0.693359375f ), x ) ;
+
+  x = V::select( V::eq( in, zero ), V::set1( -INFINITY ), x ) ;
+  x = V::select( V::lt( in, zero ), V::set1( NAN ), x ) ;
+  x = V::select( V::eq( in, V::set1( INFINITY ) ), in, x ) ;
+  return V::select( V::isnan( in ), in, x ) ;
+}
+
+/*
+	e^x, the Cephes single precision algorithm: x = n ln2 + r, then a
+	polynomial in r times 2^n. 2^n is applied in two halves so results
+	near the ends of the float range ( including denormals ) come out right.
+*/
+static inline V::vf Exp( V::vf in ) {
+  V::vf x = V::mn( V::mx( in, V::set1( -104.f ) ), V::set1( 89.f ) ) ;
+  V::vf fx = V::floor( V::fmadd( x, V::set1( 1.44269504088896341f ), V::set1( 0.5f ) ) ) ;
+  x = V::sub( x, V::mul( fx, V::set1( 0.693359375f ) ) ) ;
+  x = V::sub( x, V::mul( fx, V::set1( -2.12194440e-4f ) ) ) ;
+
+  V::vf z = V::mul( x, x ) ;
+  V::vf y = V::set1( 1.9875691500E-4f ) ;
+  y = V::fmadd( y, x, V::set1( 1.3981999507E-3f ) ) ;
+  y = V::fmadd( y, x, V::set1( 8.3334519073E-3f ) ) ;
+  y = V::fmadd( y, x, V::set1( 4.1665795894E-2f ) ) ;
+  y = V::fmadd( y, x, V::set1( 1.6666665459E-1f ) ) ;
+  y = V::fmadd( y, x, V::set1( 5.0000001201E-1f ) ) ;
+  y = V::fmadd( y, z, x ) ;
+  y = V::add( y, V::set1( 1.f ) ) ;
+
+  V::vi n = V::cvtt( fx ) ;
+  V::vi n1 = V::srai1( n ) ;
+  V::vi n2 = V::subi( n, n1 ) ;
+  y = V::mul( y, V::bitsf( V::slli23( V::addi( n1, V::seti( 127 ) ) ) ) ) ;
+  y = V::mul( y, V::bitsf( V::slli23( V::addi( n2, V::seti( 127 ) ) ) ) ) ;
+  return V::select( V::isnan( in ), in, y ) ;
+}
+
+/*
+	x ^ y as e^( y log|x| ). A negative x gives a NaN unless y is a whole
+	number, then the sign comes from y being odd or even. y = 0 gives 1
+	and x = 0 gives 0 or infinity, like the C library.
+*/
+static inline V::vf Pow( V::vf x, V::vf y ) {
+  const V::vf zero = V::zero() ;
+  const V::vf one = V::set1( 1.f ) ;
+  V::vf r = Exp( V::mul( y, Log( V::abs( x ) ) ) ) ;
+  V::vm whole = V::eq( V::floor( y ), y ) ;
+  V::vf half = V::mul( y, V::set1( 0.5f ) ) ;
+  V::vm odd = V::eq( V::sub( y, V::add( V::floor( half ), V::floor( half ) ) ), one ) ;
+  r = V::select( V::lt( x, zero ), V::select( odd, V::neg( r ), V::select( whole, r, V::set1( NAN ) ) ), r ) ;
+  V::vf atZero = V::select( V::gt( y, zero ), zero, V::set1( INFINITY ) ) ;
+  r = V::select( V::eq( x, zero ), atZero, r ) ;
+  r = V::select( V::eq( y, zero ), one, r ) ;
+  return r ;
+}
+
+/*
+	tanh, the Cephes single precision algorithm: a polynomial for |x| < 0.625
+	and 1 - 2 / ( e^2|x| + 1 ) above that, with the sign put back.
+*/
+static inline V::vf Tanh( V::vf x ) {
+  V::vf ax = V::abs( x ) ;
+  V::vf z = V::mul( x, x ) ;
+  V::vf p = V::set1( -5.70498872745E-3f ) ;
+  p = V::fmadd( p, z, V::set1( 2.06390887954E-2f ) ) ;
+  p = V::fmadd( p, z, V::set1( -5.37397155531E-2f ) ) ;
+  p = V::fmadd( p, z, V::set1( 1.33314422036E-1f ) ) ;
+  p = V::fmadd( p, z, V::set1( -3.33332819422E-1f ) ) ;
+  p = V::fmadd( V::mul( p, z ), x, x ) ;
+  V::vf e = Exp( V::add( ax, ax ) ) ;
+  V::vf big = V::sub( V::set1( 1.f ), V::div( V::set1( 2.f ), V::add( e, V::set1( 1.f ) ) ) ) ;
+  big = V::select( V::lt( x, V::zero() ), V::neg( big ), big ) ;
+  return V::select( V::lt( ax, V::set1( 0.625f ) ), p, big ) ;
+}
+
+/* 1 / ( 1 + e^-x ) */
+static inline V::vf Sigmoid( V::vf x ) {
+  const V::vf one = V::set1( 1.f ) ;
+  return V::div( one, V::add( one, Exp( V::neg( x ) ) ) ) ;
+}
+
+/*
+	log( 1 + e^x ) as max( x, 0 ) + log( 1 + e^-|x| ), so e^x can't
+	overflow. log( 1 + u ) is log( w ) * u / ( w - 1 ) with w = 1 + u,
+	which keeps the digits of a small u that 1 + u rounds away.
+*/
+static inline V::vf Softplus( V::vf x ) {
+  const V::vf one = V::set1( 1.f ) ;
+  V::vf u = Exp( V::neg( V::abs( x ) ) ) ;
+  V::vf w = V::add( one, u ) ;
+  V::vf lp = V::select( V::eq( w, one ), u, V::div( V::mul( Log( w ), u ), V::sub( w, one ) ) ) ;
+  return V::add( V::select( V::gt( x, V::zero() ), x, V::zero() ), lp ) ;
+}
+
+struct AddF { V::vf operator()( V::vf a, V::vf b ) const { return V::add( a, b ) ; } } ;
+struct SubF { V::vf operator()( V::vf a, V::vf b ) const { return V::sub( a, b ) ; } } ;
+struct MulF { V::vf operator()( V::vf a, V::vf b ) const { return V::mul( a, b ) ; } } ;
+struct DivF { V::vf operator()( V::vf a, V::vf b ) const { return V::div( a, b ) ; } } ;
+struct MinF { V::vf operator()( V::vf a, V::vf b ) const { return V::select( V::lt( a, b ), a, b ) ; } } ;
+struct MaxF { V::vf operator()( V::vf a, V::vf b ) const { return V::select( V::gt( a, b ), a, b ) ; } } ;
+struct PowF { V::vf operator()( V::vf a, V::vf b ) const { return Pow( a, b ) ; } } ;
+
+/* a binary operator with a fixed right hand side */
+template<class F> struct ScalarF {
+  F f ;
+  V::vf x ;
+  ScalarF( float v ) : x( V::set1( v ) ) {}
+  V::vf operator()( V::vf a ) const { return f( a, x ) ; }
+} ;
+
+struct NegF { V::vf operator()( V::vf a ) const { return V::neg( a ) ; } } ;
+struct AbsF { V::vf operator()( V::vf a ) const { return V::abs( a ) ; } } ;
+struct SqrtF { V::vf operator()( V::vf a ) const { return V::sqrt( a ) ; } } ;
+struct LogF { V::vf operator()( V::vf a ) const { return Log( a ) ; } } ;
+struct ExpF { V::vf operator()( V::vf a ) const { return Exp( a ) ; } } ;
+struct TanhF { V::vf operator()( V::vf a ) const { return Tanh( a ) ; } } ;
+struct SigmoidF { V::vf operator()( V::vf a ) const { return Sigmoid( a ) ; } } ;
+struct ReluF { V::vf operator()( V::vf a ) const { return V::select( V::lt( a, V::zero() ), V::zero(), a ) ; } } ;
+struct SoftplusF { V::vf operator()( V::vf a ) const { return Softplus( a ) ; } } ;
+
+/* the find family: where the test passes the result is the element ( keep ) or v, else 0 */
+struct FindNearF {
+  V::vf x, eps, v ;
+  bool keep ;
+  FindNearF( float x_, float eps_, float v_, bool keep_ ) : x( V::set1( x_ ) ), eps( V::set1( eps_ ) ), v( V::set1( v_ ) ), keep( keep_ ) {}
+  V::vf operator()( V::vf a ) const {
+    return V::select( V::lt( V::abs( V::sub( a, x ) ), eps ), keep ? a : v, V::zero() ) ;
+  }
+} ;
+struct FindGreaterF {
+  V::vf x, v ;
+  bool keep ;
+  FindGreaterF( float x_, float v_, bool keep_ ) : x( V::set1( x_ ) ), v( V::set1( v_ ) ), keep( keep_ ) {}
+  V::vf operator()( V::vf a ) const {
+    return V::select( V::gt( a, x ), keep ? a : v, V::zero() ) ;
+  }
+} ;
+struct FindLessEqualF {
+  V::vf x, v ;
+  bool keep ;
+  FindLessEqualF( float x_, float v_, bool keep_ ) : x( V::set1( x_ ) ), v( V::set1( v_ ) ), keep( keep_ ) {}
+  V::vf operator()( V::vf a ) const {
+    return V::select( V::le( a, x ), keep ? a : v, V::zero() ) ;
+  }
+} ;
+
+static void Add( const float *a, const float *b, float *c, size_t n ) { BinaryLoop( a, b, c, n, AddF() ) ; }
+static void Sub( const float *a, const float *b, float *c, size_t n ) { BinaryLoop( a, b, c, n, SubF() ) ; }
+static void Mul( const float *a, const float *b, float *c, size_t n ) { BinaryLoop( a, b, c, n, MulF() ) ; }
+static void AddScalar( const float *a, float x, float *c, size_t n ) { UnaryLoop( a, c, n, ScalarF<AddF>( x ) ) ; }
+static void SubScalar( const float *a, float x, float *c, size_t n ) { UnaryLoop( a, c, n, ScalarF<SubF>( x ) ) ; }
+static void MulScalar( const float *a, float x, float *c, size_t n ) { UnaryLoop( a, c, n, ScalarF<MulF>( x ) ) ; }
+static void Neg( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, NegF() ) ; }
+static void Abs( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, AbsF() ) ; }
+static void Sqrt( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, SqrtF() ) ; }
+static void Log( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, LogF() ) ; }
+static void Exp( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, ExpF() ) ; }
+static void FindNear( const float *a, float x, float eps, float v, bool keep, float *c, size_t n ) {
+  UnaryLoop( a, c, n, FindNearF( x, eps, v, keep ) ) ;
+}
+static void FindGreater( const float *a, float x, float v, bool keep, float *c, size_t n ) {
+  UnaryLoop( a, c, n, FindGreaterF( x, v, keep ) ) ;
+}
+static void FindLessEqual( const float *a, float x, float v, bool keep, float *c, size_t n ) {
+  UnaryLoop( a, c, n, FindLessEqualF( x, v, keep ) ) ;
+}
+
+static void Div( const float *a, const float *b, float *c, size_t n ) { BinaryLoop( a, b, c, n, DivF() ) ; }
+static void Min( const float *a, const float *b, float *c, size_t n ) { BinaryLoop( a, b, c, n, MinF() ) ; }
+static void Max( const float *a, const float *b, float *c, size_t n ) { BinaryLoop( a, b, c, n, MaxF() ) ; }
+static void Pow( const float *a, const float *b, float *c, size_t n ) { BinaryLoop( a, b, c, n, PowF() ) ; }
+static void Tanh( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, TanhF() ) ; }
+static void Sigmoid( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, SigmoidF() ) ; }
+static void Relu( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, ReluF() ) ; }
+static void Softplus( const float *a, float *c, size_t n ) { UnaryLoop( a, c, n, SoftplusF() ) ; }
+
+/*
+	b = a' for an MxN block, V::T x V::T tiles at a time with the
+	remainder done one by one. Reads down columns of a, writes along
+	columns of b.
+*/
+static void Transpose( const float *a, size_t lda, float *b, size_t ldb, size_t m, size_t n ) {
+  size_t j = 0 ;
+  for( ; j+V::T<=n ; j+=V::T ) {
+    size_t i = 0 ;
+    for( ; i+V::T<=m ; i+=V::T ) V::transposeTile( a + i + j*lda, lda, b + j + i*ldb, ldb ) ;
+    for( ; i<m ; i++ ) {
+      for( size_t k=j ; k<j+V::T ; k++ ) b[k + i*ldb] = a[i + k*lda] ;
+    }
+  }
+  for( ; j<n ; j++ ) {
+    for( size_t i=0 ; i<m ; i++ ) b[j + i*ldb] = a[i + j*lda] ;
+  }
+}
+
+/* one step of a Kahan sum: s += x, c collects what the add rounds off */
+static inline void Kahan( V::vf &s, V::vf &c, V::vf x ) {
+  V::vf y = V::sub( x, c ) ;
+  V::vf t = V::add( s, y ) ;
+  c = V::sub( V::sub( t, s ), y ) ;
+  s = t ;
+}
+
+/*
+	A compensated sum in two sets of lanes ( to hide the add latency ),
+	the lanes and the tail are added up in double at the end.
+*/
+static double Sum( const float *a, size_t n, bool squares ) {
+  V::vf s0 = V::zero(), c0 = V::zero(), s1 = V::zero(), c1 = V::zero() ;
+  size_t i = 0 ;
+  for( ; i+2*V::W<=n ; i+=2*V::W ) {
+    V::vf x0 = V::load( a+i ), x1 = V::load( a+i+V::W ) ;
+    if( squares ) {
+      x0 = V::mul( x0, x0 ) ;
+      x1 = V::mul( x1, x1 ) ;
+    }
+    Kahan( s0, c0, x0 ) ;
+    Kahan( s1, c1, x1 ) ;
+  }
+  float ts0[V::W], tc0[V::W], ts1[V::W], tc1[V::W] ;
+  V::store( ts0, s0 ) ;
+  V::store( tc0, c0 ) ;
+  V::store( ts1, s1 ) ;
+  V::store( tc1, c1 ) ;
+  double rc = 0 ;
+  for( size_t l=0 ; l<V::W ; l++ ) rc += ( (double)ts0[l] - tc0[l] ) + ( (double)ts1[l] - tc1[l] ) ;
+  for( ; i<n ; i++ ) rc += squares ? (double)a[i] * a[i] : a[i] ;
+  return rc ;
+}
+
+static void Accumulate( const float *a, float *sum, float *carry, size_t n, bool squares ) {
+  size_t i = 0 ;
+  for( ; i+V::W<=n ; i+=V::W ) {
+    V::vf x = V::load( a+i ) ;
+    if( squares ) x = V::mul( x, x ) ;
+    V::vf s = V::load( sum+i ), c = V::load( carry+i ) ;
+    Kahan( s, c, x ) ;
+    V::store( sum+i, s ) ;
+    V::store( carry+i, c ) ;
+  }
+  for( ; i<n ; i++ ) {
+    float y = ( squares ? a[i] * a[i] : a[i] ) - carry[i] ;
+    float t = sum[i] + y ;
+    carry[i] = ( t - sum[i] ) - y ;
+    sum[i] = t ;
+  }
+}
+
+/*
+	Two passes over a run short enough to stay in cache: the sum, min &
+	max, then the squared differences from the mean. The sum of the
+	differences corrects for the rounding of the mean.
+*/
+static void Moments( const float *a, size_t n, float *stats ) {
+  V::vf s = V::zero(), mn = V::set1( a[0] ), mx = V::set1( a[0] ) ;
+  size_t i = 0 ;
+  for( ; i+V::W<=n ; i+=V::W ) {
+    V::vf x = V::load( a+i ) ;
+    s = V::add( s, x ) ;
+    mn = V::mn( mn, x ) ;
+    mx = V::mx( mx, x ) ;
+  }
+  float ts[V::W], tn[V::W], tx[V::W] ;
+  V::store( ts, s ) ;
+  V::store( tn, mn ) ;
+  V::store( tx, mx ) ;
+  float sum = 0.f, lo = tn[0], hi = tx[0] ;
+  for( size_t l=0 ; l<V::W ; l++ ) {
+    sum += ts[l] ;
+    lo = tn[l] < lo ? tn[l] : lo ;
+    hi = tx[l] > hi ? tx[l] : hi ;
+  }
+  for( size_t j=i ; j<n ; j++ ) {
+    sum += a[j] ;
+    lo = a[j] < lo ? a[j] : lo ;
+    hi = a[j] > hi ? a[j] : hi ;
+  }
+
+  const float mean = sum / n ;
+  V::vf vmean = V::set1( mean ), d1 = V::zero(), d2 = V::zero() ;
+  for( i=0 ; i+V::W<=n ; i+=V::W ) {
+    V::vf d = V::sub( V::load( a+i ), vmean ) ;
+    d1 = V::add( d1, d ) ;
+    d2 = V::fmadd( d, d, d2 ) ;
+  }
+  V::store( ts, d1 ) ;
+  V::store( tn, d2 ) ;
+  float s1 = 0.f, s2 = 0.f ;
+  for( size_t l=0 ; l<V::W ; l++ ) {
+    s1 += ts[l] ;
+    s2 += tn[l] ;
+  }
+  for( ; i<n ; i++ ) {
+    float d = a[i] - mean ;
+    s1 += d ;
+    s2 += d * d ;
+  }
+  stats[0] = mean ;
+  stats[1] = s2 - s1 * s1 / n ;
+  stats[2] = lo ;
+  stats[3] = hi ;
+}
+
+static const SimdKernels Table = {
+  V::Name,
+  Add, Sub, Mul,
+  AddScalar, SubScalar, MulScalar,
+  Neg, Abs, Sqrt, Log, Exp,
+  FindNear, FindGreater, FindLessEqual,
+  Div, Min, Max, Pow, Tanh, Sigmoid,
+  Relu, Softplus,
+  Transpose,
+  Sum, Accumulate, Moments
+} ;
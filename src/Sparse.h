@@ -0,0 +1,202 @@
+#ifndef LALG_SPARSE_H
+#define LALG_SPARSE_H
+
+#include <stddef.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+/**
+ A sparse matrix in compressed sparse column (CSC) form.
+
+ The non zero values of column c are values[ colPtr[c] .. colPtr[c+1] ),
+ rowIdx holds the row of each one, sorted within the column. That's the
+ same column major order as the dense matrices, so both S x B and A x S
+ run down the columns of S, and a transpose is the CSR form of the
+ original.
+
+ Everything here is plain C++, it's safe to use off the main thread as
+ long as nothing is changing the matrix at the same time.
+*/
+class SparseCsc
+{
+  public:
+    int m ;				/**< the number of rows */
+    int n ;				/**< the number of columns */
+    std::vector<size_t> colPtr ;	/**< n+1 offsets into rowIdx & values */
+    std::vector<int> rowIdx ;		/**< the row of each value */
+    std::vector<float> values ;		/**< the non zero values, column by column */
+
+    SparseCsc() : m(0), n(0), colPtr( 1, 0 ) {}
+
+    size_t Nnz() const { return values.size() ; }
+
+    /** bytes used by the arrays - reported to V8 */
+    size_t Bytes() const {
+      return colPtr.size() * sizeof(size_t) + rowIdx.size() * sizeof(int) + values.size() * sizeof(float) ;
+    }
+
+    /**
+	Build from coordinate (COO) triplets, in any order. Duplicate
+	entries are added together.
+	@return the index of the first triplet out of range, -2 if the size is 
+	negative, or -1 if all is well
+    */
+    long FromTriplets( int rows, int cols, const std::vector<int> &r, const std::vector<int> &c, const std::vector<float> &v ) {
+      if( rows < 0 || cols < 0 ) return -2 ;
+      size_t count = std::min( r.size(), std::min( c.size(), v.size() ) ) ;
+      for( size_t i=0 ; i<count ; i++ ) {
+        if( r[i] < 0 || r[i] >= rows || c[i] < 0 || c[i] >= cols ) return (long)i ;
+      }
+      m = rows ;
+      n = cols ;
+
+      // counting sort on the column
+      colPtr.assign( n+1, 0 ) ;
+      for( size_t i=0 ; i<count ; i++ ) colPtr[ c[i]+1 ]++ ;
+      for( int j=0 ; j<n ; j++ ) colPtr[j+1] += colPtr[j] ;
+      std::vector<size_t> next( colPtr.begin(), colPtr.end()-1 ) ;
+      rowIdx.resize( count ) ;
+      values.resize( count ) ;
+      for( size_t i=0 ; i<count ; i++ ) {
+        size_t p = next[ c[i] ]++ ;
+        rowIdx[p] = r[i] ;
+        values[p] = v[i] ;
+      }
+      SortAndMerge() ;
+      return -1 ;
+    }
+
+    /**
+	Build from a dense m x n matrix ( leading dimension ld ) keeping
+	the elements whose magnitude is more than threshold
+    */
+    void FromDense( const float *a, int rows, int cols, int ld, float threshold ) {
+      m = rows ;
+      n = cols ;
+      colPtr.assign( n+1, 0 ) ;
+      rowIdx.clear() ;
+      values.clear() ;
+      for( int j=0 ; j<n ; j++ ) {
+        const float *col = a + (size_t)j*ld ;
+        for( int i=0 ; i<m ; i++ ) {
+          if( std::fabs( col[i] ) > threshold ) {
+            rowIdx.push_back( i ) ;
+            values.push_back( col[i] ) ;
+          }
+        }
+        colPtr[j+1] = values.size() ;
+      }
+    }
+
+    /** write the transpose ( n x m ) into out */
+    void Transpose( SparseCsc &out ) const {
+      out.m = n ;
+      out.n = m ;
+      out.colPtr.assign( m+1, 0 ) ;
+      for( size_t p=0 ; p<Nnz() ; p++ ) out.colPtr[ rowIdx[p]+1 ]++ ;
+      for( int i=0 ; i<m ; i++ ) out.colPtr[i+1] += out.colPtr[i] ;
+      std::vector<size_t> next( out.colPtr.begin(), out.colPtr.end()-1 ) ;
+      out.rowIdx.resize( Nnz() ) ;
+      out.values.resize( Nnz() ) ;
+      for( int j=0 ; j<n ; j++ ) {	// columns in order keeps the new rows sorted
+        for( size_t p=colPtr[j] ; p<colPtr[j+1] ; p++ ) {
+          size_t q = next[ rowIdx[p] ]++ ;
+          out.rowIdx[q] = j ;
+          out.values[q] = values[p] ;
+        }
+      }
+    }
+
+    /** the dense form, into an m x n matrix with leading dimension ldc */
+    void ToDense( float *c, int ldc ) const {
+      for( int j=0 ; j<n ; j++ ) {
+        float *col = c + (size_t)j*ldc ;
+        std::fill( col, col+m, 0.f ) ;
+        for( size_t p=colPtr[j] ; p<colPtr[j+1] ; p++ ) col[ rowIdx[p] ] = values[p] ;
+      }
+    }
+
+    /** the value at (r,c) - 0 if it's not stored */
+    float Get( int r, int c ) const {
+      std::vector<int>::const_iterator first = rowIdx.begin() + colPtr[c] ;
+      std::vector<int>::const_iterator last = rowIdx.begin() + colPtr[c+1] ;
+      std::vector<int>::const_iterator it = std::lower_bound( first, last, r ) ;
+      return ( it != last && *it == r ) ? values[ it - rowIdx.begin() ] : 0.f ;
+    }
+
+    /**
+	C = S x B + beta C. B is dense n x k ( ldb ), C is dense m x k ( ldc ).
+	Each column of C is built from the columns of S picked out by the non
+	zeros in the same column of B, so k = 1 is a plain SpMV.
+    */
+    void MulDense( const float *b, int ldb, int k, float beta, float *c, int ldc ) const {
+      for( int j=0 ; j<k ; j++ ) {
+        float *cj = c + (size_t)j*ldc ;
+        Scale( beta, cj, m ) ;
+        const float *bj = b + (size_t)j*ldb ;
+        for( int l=0 ; l<n ; l++ ) {
+          float x = bj[l] ;
+          if( x == 0.f ) continue ;
+          for( size_t p=colPtr[l] ; p<colPtr[l+1] ; p++ ) cj[ rowIdx[p] ] += values[p] * x ;
+        }
+      }
+    }
+
+    /**
+	C = A x S + beta C. A is dense k x m ( lda ), C is dense k x n ( ldc ).
+	Column j of C is a sum of the columns of A picked out by column j of S.
+    */
+    void DenseMul( const float *a, int lda, int k, float beta, float *c, int ldc ) const {
+      for( int j=0 ; j<n ; j++ ) {
+        float *cj = c + (size_t)j*ldc ;
+        Scale( beta, cj, k ) ;
+        for( size_t p=colPtr[j] ; p<colPtr[j+1] ; p++ ) {
+          const float *ai = a + (size_t)rowIdx[p]*lda ;
+          float x = values[p] ;
+          for( int i=0 ; i<k ; i++ ) cj[i] += ai[i] * x ;
+        }
+      }
+    }
+
+  private:
+    /* sort the rows in each column, then add up duplicates */
+    void SortAndMerge() {
+      std::vector< std::pair<int,float> > col ;
+      size_t out = 0 ;
+      for( int j=0 ; j<n ; j++ ) {
+        size_t start = colPtr[j] ;
+        size_t end = colPtr[j+1] ;
+        col.clear() ;
+        for( size_t p=start ; p<end ; p++ ) col.push_back( std::make_pair( rowIdx[p], values[p] ) ) ;
+        std::sort( col.begin(), col.end(), LessRow ) ;
+        colPtr[j] = out ;
+        for( size_t i=0 ; i<col.size() ; i++ ) {
+          if( out > colPtr[j] && rowIdx[out-1] == col[i].first ) {
+            values[out-1] += col[i].second ;
+          } else {
+            rowIdx[out] = col[i].first ;
+            values[out] = col[i].second ;
+            out++ ;
+          }
+        }
+      }
+      colPtr[n] = out ;
+      rowIdx.resize( out ) ;
+      values.resize( out ) ;
+    }
+
+    static bool LessRow( const std::pair<int,float> &a, const std::pair<int,float> &b ) {
+      return a.first < b.first ;
+    }
+
+    static void Scale( float beta, float *c, int len ) {
+      if( beta == 0.f ) {
+        std::fill( c, c+len, 0.f ) ;
+      } else if( beta != 1.f ) {
+        for( int i=0 ; i<len ; i++ ) c[i] *= beta ;
+      }
+    }
+} ;
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef LALG_THREAD_POOL_H
+#define LALG_THREAD_POOL_H
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ A fixed set of worker threads for splitting big element wise ops and
+ reductions across cores.
+
+ For() runs a job as count independent pieces; the calling thread and the
+ workers take pieces off a shared counter until there are none left, and
+ For() returns when every piece is done. The workers are started the first
+ time they're needed and then sleep between jobs.
+
+ One job runs at a time. If For() is called while a job is running - from
+ a uv worker thread, or from inside a piece - the new job just runs on the
+ calling thread, so nothing ever waits on the pool while holding it. A
+ thread running a piece is flagged, so it never tries to lock run_ again.
+
+ Work smaller than MinElements() isn't worth waking the workers for, the
+ callers check that before splitting.
+*/
+class ThreadPool
+{
+  public:
+    static ThreadPool &Instance() {
+      static ThreadPool pool ;
+      return pool ;
+    }
+
+    /** the number of threads a job is split over, including the caller */
+    int Threads() const { return threads_ ; }
+
+    /**
+	Change the number of threads, 1 turns threading off. Waits for a
+	running job to finish. The new workers start on the next job.
+    */
+    void SetThreads( int threads ) {
+      std::lock_guard<std::mutex> running( run_ ) ;
+      StopWorkers() ;
+      threads_ = threads < 1 ? 1 : threads ;
+    }
+
+    /** the smallest number of elements worth splitting */
+    size_t MinElements() const { return minElements_ ; }
+    void SetMinElements( size_t minElements ) { minElements_ = minElements < 1 ? 1 : minElements ; }
+
+    /** should a job over this many elements be split? */
+    bool Worthwhile( size_t elements ) const { return threads_ > 1 && elements >= minElements_ ; }
+
+    /**
+	How many pieces to split a job of this many elements into - a few
+	per thread to even out the load, but no smaller than MinElements()/4
+	each. Always at least 1.
+    */
+    size_t Pieces( size_t elements ) const {
+      if( !Worthwhile( elements ) ) return 1 ;
+      size_t pieces = (size_t)threads_ * 4 ;
+      size_t most = elements / std::max( (size_t)1, minElements_ / 4 ) ;
+      return std::max( (size_t)1, std::min( pieces, most ) ) ;
+    }
+
+    /** the number of pieces Ranges() splits count items, of each elements apiece, into */
+    size_t RangeCount( size_t count, size_t each ) const {
+      return std::max( (size_t)1, std::min( count, Pieces( count * each ) ) ) ;
+    }
+
+    /**
+	Split [0,count) into RangeCount() runs and call f( piece, begin, end )
+	for each, in parallel. Each item is each elements of work.
+    */
+    template<class F> void Ranges( size_t count, size_t each, F f ) {
+      size_t pieces = RangeCount( count, each ) ;
+      if( pieces == 1 ) {
+        if( count > 0 ) f( 0, 0, count ) ;
+        return ;
+      }
+      For( pieces, [&]( size_t i ) { f( i, count*i/pieces, count*(i+1)/pieces ) ; } ) ;
+    }
+
+    /**
+	Run f( i ) for each i in [0,count), spread over the threads.
+	Returns when they've all finished.
+    */
+    void For( size_t count, const std::function<void(size_t)> &f ) {
+      if( count == 0 ) return ;
+      if( count == 1 || threads_ < 2 || InPiece() || !run_.try_lock() ) {
+        for( size_t i=0 ; i<count ; i++ ) f( i ) ;
+        return ;
+      }
+      if( workers_.empty() ) StartWorkers() ;
+      {
+        std::lock_guard<std::mutex> guard( lock_ ) ;
+        job_ = &f ;
+        count_ = count ;
+        next_ = 0 ;
+        active_ = (int)workers_.size() ;
+        generation_++ ;
+      }
+      wake_.notify_all() ;
+      Work() ;
+      {
+        std::unique_lock<std::mutex> guard( lock_ ) ;
+        done_.wait( guard, [this] { return active_ == 0 ; } ) ;
+        job_ = NULL ;
+      }
+      run_.unlock() ;
+    }
+
+    ~ThreadPool() {
+      std::lock_guard<std::mutex> running( run_ ) ;
+      StopWorkers() ;
+    }
+
+  private:
+    ThreadPool() : threads_( std::max( 1, (int)std::thread::hardware_concurrency() ) ),
+		minElements_( 64 * 1024 ), job_( NULL ), count_( 0 ), next_( 0 ),
+		active_( 0 ), generation_( 0 ), stop_( false ) {}
+
+    ThreadPool( const ThreadPool & ) ;
+    ThreadPool &operator=( const ThreadPool & ) ;
+
+    /* is this thread running a piece of a job - its own or a worker's */
+    static bool &InPiece() {
+      static thread_local bool inPiece = false ;
+      return inPiece ;
+    }
+
+    /* take pieces of the current job until they're all gone */
+    void Work() {
+      InPiece() = true ;
+      for( ;; ) {
+        size_t i = next_++ ;
+        if( i >= count_ ) break ;
+        (*job_)( i ) ;
+      }
+      InPiece() = false ;
+    }
+
+    /* seen is the job running when the worker started, it waits for the next one */
+    void Worker( unsigned long seen ) {
+      std::unique_lock<std::mutex> guard( lock_ ) ;
+      for( ;; ) {
+        wake_.wait( guard, [this,seen] { return stop_ || generation_ != seen ; } ) ;
+        if( stop_ ) return ;
+        seen = generation_ ;
+        guard.unlock() ;
+        Work() ;
+        guard.lock() ;
+        if( --active_ == 0 ) done_.notify_one() ;
+      }
+    }
+
+    /* the caller is one of the threads, so start one less */
+    void StartWorkers() {
+      stop_ = false ;
+      for( int i=1 ; i<threads_ ; i++ ) {
+        workers_.push_back( std::thread( &ThreadPool::Worker, this, generation_ ) ) ;
+      }
+    }
+
+    /* called holding run_, so there's no job running */
+    void StopWorkers() {
+      {
+        std::lock_guard<std::mutex> guard( lock_ ) ;
+        stop_ = true ;
+      }
+      wake_.notify_all() ;
+      for( size_t i=0 ; i<workers_.size() ; i++ ) workers_[i].join() ;
+      workers_.clear() ;
+    }
+
+    std::atomic<int> threads_ ;
+    std::atomic<size_t> minElements_ ;
+
+    std::mutex run_ ;			/**< held for the whole of a job */
+    std::mutex lock_ ;			/**< guards the job details & the counts */
+    std::condition_variable wake_ ;	/**< a new job ( or stop ) for the workers */
+    std::condition_variable done_ ;	/**< the last worker has finished a job */
+    std::vector<std::thread> workers_ ;
+
+    const std::function<void(size_t)> *job_ ;
+    size_t count_ ;
+    std::atomic<size_t> next_ ;
+    int active_ ;
+    unsigned long generation_ ;
+    bool stop_ ;
+} ;
+
+#endif
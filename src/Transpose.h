@@ -0,0 +1,109 @@
+#ifndef LALG_TRANSPOSE_H
+#define LALG_TRANSPOSE_H
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "Simd.h"
+#include "ThreadPool.h"
+
+/**
+ Transposes of column major matrices.
+
+ Copy() works through the matrix in Block x Block tiles. A tile of the
+ input and the output both fit in cache, so the strided side of the copy
+ hits the cache instead of memory ( and the TLB ) for every element.
+ Float tiles use the SIMD transpose kernel, other types a plain loop.
+ Strips of tiles are spread over the thread pool.
+
+ InPlace() swaps tiles across the diagonal of a square matrix. Any other
+ shape follows the cycles of the permutation, that needs no second copy
+ of the data ( one bit per element to mark what's moved ) but jumps all
+ over memory, so it's much slower than Copy().
+*/
+class Transposer
+{
+  public:
+    static const int Block = 64 ;	/**< the side of a cache tile */
+
+    /**
+	b = a', a is MxN with leading dimension lda, b is NxM with leading
+	dimension ldb. They mustn't overlap.
+    */
+    template<class T> static void Copy( const T *a, int lda, int m, int n, T *b, int ldb ) {
+      size_t strips = ( m + Block - 1 ) / Block ;
+      ThreadPool::Instance().Ranges( strips, (size_t)Block * n, [&]( size_t, size_t begin, size_t end ) {
+        for( size_t s=begin ; s<end ; s++ ) {		// Block rows of a at a time
+          int i = (int)s * Block ;
+          for( int j=0 ; j<n ; j+=Block ) {
+            Tile( a + i + (size_t)j*lda, lda, b + j + (size_t)i*ldb, ldb, std::min( Block, m-i ), std::min( Block, n-j ) ) ;
+          }
+        }
+      } ) ;
+    }
+
+    /** transpose the NxN matrix a, leading dimension lda, in place */
+    template<class T> static void Square( T *a, int n, int lda ) {
+      int blocks = ( n + Block - 1 ) / Block ;
+      std::vector< std::pair<int,int> > pairs ;	// the tiles on & above the diagonal
+      for( int bi=0 ; bi<blocks ; bi++ ) {
+        for( int bj=bi ; bj<blocks ; bj++ ) pairs.push_back( std::make_pair( bi, bj ) ) ;
+      }
+      ThreadPool::Instance().Ranges( pairs.size(), (size_t)Block * Block, [&]( size_t, size_t begin, size_t end ) {
+        std::vector<T> tmp( (size_t)Block * Block ) ;
+        for( size_t p=begin ; p<end ; p++ ) {
+          int i = pairs[p].first * Block ;
+          int j = pairs[p].second * Block ;
+          int rows = std::min( Block, n-i ) ;
+          int cols = std::min( Block, n-j ) ;
+          T *upper = a + i + (size_t)j*lda ;	// rows x cols
+          T *lower = a + j + (size_t)i*lda ;	// cols x rows
+          Tile( upper, lda, &tmp[0], Block, rows, cols ) ;
+          if( i != j ) Tile( lower, lda, upper, lda, cols, rows ) ;
+          for( int c=0 ; c<rows ; c++ ) memcpy( lower + (size_t)c*lda, &tmp[(size_t)c*Block], cols*sizeof(T) ) ;
+        }
+      } ) ;
+    }
+
+    /**
+	Transpose the MxN matrix in data ( leading dimension M ) in place, it
+	ends up NxM with leading dimension N.
+    */
+    template<class T> static void InPlace( T *data, int m, int n ) {
+      if( m == n ) {
+        Square( data, n, n ) ;
+        return ;
+      }
+      if( m < 2 || n < 2 ) return ;	// a vector's data doesn't move
+
+      // element k = i + j*m goes to j + i*n. The first & last stay put
+      const size_t last = (size_t)m * n - 1 ;
+      std::vector<bool> moved( last, false ) ;
+      for( size_t start=1 ; start<last ; start++ ) {
+        if( moved[start] ) continue ;
+        size_t k = start ;
+        T v = data[k] ;
+        do {
+          k = ( k % m ) * n + k / m ;
+          std::swap( v, data[k] ) ;
+          moved[k] = true ;
+        } while( k != start ) ;
+      }
+    }
+
+  private:
+    /* b = a' for an MxN tile */
+    static void Tile( const float *a, int lda, float *b, int ldb, int m, int n ) {
+      Simd::Kernels().transpose( a, lda, b, ldb, m, n ) ;
+    }
+    template<class T> static void Tile( const T *a, int lda, T *b, int ldb, int m, int n ) {
+      for( int j=0 ; j<n ; j++ ) {
+        for( int i=0 ; i<m ; i++ ) b[j + (size_t)i*ldb] = a[i + (size_t)j*lda] ;
+      }
+    }
+} ;
+
+#endif
@@ -27,6 +27,16 @@ var R = A.mul( PI ) ;
 tot = Math.abs( R.sub( lalg.eye(3) ).sum().sum() ) ;
 console.log( "pinv values    ", (tot<0.001)?"PASS":" *** FAIL ***" ) ;
 
+A = new lalg.Array( 6,4, [ 1,0,1,0,0,1, 0,1,0,1,0,0, 0,0,0,0,1,0, 1,1,1,1,1,1 ] ) ;	// one hot + bias, rank 3
+PI = A.pinv() ;
+tot = A.mul( PI ).mul( A ).sub( A ).abs().sum().sum() ;
+tot += PI.mul( A ).mul( PI ).sub( PI ).abs().sum().sum() ;
+tot += A.pinv( 10 ).abs().sum().sum() ;
+console.log( "pinv (rank)    ", (tot<0.001)?"PASS":" *** FAIL ***" ) ;
+A.pinvp().then( function( PIp ) {
+  console.log( "pinvp          ", (PIp.sub( PI ).abs().sum().sum()<0.001)?"PASS":" *** FAIL ***" ) ;
+} ) ;
+
 A = lalg.rand(10) ;
 var arr = Array.from(A) ;
 var sum = arr.reduce(function(a, b) { return a + b; }, 0);
@@ -164,6 +174,11 @@ console.log( "pca(A) - linear", (P.length==4)?"PASS":" *** FAIL ***" ) ;
 A = lalg.rand( 3,4 ) ;
 P = A.dup().pca(1.0) ;
 console.log( "pca(A) - rand  ", (P.length==12)?"PASS":" *** FAIL ***" ) ;
+A = lalg.rand( 8, 6 ) ;
+B = A.dup() ;
+V = A.view( 1, 1, 5, 4 ) ;
+P = V.pca( 1.0 ) ;
+console.log( "pca(view)      ", (P.m==4 && A.sub( B ).abs().sum().sum()==0)?"PASS":" *** FAIL ***" ) ;
 
 A = new lalg.rand( 25 ) ;
 B = A.add(A) ;
@@ -195,3 +210,380 @@ B = A.findGreater().add(  A.findLessEqual() ) ;
 tot = Math.abs( B.sub(A).sum().sum() ) ;
 console.log( "find           ", (tot<0.001)?"PASS":" *** FAIL ***" ) ;
 
+
+var stats = lalg.poolStats() ;
+var old = lalg.setPoolLimit( 1024*1024 ) ;
+console.log( "poolStats      ", (stats.hits>=0 && stats.misses>0 && lalg.poolStats().limit==1024*1024)?"PASS":" *** FAIL ***" ) ;
+lalg.setPoolLimit( old ) ;
+
+var F = new Float32Array( [ 1,2,3,4,5,6,7,8,9 ] ) ;
+A = new lalg.Array( 3, 3, F ) ;
+F[8] = 90 ;
+console.log( "Float32Array   ", (A.get(2,2)==90 && A.sum().sum()==126)?"PASS":" *** FAIL ***" ) ;
+A = lalg.fromBuffer( F.buffer, 3 ) ;
+console.log( "fromBuffer     ", (A.m==3 && A.n==3 && A.get(1,2)==8)?"PASS":" *** FAIL ***" ) ;
+
+A = new lalg.Array( 2, 2, [ 1,2,3,4 ] ) ;
+var V = A.asFloat32Array() ;
+V[0] = 10 ;
+var C = A.toFloat32Array() ;
+C[1] = 20 ;
+console.log( "asFloat32Array ", (A.get(0)==10 && A.get(1)==2 && V.length==4)?"PASS":" *** FAIL ***" ) ;
+A.reshape( 100, 100 ) ;
+console.log( "view detach    ", (V.length==0 && C.length==4)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 6, 5 ) ;
+V = A.viewColumns( 1, 3 ) ;
+B = A.getColumns( [1,2,3] ) ;
+console.log( "viewColumns    ", (V.isView && Math.abs( V.sum().sum()-B.sum().sum() )<0.0001)?"PASS":" *** FAIL ***" ) ;
+V = A.viewRows( 2, 3 ) ;
+B = A.getRows( [2,3,4] ) ;
+tot = Math.abs( V.mul( lalg.ones(5,2) ).sub( B.mul( lalg.ones(5,2) ) ).sum().sum() ) ;
+tot += Math.abs( V.add( B ).sub( B.mul(2) ).sum().sum() ) ;
+console.log( "viewRows       ", (tot<0.001 && V.m==3 && V.n==5)?"PASS":" *** FAIL ***" ) ;
+V = A.view( 1, 1, 2, 2 ) ;
+V.set( 42, 0, 0 ) ;
+console.log( "view write     ", (A.get(1,1)==42 && !V.dup().isView)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 4, 3 ) ;
+B = lalg.rand( 4, 3 ) ;
+C = A.add( B ) ;
+var O = lalg.zeros( 4, 3 ) ;
+var R = A.add( B, O ) ;
+tot = Math.abs( O.sub( C ).sum().sum() ) ;
+A.addi( B ) ;
+tot += Math.abs( A.sub( C ).sum().sum() ) ;
+console.log( "add out/inplace", (R===O && tot<0.0001)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 4, 3 ) ;
+B = lalg.rand( 3, 2 ) ;
+O = lalg.ones( 4, 2 ) ;
+A.mul( B, O, 1 ) ;
+tot = Math.abs( O.sub( A.mul( B ).add( 1 ) ).sum().sum() ) ;
+console.log( "mul out/beta   ", (tot<0.0001)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 5, 4 ) ;
+var v0 = A.version ;
+B = A.dup() ;
+var before = A.get( 2, 3 ) ;
+B.set( 99, 2, 3 ) ;
+console.log( "dup on write   ", (A.get(2,3)==before && B.get(2,3)==99 && A.version==v0 && B.version!=v0)?"PASS":" *** FAIL ***" ) ;
+B = A.dup() ;
+A.addi( 1 ) ;
+tot = Math.abs( A.sub( B ).sum().sum() - 20 ) ;
+console.log( "dup in place   ", (tot<0.0001 && A.version!=v0)?"PASS":" *** FAIL ***" ) ;
+B = A.dup() ;
+v0 = A.version ;
+A.pca( 0.9 ) ;
+tot = Math.abs( A.sub( B ).sum().sum() ) ;
+console.log( "dup after pca  ", (tot==0 && A.version==v0 && B.version==v0)?"PASS":" *** FAIL ***" ) ;
+try { A.set( 1, 1000, 1000 ) ; } catch( e ) {}
+try { A.set( 1, 100000 ) ; } catch( e ) {}
+console.log( "set bad index  ", (A.version==v0 && B.version==v0)?"PASS":" *** FAIL ***" ) ;
+
+var MMAP_FILE = require('os').tmpdir() + '/lalg-test.f32' ;
+fs.writeFileSync( MMAP_FILE, Buffer.from( new Float32Array( [ 1,2,3,4,5,6,7,8 ] ).buffer ) ) ;
+A = lalg.mmap( MMAP_FILE, 2 ) ;
+B = lalg.mmap( MMAP_FILE, 2, 3, { mode:'c', offset:8 } ) ;
+var s0 = A.sum().sum() ;
+A.set( 100, 0, 0 ) ;
+B.set( 100, 0, 0 ) ;
+console.log( "mmap           ", (A.n==4 && s0==36 && B.get(1,2)==8 && lalg.mmap( MMAP_FILE, 2 ).get(0,0)==1)?"PASS":" *** FAIL ***" ) ;
+C = lalg.mmap( MMAP_FILE, 4, 2, { mode:'r' } ) ;
+P = C.pca( 1.0 ) ;		// a write would fault on the read only mapping
+console.log( "mmap pca       ", (P.m==2 && C.get(0,0)==1 && C.get(3,1)==8)?"PASS":" *** FAIL ***" ) ;
+fs.unlinkSync( MMAP_FILE ) ;
+
+var T = null ;
+A = lalg.rand( 20, 10 ) ;
+var S = lalg.scope( function() {
+  T = A.transpose() ;
+  return [ T.mul( A ), 42 ] ;
+} ) ;
+tot = Math.abs( S[0].sub( A.transpose().mul( A ) ).sum().sum() ) ;
+console.log( "scope          ", (tot<0.001 && S[1]==42 && T.m==0 && A.m==20)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 100, 100 ) ;
+B = A.dup() ;
+A.dispose() ;
+var threw = false ;
+try { A.sum() ; } catch( e ) { threw = true ; }
+console.log( "dispose        ", (threw && A.disposed && A.m==0 && B.m==100)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.zeros( 0, 3 ) ;
+B = lalg.zeros( 4, 0 ) ;
+for( var i=0 ; i<50 ; i++ ) {
+  A.appendRowsi( new lalg.Array( 1, 3, [ i, 2*i, 3*i ] ) ) ;
+  B.appendColumnsi( new lalg.Array( 4, 1, i ) ) ;
+}
+tot = Math.abs( A.sum().sum() - 6*1225 ) + Math.abs( B.sum().sum() - 4*1225 ) ;
+A.shrinkToFit() ;
+C = lalg.rand( 2, 3 ) ;
+tot += Math.abs( C.appendRows( C ).sum().sum() - 2*C.sum().sum() ) ;
+console.log( "append in place", (tot<0.001 && A.m==50 && A.get(49,2)==147 && B.n==50 && A.reserve( 100, 10 ).m==50)?"PASS":" *** FAIL ***" ) ;
+
+A = new lalg.Array64( 3, 3, [ 4, 2, 1, 2, 5, 3, 1, 3, 6 ] ) ;
+B = A.mul( A.inv() ) ;
+tot = Math.abs( B.sub( new lalg.Array64( 3, 3, [ 1, 0, 0, 0, 1, 0, 0, 0, 1 ] ) ).asum() ) ;
+C = new lalg.Array64( 4, 2, [ 1, 1, 1, 1, 1, 1.000001, 1.000002, 1.000003 ] ) ;
+D = C.pinv().mul( C ) ;
+tot += Math.abs( D.get(0,0) - 1 ) + Math.abs( D.get(1,1) - 1 ) + Math.abs( D.get(0,1) ) ;
+tot += Math.abs( lalg.rand( 3, 4 ).toArray64().toArray().m - 3 ) ;
+console.log( "array64        ", (tot<1e-6 && C.pinv().m==2 && A.svd().S.m==3)?"PASS":" *** FAIL ***" ) ;
+R = new lalg.Array64( 1, 3, [ 1, 2, 3 ] ) ;
+D = new lalg.Array64( 3, 1, [ 1, 2, 3 ] ) ;
+console.log( "array64 bcast  ", (A.add(R).get(2,1)==5 && A.sub(D).get(2,1)==0 && A.hadamard(D).get(1,2)==6 && A.mul(2).get(1,1)==10 && A.add(0.5).get(0,0)==4.5)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 300, 40 ).sub( 0.5 ) ;
+B = lalg.rand( 40, 3 ) ;
+C = A.mul( B ) ;
+tot = 0 ;
+[ 'bf16', 'fp16', 'int8' ].forEach( function( t ) {
+  var Q = A.quantize( t ) ;
+  tot += Q.mul( B ).sub( C ).abs().sum().sum() / C.abs().sum().sum() ;
+  tot += B.transpose().mul( Q.toArray().transpose() ).sub( C.transpose() ).abs().sum().sum() / C.abs().sum().sum() ;
+  tot += A.transpose().mul( Q ).m==40 ? 0 : 1 ;
+} ) ;
+console.log( "quantize       ", (tot<0.05 && A.quantize('int8').bytes==12000)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.zeros( 30, 20 ) ;
+for( var i=0 ; i<A.m ; i++ ) {
+  for( var j=(i%5) ; j<A.n ; j+=5 ) A.set( 1 + ( i*7 + j*3 ) % 11, i, j ) ;	// 120 non zeros
+}
+S = lalg.sparse( A ) ;
+B = lalg.rand( 20, 4 ) ;
+tot = S.mul( B ).sub( A.mul( B ) ).abs().sum().sum() ;
+tot += B.transpose().mul( S.transpose() ).sub( B.transpose().mul( A.transpose() ) ).abs().sum().sum() ;
+tot += lalg.sparse( 2, 3, [ 0, 1, 1 ], [ 2, 0, 0 ], [ 5, 1, 2 ] ).toArray().sub( new lalg.Array( 2, 3, [ 0, 3, 0, 0, 5, 0 ] ) ).abs().sum().sum() ;
+try { lalg.sparse( -2, 3, [], [], [] ) ; tot += 1 ; } catch( e ) {}
+console.log( "sparse         ", (tot<0.001 && S.nnz==120 && S.toArray().sub( A ).abs().sum().sum()==0)?"PASS":" *** FAIL ***" ) ;
+( function( S, B, AB ) {		// later tests reuse A & B
+  S.mulp( B ).then( function( C ) {
+    console.log( "sparse mulp    ", (C.sub( AB ).abs().sum().sum()<0.001)?"PASS":" *** FAIL ***" ) ;
+  } ) ;
+} )( S, B, A.mul( B ) ) ;
+
+A = lalg.rand( 7, 13 ).abs().mul( 0.4 ).add( 0.001 ) ;	// rand is integers in [-10,10]
+B = lalg.rand( 7, 13 ).mul( 0.05 ) ;
+tot = 0 ;
+for( var i=0 ; i<A.length ; i++ ) {
+  var a = A.get(i), b = B.get(i) ;
+  tot += Math.abs( A.log().get(i) - Math.log(a) ) + Math.abs( A.sqrt().get(i) - Math.sqrt(a) ) ;
+  tot += Math.abs( B.abs().get(i) - Math.abs(b) ) + Math.abs( A.hadamard(B).get(i) - a*b ) ;
+  tot += Math.abs( B.findGreater( 0.25 ).get(i) - ( b>0.25 ? b : 0 ) ) + Math.abs( B.findLessEqual( 0, 2 ).get(i) - ( b<=0 ? 2 : 0 ) ) ;
+}
+tot += Math.abs( B.sub( B.get(0) ).find( 0, 1e-6, 3 ).get(0) - 3 ) ;
+console.log( "simd           ", (tot<1e-4 && typeof lalg.simd == 'string')?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 301, 217 ).sub( 0.5 ) ;
+B = lalg.rand( 1, 217 ) ;
+var threads = lalg.setThreads( 1 ) ;
+C = A.add( B ).abs().log() ;
+D = [ A.sum(), A.sum(1), A.norm(), A.mean(1) ] ;
+lalg.setThreads( 4, 1000 ) ;
+tot = C.sub( A.add( B ).abs().log() ).abs().sum().sum() ;
+tot += A.sum().sub( D[0] ).abs().sum() + A.sum(1).sub( D[1] ).abs().sum() ;
+tot += A.norm().sub( D[2] ).abs().sum() + A.mean(1).sub( D[3] ).abs().sum() ;
+tot += Math.abs( A.asum() - A.abs().sum().sum() ) / A.asum() ;
+console.log( "threads        ", (tot<1e-4 && lalg.setThreads( threads, 65536 )==4)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 123, 45 ).mul( 0.01 ) ;		// keep ( A - M ) x B + 1 positive for the log
+B = lalg.rand( 123, 45 ).abs().mul( 0.1 ) ;
+M = A.mean() ;
+V = lalg.rand( 123, 1 ) ;
+C = A.sub( M ).hadamard( B ).add( 1 ).log().sub( V ).abs().mul( 3 ) ;
+L = A.lazy().sub( M ).hadamard( B ).add( 1 ).log().sub( V ).abs().mul( 3 ) ;
+tot = L.eval().sub( C ).abs().sum().sum() ;
+tot += lalg.lazy( A ).add( B.lazy().neg() ).eval().sub( A.sub( B ) ).abs().sum().sum() ;
+tot += Math.abs( L.sum().sum() - C.sum().sum() ) / C.sum().sum() ;
+tot += L.mul( B.transpose() ).sub( C.mul( B.transpose() ) ).abs().sum().sum() / 1000 ;
+D = A.abs() ;
+D.lazy().hadamard( D ).sqrt().eval( D ) ;
+tot += D.sub( A.abs() ).abs().sum().sum() ;
+console.log( "lazy           ", (tot<1e-3 && L.m==123 && L.n==45)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 37, 11 ).abs().mul( 0.1 ) ;	// a in [0,1] & b in [-0.5,0.5] keep log & ^1.5 defined
+B = lalg.rand( 37, 11 ).mul( 0.05 ) ;
+R = lalg.rand( 1, 11 ) ;
+C = lalg.map( 'log( a*b + 1 ) - c^2 + min( a, d ) / 2 + clip( b, -0.2, 0.2 ) + tanh( b ) * sigmoid( -a ) + a^1.5', A, B, R, 0.5 ) ;
+tot = 0 ;
+for( var i=0 ; i<A.m ; i++ ) {
+  for( var j=0 ; j<A.n ; j++ ) {
+    var a = A.get(i,j), b = B.get(i,j), r = R.get(0,j) ;
+    var e = Math.log( a*b + 1 ) - r*r + Math.min( a, 0.5 ) / 2 + Math.max( -0.2, Math.min( b, 0.2 ) ) + Math.tanh( b ) / ( 1 + Math.exp( a ) ) + Math.pow( a, 1.5 ) ;
+    tot += Math.abs( C.get(i,j) - e ) ;
+  }
+}
+try { lalg.map( 'log( a * ', A ) ; tot += 1 ; } catch( e ) {}
+try { lalg.map( 'a + b', A ) ; tot += 1 ; } catch( e ) {}
+console.log( "map            ", (tot<1e-3 && C.m==37 && C.n==11)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 7, 300 ).mul( 1.95 ).add( 0.3 ) ;		// about +/- 20, exp stays finite in float
+tot = 0 ;
+[ [ 'exp', Math.exp ], [ 'tanh', Math.tanh ], [ 'sigmoid', function(x) { return 1/(1+Math.exp(-x)) ; } ],
+  [ 'relu', function(x) { return x<0 ? 0 : x ; } ], [ 'softplus', function(x) { return Math.max(x,0) + Math.log( 1 + Math.exp( -Math.abs(x) ) ) ; } ] ].forEach( function( f ) {
+  C = A[f[0]]() ;
+  for( var i=0 ; i<A.length ; i++ ) tot += Math.abs( C.get(i) - f[1]( A.get(i) ) ) / Math.max( 1, Math.abs( f[1]( A.get(i) ) ) ) ;
+} ) ;
+console.log( "activations    ", (tot<1e-3)?"PASS":" *** FAIL ***" ) ;
+
+Z = lalg.rand( 5, 40 ).mul( 10 ).add( 0.5 ) ;	// up to 100.5, big enough to overflow a float exp
+Y = lalg.zeros( 5, 40 ) ;
+for( var j=0 ; j<Z.n ; j++ ) Y.set( 1, j%5, j ) ;
+tot = 0 ;
+for( var d=0 ; d<2 ; d++ ) {
+  P = Z.softmax( d ) ;
+  L = Z.logsumexp( d ) ;
+  ce = Z.crossEntropy( Y, d ) ;
+  var samples = d==0 ? Z.n : Z.m, classes = d==0 ? Z.m : Z.n, loss = 0 ;
+  for( var j=0 ; j<samples ; j++ ) {
+    var mx = -Infinity, s = 0, ps = 0 ;
+    for( var i=0 ; i<classes ; i++ ) mx = Math.max( mx, d==0 ? Z.get(i,j) : Z.get(j,i) ) ;
+    for( var i=0 ; i<classes ; i++ ) s += Math.exp( ( d==0 ? Z.get(i,j) : Z.get(j,i) ) - mx ) ;
+    var lse = mx + Math.log( s ) ;
+    tot += Math.abs( L.get( j ) - lse ) / Math.max( 1, Math.abs( lse ) ) ;
+    for( var i=0 ; i<classes ; i++ ) {
+      var z = d==0 ? Z.get(i,j) : Z.get(j,i), y = d==0 ? Y.get(i,j) : Y.get(j,i), p = Math.exp( z - lse ) ;
+      ps += d==0 ? P.get(i,j) : P.get(j,i) ;
+      loss += y * ( lse - z ) ;
+      tot += Math.abs( ( d==0 ? ce.gradient.get(i,j) : ce.gradient.get(j,i) ) - ( p - y ) / samples ) ;
+    }
+    tot += Math.abs( ps - 1 ) ;
+  }
+  tot += Math.abs( ce.loss - loss / samples ) / Math.max( 1, loss / samples ) ;
+}
+z = lalg.rand( 50, 1 ).mul( 2 ).add( 0.5 ) ;
+y = z.findGreater( 0, 1 ) ;
+ce = z.crossEntropy( y, 1 ) ;
+loss = 0 ;
+for( var i=0 ; i<z.m ; i++ ) {
+  loss += Math.max( z.get(i), 0 ) + Math.log( 1 + Math.exp( -Math.abs( z.get(i) ) ) ) - y.get(i) * z.get(i) ;
+  tot += Math.abs( ce.gradient.get(i) - ( 1/(1+Math.exp(-z.get(i))) - y.get(i) ) / z.m ) ;
+}
+tot += Math.abs( ce.loss - loss / z.m ) ;
+console.log( "softmax        ", (tot<1e-3)?"PASS":" *** FAIL ***" ) ;
+
+tot = 0 ;
+[ [ 1, 9 ], [ 9, 1 ], [ 70, 70 ], [ 67, 131 ], [ 300, 45 ] ].forEach( function( sz ) {
+  A = lalg.rand( sz[0], sz[1] ) ;
+  B = A.dup() ;
+  T = A.transpose() ;
+  B.transposei() ;
+  if( T.m != sz[1] || T.n != sz[0] || B.m != sz[1] || B.n != sz[0] ) tot += 1 ;
+  for( var i=0 ; i<A.m ; i++ ) {
+    for( var j=0 ; j<A.n ; j++ ) tot += Math.abs( A.get(i,j) - T.get(j,i) ) + Math.abs( A.get(i,j) - B.get(j,i) ) ;
+  }
+} ) ;
+A = lalg.rand( 100, 100 ) ;
+V = A.view( 10, 20, 30, 30 ) ;
+T = V.transpose() ;
+V.transposei() ;
+for( var i=0 ; i<30 ; i++ ) {
+  for( var j=0 ; j<30 ; j++ ) tot += Math.abs( A.get(10+i,20+j) - T.get(i,j) ) ;
+}
+console.log( "transpose      ", (tot==0)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 2500, 7 ) ;		// integers in [-10,10]
+A.set( -15, 1234, 3 ) ;
+A.set( 15, 2047, 5 ) ;
+d = A.describe() ;
+tot = ( d.count == 2500 ) ? 0 : 1 ;
+for( var j=0 ; j<A.n ; j++ ) {
+  var mean = 0, v = 0, mn = Infinity, mx = -Infinity, amn = 0, amx = 0 ;
+  for( var i=0 ; i<A.m ; i++ ) mean += A.get(i,j) ;
+  mean /= A.m ;
+  for( var i=0 ; i<A.m ; i++ ) {
+    var x = A.get(i,j) ;
+    v += ( x - mean ) * ( x - mean ) ;
+    if( x < mn ) { mn = x ; amn = i ; }
+    if( x > mx ) { mx = x ; amx = i ; }
+  }
+  v /= A.m - 1 ;
+  tot += Math.abs( d.mean.get(j) - mean ) + Math.abs( d.var.get(j) - v ) + Math.abs( d.min.get(j) - mn ) + Math.abs( d.max.get(j) - mx ) ;
+  tot += Math.abs( d.argmin.get(j) - amn ) + Math.abs( d.argmax.get(j) - amx ) ;
+}
+s = A.getColumns( 3 ).describe() ;
+tot += Math.abs( s.min + 15 ) + Math.abs( s.argmin - 1234 ) ;
+tot += Math.abs( lalg.ones( 4000000, 1 ).add( 0.1 ).sum() - 4400000 ) / 4400000 ;
+R = lalg.ones( 3, 1000000 ).add( 0.1 ).sum( 1 ) ;
+tot += Math.abs( R.get(2) - 1100000 ) / 1100000 ;
+console.log( "describe       ", (tot<1e-4)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 40, 30 ) ;
+B = lalg.rand( 25, 40 ) ;
+var AT = A.transpose() ;
+var BT = B.transpose() ;
+tot = Math.abs( A.t().mul( BT ).sub( AT.mul( BT ) ).sum().sum() ) ;
+tot += Math.abs( AT.mul( B.t() ).sub( AT.mul( BT ) ).sum().sum() ) ;
+tot += Math.abs( A.t().mul( B.t() ).sub( AT.mul( BT ) ).sum().sum() ) ;
+tot += Math.abs( A.mul( B, { transA:true, transB:true } ).sub( AT.mul( BT ) ).sum().sum() ) ;
+O = lalg.ones( 30, 25 ) ;
+A.mul( B, { transA:true, transB:true, alpha:2, beta:1, out:O } ) ;
+tot += Math.abs( O.sub( AT.mul( BT ).mul( 2 ).add( 1 ) ).sum().sum() ) ;
+tot += Math.abs( A.t().transpose().sub( A ).sum().sum() ) + Math.abs( A.t().sub( AT ).sum().sum() ) ;
+tot += ( A.t().m == 30 && A.t().n == 40 ) ? 0 : 1 ;
+V = A.viewRows( 5, 25 ) ;
+tot += Math.abs( V.t().mul( V ).sub( V.transpose().mul( V ) ).sum().sum() ) ;
+console.log( "mul transposed ", (tot<0.01)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 300, 20 ).add( 1000 ) ;
+G = A.gram() ;
+tot = Math.abs( G.sub( A.transpose().mul( A ) ).sum().sum() ) / G.sum().sum() ;
+O = lalg.ones( 20, 20 ) ;
+A.viewRows( 0, 100 ).gram( O, 1 ) ;
+A.viewRows( 100, 200 ).gram( O, 1 ) ;
+tot += Math.abs( O.sub( G ).sum().sum() - 400 ) / G.sum().sum() ;
+C = A.cov() ;
+M = A.sub( A.mean() ) ;
+tot += Math.abs( C.sub( M.transpose().mul( M ).mul( 1/299 ) ).sum().sum() ) ;
+R = A.corr() ;
+tot += Math.abs( R.get( 3, 3 ) - 1 ) + Math.abs( R.get( 2, 5 ) - C.get( 2, 5 ) / Math.sqrt( C.get( 2, 2 ) * C.get( 5, 5 ) ) ) ;
+tot += ( G.symmetric && C.symmetric && R.symmetric && !A.symmetric ) ? 0 : 1 ;
+C.set( 0, 1, 5 ) ;
+tot += C.symmetric ? 1 : 0 ;
+console.log( "gram & cov     ", (tot<0.01)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 40, 40 ) ;
+B = lalg.rand( 40, 3 ) ;
+X = A.solveLinear( B ) ;
+tot = A.mul( X ).sub( B ).abs().sum().sum() / B.abs().sum().sum() ;
+G = lalg.rand( 60, 40 ).gram() ;
+X = G.solveLinear( B ) ;
+tot += G.mul( X ).sub( B ).abs().sum().sum() / B.abs().sum().sum() ;
+A = lalg.rand( 100, 5 ) ;
+y = lalg.rand( 100, 1 ) ;
+X = A.solveLinear( y ) ;
+tot += A.t().mul( A.mul( X ).sub( y ) ).abs().sum() / A.t().mul( y ).abs().sum() ;
+tot += A.solveLinear( y, { rcond:1e-6 } ).sub( X ).abs().sum() / X.abs().sum() ;
+D = A.appendColumns( A.getColumns( 0 ) ) ;		// not of full rank
+tot += D.t().mul( D.mul( D.solveLinear( y ) ).sub( y ) ).abs().sum() / D.t().mul( y ).abs().sum() ;
+( function( X ) {		// later tests reuse X
+  A.solveLinearp( y ).then( function( Xp ) {
+    console.log( "solveLinearp   ", (Xp.sub( X ).abs().sum()<0.01*X.abs().sum())?"PASS":" *** FAIL ***" ) ;
+  } ) ;
+} )( X ) ;
+console.log( "solveLinear    ", (tot<0.01)?"PASS":" *** FAIL ***" ) ;
+
+A = lalg.rand( 30, 30 ) ;
+B = lalg.rand( 30, 2 ) ;
+F = A.lu() ;
+tot = F.solve( B ).sub( A.solveLinear( B ) ).abs().sum().sum() ;
+tot += A.mul( F.inv() ).sub( lalg.eye( 30 ) ).abs().sum().sum() / 30 ;
+tot += Math.abs( F.logdet() - Math.log( Math.abs( F.det() ) ) ) ;
+tot += Math.abs( lalg.eye( 3 ).mul( 2 ).lu().det() - 8 ) ;
+G = lalg.rand( 50, 30 ).gram() ;
+F = G.chol() ;
+tot += G.mul( F.solve( B ) ).sub( B ).abs().sum().sum() / B.abs().sum().sum() ;
+tot += Math.abs( F.logdet() - G.lu().logdet() ) ;
+tot += F.inv().symmetric ? 0 : 1 ;
+( function( X, y ) {		// the qrp callback runs after later tests have started
+  var F = X.qr() ;
+  var W = F.solve( y ) ;
+  tot += W.sub( X.solveLinear( y ) ).abs().sum() / W.abs().sum() ;
+  tot += F.inv().mul( y ).sub( W ).abs().sum() / W.abs().sum() ;
+  tot += ( F.m == 100 && F.n == 5 && F.kind == "qr" ) ? 0 : 1 ;
+  X.qrp().then( function( Fp ) {
+    console.log( "qrp            ", (Fp.solve( y ).sub( W ).abs().sum()<0.01*W.abs().sum())?"PASS":" *** FAIL ***" ) ;
+  } ) ;
+} )( lalg.rand( 100, 5 ), lalg.rand( 100, 1 ) ) ;
+console.log( "lu, chol & qr  ", (tot<0.01)?"PASS":" *** FAIL ***" ) ;
@@ -4,6 +4,7 @@ var csv = require("fast-csv");
 
 // Implement linear regression:
 // theta = inv(X' X) X' y ;
+// solved as least squares, without the inverse
 
 var train = fs.createReadStream('node_modules/lalg/data/wine-train.csv');
 var csvStreamTrain = csv() ;
@@ -22,13 +23,7 @@ Promise.all( [ linalg.read( csvStreamTrain) , linalg.read( csvStreamTest ) ] )
   	  H = tmp.hadamard( tmp.rotateColumns(i) )  ;   // feature x * feature y -> H
 	  X = X.appendColumns( H ) ;  			// add the features to X
         }
-	return Promise.all( [ X.transpose().mulp(X), X, y, data[1] ] )  ;
-})
-.then( function(X) { 
-	return Promise.all( [ X[0].inv().mulp( X[1].transpose() ), X[1], X[2], X[3] ] ) ;
-})
-.then( function(X) { 
-	return Promise.all( [ X[0].mulp( X[2] ), X[1], X[2], X[3] ] ) ;
+	return Promise.all( [ X.solveLinearp( y ), X, y, data[1] ] )  ;
 })
 .then( function(X) { 
 	var theta = Array.from( X[0] ) ;